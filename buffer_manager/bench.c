@@ -0,0 +1,388 @@
+#include "dberror.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "math.h"
+#include "dt.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+
+// Throughput and latency benchmarks of the buffer manager and raw bandwidth of the storage manager.
+//
+//   run_bench.exe [-o results.csv] [-n operations] [-s poolSize ...]
+//
+// Every replacement strategy runs every workload at every pool size (64 and 1024 frames by default):
+//   hit      pages that are all resident
+//   miss     a shuffled cycle through eight times as many pages as the pool holds
+//   uniform  uniformly random pages out of four times the pool
+//   zipf     Zipfian (theta 0.99) pages out of four times the pool, hot pages scattered over the file
+//   scan     repeated sequential scans of twice the pool
+//   mixed    the Zipfian pages, every third pin also marks its page dirty
+// One operation is a pinPage followed by unpinPage. Latencies come from the pool's latency histograms,
+// enabled after the warm-up. The storage manager rows read and write every page of the benchmark file
+// with readBlock and writeBlock, in order and in random order. Results go to stdout and to a CSV file,
+// one row per run, so runs of two versions can be compared line by line.
+
+#define BENCH_FILE "bench.bin"
+#define DEFAULT_OPERATIONS 20000
+#define MAX_POOL_SIZES 16
+#define ZIPF_THETA 0.99
+#define MIXED_WRITE_EVERY 3
+#define CSV_HEADER "benchmark,strategy,poolSize,workload,operations,seconds,opsPerSecond,mbPerSecond,hitRatio,p50Nanos,p99Nanos,p999Nanos\n"
+
+typedef struct Strategy {
+    const char *name;
+    ReplacementStrategy strategy;
+} Strategy;
+
+static const Strategy strategies[] = {
+    { "FIFO", RS_FIFO }, { "LRU", RS_LRU }, { "CLOCK", RS_CLOCK }, { "LFU", RS_LFU },
+    { "LRU-2", RS_LRU_K }, { "ARC", RS_ARC }, { "2Q", RS_2Q }
+};
+
+static const char *workloads[] = { "hit", "miss", "uniform", "zipf", "scan", "mixed" };
+
+static unsigned long long randomState = 88172645463325252ULL;
+static FILE *results;
+
+// xorshift64, every run of the benchmark sees the same pages
+static unsigned long long nextRandom(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return randomState;
+}
+
+static double nowSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void shuffle(PageNumber *pages, int numPages)
+{
+    for (int i = numPages - 1; i > 0; i--)
+    {
+        int j = (int)(nextRandom() % (unsigned long long)(i + 1));
+        PageNumber page = pages[i];
+        pages[i] = pages[j];
+        pages[j] = page;
+    }
+}
+
+static void writeResult(const char *benchmark, const char *strategy, int poolSize, const char *workload,
+                        long operations, double seconds, double megabytes, double hitRatio,
+                        long long p50, long long p99, long long p999)
+{
+    char row[512];
+    snprintf(row, sizeof(row), "%s,%s,%d,%s,%ld,%.6f,%.0f,%.2f,%.4f,%lld,%lld,%lld\n",
+             benchmark, strategy, poolSize, workload, operations, seconds,
+             (seconds > 0) ? operations / seconds : 0.0, (seconds > 0) ? megabytes / seconds : 0.0,
+             hitRatio, p50, p99, p999);
+    fputs(row, stdout);
+    fputs(row, results);
+}
+
+/// Workloads ///
+
+// Page of every operation of a workload, generated before the clock starts
+static PageNumber *generateWorkload(const char *workload, int poolSize, int operations)
+{
+    PageNumber *pages = (PageNumber *)malloc(sizeof(PageNumber) * operations);
+    if (pages == NULL)
+    {
+        return NULL;
+    }
+
+    if (strcmp(workload, "hit") == 0)
+    {
+        for (int i = 0; i < operations; i++)
+        {
+            pages[i] = (PageNumber)(nextRandom() % poolSize);
+        }
+    }
+    else if (strcmp(workload, "miss") == 0)
+    {
+        int cycle = 8 * poolSize;
+        PageNumber *order = (PageNumber *)malloc(sizeof(PageNumber) * cycle);
+        for (int i = 0; i < cycle; i++)
+        {
+            order[i] = i;
+        }
+        shuffle(order, cycle);
+        for (int i = 0; i < operations; i++)
+        {
+            pages[i] = order[i % cycle];
+        }
+        free(order);
+    }
+    else if (strcmp(workload, "uniform") == 0)
+    {
+        for (int i = 0; i < operations; i++)
+        {
+            pages[i] = (PageNumber)(nextRandom() % (4 * poolSize));
+        }
+    }
+    else if (strcmp(workload, "zipf") == 0 || strcmp(workload, "mixed") == 0)
+    {
+        // Rank r is drawn with probability proportional to 1 / r^theta and mapped to a shuffled page,
+        // so the hot pages are not neighbours and do not look like a scan
+        int numPages = 4 * poolSize;
+        double *cdf = (double *)malloc(sizeof(double) * numPages);
+        PageNumber *rankPage = (PageNumber *)malloc(sizeof(PageNumber) * numPages);
+        double sum = 0;
+        for (int rank = 0; rank < numPages; rank++)
+        {
+            sum += 1.0 / pow(rank + 1, ZIPF_THETA);
+            cdf[rank] = sum;
+            rankPage[rank] = rank;
+        }
+        shuffle(rankPage, numPages);
+        for (int i = 0; i < operations; i++)
+        {
+            double target = (nextRandom() >> 11) * (1.0 / 9007199254740992.0) * sum;
+            int low = 0;
+            int high = numPages - 1;
+            while (low < high)
+            {
+                int middle = (low + high) / 2;
+                if (cdf[middle] < target)
+                {
+                    low = middle + 1;
+                }
+                else
+                {
+                    high = middle;
+                }
+            }
+            pages[i] = rankPage[low];
+        }
+        free(cdf);
+        free(rankPage);
+    }
+    else if (strcmp(workload, "scan") == 0)
+    {
+        for (int i = 0; i < operations; i++)
+        {
+            pages[i] = i % (2 * poolSize);
+        }
+    }
+
+    return pages;
+}
+
+/// Buffer Manager ///
+
+// Pins and unpins every page of the workload once, marking every MIXED_WRITE_EVERY-th page dirty if asked
+static int runPins(BM_BufferPool *bm, const PageNumber *pages, int operations, bool writes)
+{
+    BM_PageHandle page;
+    int failures = 0;
+
+    for (int i = 0; i < operations; i++)
+    {
+        if (pinPage(bm, &page, pages[i]) != RC_OK)
+        {
+            failures++;
+            continue;
+        }
+        if (writes && i % MIXED_WRITE_EVERY == 0)
+        {
+            page.data[0]++;
+            markDirty(bm, &page);
+        }
+        unpinPage(bm, &page);
+    }
+    return failures;
+}
+
+static void benchmarkPool(const Strategy *strategy, int poolSize, const char *workload, int operations)
+{
+    BM_BufferPool bm;
+    BM_PoolStats before;
+    BM_PoolStats after;
+    BM_LatencyHistogram hits;
+    BM_LatencyHistogram misses;
+    int k = 2;
+
+    PageNumber *pages = generateWorkload(workload, poolSize, operations);
+    if (pages == NULL || initBufferPool(&bm, BENCH_FILE, poolSize, strategy->strategy,
+                                        (strategy->strategy == RS_LRU_K) ? &k : NULL) != RC_OK)
+    {
+        fprintf(stderr, "unable to set up %s %d %s\n", strategy->name, poolSize, workload);
+        free(pages);
+        return;
+    }
+
+    // The hit workload starts with all its pages resident, the others start cold
+    if (strcmp(workload, "hit") == 0)
+    {
+        PageNumber *warmUp = (PageNumber *)malloc(sizeof(PageNumber) * poolSize);
+        for (int i = 0; i < poolSize; i++)
+        {
+            warmUp[i] = i;
+        }
+        shuffle(warmUp, poolSize); // in order, read-ahead would bring in pages beyond the pool
+        runPins(&bm, warmUp, poolSize, false);
+        free(warmUp);
+    }
+    enableLatencyHistograms(&bm);
+    getPoolStats(&bm, &before);
+
+    double start = nowSeconds();
+    runPins(&bm, pages, operations, strcmp(workload, "mixed") == 0);
+    double seconds = nowSeconds() - start;
+
+    getPoolStats(&bm, &after);
+    getLatencyHistogram(&bm, BM_LATENCY_PIN_HIT, &hits);
+    getLatencyHistogram(&bm, BM_LATENCY_PIN_MISS, &misses);
+    shutdownBufferPool(&bm);
+    free(pages);
+
+    // One histogram over all pins
+    for (int bucket = 0; bucket < BM_LATENCY_BUCKETS; bucket++)
+    {
+        hits.buckets[bucket] += misses.buckets[bucket];
+    }
+    hits.count += misses.count;
+    hits.sumNanos += misses.sumNanos;
+    if (misses.maxNanos > hits.maxNanos)
+    {
+        hits.maxNanos = misses.maxNanos;
+    }
+
+    long pins = (after.hits - before.hits) + (after.misses - before.misses);
+    writeResult("pool", strategy->name, poolSize, workload, operations, seconds,
+                (double)(after.bytesRead - before.bytesRead + after.bytesWritten - before.bytesWritten) / (1024 * 1024),
+                (pins > 0) ? (double)(after.hits - before.hits) / pins : 0.0,
+                latencyPercentile(&hits, 50), latencyPercentile(&hits, 99), latencyPercentile(&hits, 99.9));
+}
+
+/// Storage Manager ///
+
+static void benchmarkStorage(const char *workload, int numPages, bool writing, bool randomOrder)
+{
+    SM_FileHandle fileHandle;
+    PageNumber *pages = (PageNumber *)malloc(sizeof(PageNumber) * numPages);
+    SM_PageHandle buffer = (SM_PageHandle)calloc(PAGE_SIZE, 1);
+
+    if (pages == NULL || buffer == NULL || openPageFile(BENCH_FILE, &fileHandle) != RC_OK)
+    {
+        fprintf(stderr, "unable to open %s\n", BENCH_FILE);
+        free(pages);
+        free(buffer);
+        return;
+    }
+    for (int i = 0; i < numPages; i++)
+    {
+        pages[i] = i;
+    }
+    if (randomOrder)
+    {
+        shuffle(pages, numPages);
+    }
+
+    double start = nowSeconds();
+    for (int i = 0; i < numPages; i++)
+    {
+        if (writing)
+        {
+            writeBlock(pages[i], &fileHandle, buffer);
+        }
+        else
+        {
+            readBlock(pages[i], &fileHandle, buffer);
+        }
+    }
+    double seconds = nowSeconds() - start;
+    closePageFile(&fileHandle);
+
+    writeResult("storage", "-", 0, workload, numPages, seconds, (double)numPages * PAGE_SIZE / (1024 * 1024),
+                0.0, 0, 0, 0);
+    free(pages);
+    free(buffer);
+}
+
+int main(int argc, char **argv)
+{
+    const char *resultFile = "bench_results.csv";
+    int operations = DEFAULT_OPERATIONS;
+    int poolSizes[MAX_POOL_SIZES];
+    int numPoolSizes = 0;
+
+    for (int arg = 1; arg < argc; arg += 2)
+    {
+        if (arg + 1 == argc)
+        {
+            fprintf(stderr, "usage: %s [-o results.csv] [-n operations] [-s poolSize ...]\n", argv[0]);
+            return 1;
+        }
+        else if (strcmp(argv[arg], "-o") == 0)
+        {
+            resultFile = argv[arg + 1];
+        }
+        else if (strcmp(argv[arg], "-n") == 0 && atoi(argv[arg + 1]) > 0)
+        {
+            operations = atoi(argv[arg + 1]);
+        }
+        else if (strcmp(argv[arg], "-s") == 0 && atoi(argv[arg + 1]) > 0 && numPoolSizes < MAX_POOL_SIZES)
+        {
+            poolSizes[numPoolSizes++] = atoi(argv[arg + 1]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-o results.csv] [-n operations] [-s poolSize ...]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (numPoolSizes == 0)
+    {
+        poolSizes[numPoolSizes++] = 64;
+        poolSizes[numPoolSizes++] = 1024;
+    }
+
+    // The miss workload cycles through eight times the largest pool
+    int filePages = 0;
+    for (int i = 0; i < numPoolSizes; i++)
+    {
+        if (8 * poolSizes[i] > filePages)
+        {
+            filePages = 8 * poolSizes[i];
+        }
+    }
+    SM_FileHandle fileHandle;
+    results = fopen(resultFile, "w");
+    if (results == NULL || createPageFile(BENCH_FILE) != RC_OK || openPageFile(BENCH_FILE, &fileHandle) != RC_OK ||
+        ensureCapacity(filePages, &fileHandle) != RC_OK)
+    {
+        fprintf(stderr, "unable to create %s or %s\n", resultFile, BENCH_FILE);
+        return 1;
+    }
+    closePageFile(&fileHandle);
+
+    fputs(CSV_HEADER, stdout);
+    fputs(CSV_HEADER, results);
+
+    benchmarkStorage("sequentialWrite", filePages, true, false);
+    benchmarkStorage("sequentialRead", filePages, false, false);
+    benchmarkStorage("randomWrite", filePages, true, true);
+    benchmarkStorage("randomRead", filePages, false, true);
+
+    for (int s = 0; s < numPoolSizes; s++)
+    {
+        for (int i = 0; i < (int)(sizeof(strategies) / sizeof(strategies[0])); i++)
+        {
+            for (int w = 0; w < (int)(sizeof(workloads) / sizeof(workloads[0])); w++)
+            {
+                benchmarkPool(&strategies[i], poolSizes[s], workloads[w], operations);
+            }
+        }
+    }
+
+    fclose(results);
+    destroyPageFile(BENCH_FILE);
+    return 0;
+}
@@ -3,820 +3,5257 @@
 #include "unistd.h"
 #include "stdlib.h"
 #include "string.h"
+#include "time.h"
+#include "errno.h"
+#include "pthread.h"
+#include "stdatomic.h"
+#include "sys/mman.h"
 #include "dt.h"
 #include "storage_mgr.h"
 #include "buffer_mgr.h"
 #include "test_helper.h"
 
+#define NO_FRAME -1
+#define NUM_PAGE_TABLE_SHARDS 16
+#define MAX_PAGES_PER_WRITE 256 // longest run of pages a flush writes with one call
+#define READ_AHEAD_TRIGGER_MISSES 2 // consecutive sequential misses that start read-ahead
+#define READ_AHEAD_MIN_PAGES 4 // first read-ahead window of a scan
+#define READ_AHEAD_MAX_PAGES 64 // the window doubles up to this, and up to an eighth of the pool
+#define NUM_IO_THREADS 2 // threads serving the reads of pinPageAsync, started with the first one
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024) // frame arenas at least this large try huge pages first
+#define MAX_POOL_FRAMES ((sizeof(size_t) > 4) ? (1 << 22) : (1 << 16)) // address space reserved per pool, see resizeBufferPool
+#define DEFAULT_SCAN_RING_SIZE 8 // frames a scan recycles unless beginScan asks for another number
+#define MAX_LATENCY_NANOS ((1LL << 40) - 1) // longer latencies are counted in the last histogram bucket
+#define TRACE_BUFFER_RECORDS 4096 // pin trace records collected before they are written out
+#define WARMUP_BATCH_PAGES 1024 // snapshot pages startPoolWarmup sorts and reads together, the hottest batch first
+
+// Identifiers of the frame lists a frame can be linked into
+#define NO_LIST -1
+#define FREE_LIST 0
+#define REPLACEMENT_LIST 1
+#define RECENT_LIST 2 // ARC T1 / 2Q A1in
+#define FREQUENT_LIST 3 // ARC T2 / 2Q Am
+#define FIRST_FREQUENCY_LIST 4 // LFU frequency node i owns lists 4 + 2i (unpinned) and 5 + 2i (pinned)
+
 // Single Frame Structure
-typedef struct PageFrameNode ;
-PageFrameNode
+typedef struct PageFrameNode
 {
-    int FixCount;
-    SM_PageHandle readContent;
+    atomic_int FixCount; // -1 while the frame holds no page or is claimed for eviction, pins never move it off -1
+    SM_PageHandle readContent; // PAGE_SIZE slot of the pool's frame arena, or the page inside the file mapping
     bool DirtyFlag;
-    bool UsedFlag; // for clock strategy
-    int FrameNum; 
-    BM_PageHandle* bh; 
+    atomic_int UsedFlag; // for clock strategy, set on hits without taking any latch
+    int FrameNum;
+    pthread_mutex_t latch; // protects DirtyFlag and the page number of the frame, claims and I/O waits
+    pthread_cond_t ioDone; // signalled when IoInProgress is cleared
+    atomic_bool IoInProgress; // the thread that claimed the frame is still writing back or reading it
+    atomic_int ReadAheadMark; // first page of a read-ahead window, pinning it reads the next window
+    BM_PinRequest *ioWaiters; // asynchronous pins waiting for the read of the page, guarded by the latch
+    RC ReadError; // set while IoInProgress once the read of the page failed, guarded by the latch
+    BM_PageHandle* bh; // points at handle
+    BM_PageHandle handle;
+    int Prev; // neighbours in the frame list holding this frame
+    int Next;
+    int ListId; // list the frame is linked into, NO_LIST if none
+    int HistoryIndex; // LRU-K reference history of the resident page
+    int HeapPos; // position in the LRU-K heap, NO_FRAME while pinned
+    int FrequencyNode; // LFU frequency node holding the frame
 } PageFrameNode;
 
-// Structure to store page-frame pairs
-typedef struct Queue {
-    int frameNumber; 
-    int pageNumber; 
-} Queue;
-
-//Metadata for storing frame information
+// Intrusive doubly-linked list of frames threaded through PageFrameNode Prev/Next
+typedef struct FrameList {
+    int head; // most recently linked frame
+    int tail; // least recently linked frame
+    int size;
+    int id;
+} FrameList;
+
+// Slot of the page table, the page number in the high half and the frame index in the low half.
+// Both are read and written together, so a lookup without the shard latch never sees a torn pair
+typedef atomic_ullong PageTableEntry;
+#define EMPTY_PAGE_TABLE_ENTRY makePageTableEntry(NO_PAGE, NO_PAGE)
+
+// Open-addressing (linear probing) map from page number to frame index
+typedef struct PageTable {
+    PageTableEntry *entries;
+    int capacity; // always a power of two
+    int mask;
+    struct PageTable *nextRetired; // see PageTableShard
+} PageTable;
+
+// Independently latched part of the page table, pages are spread over the shards by hash.
+// Growing the pool replaces the table; latch-free lookups may still read the old one, so it is kept until shutdown
+typedef struct PageTableShard {
+    pthread_mutex_t latch;
+    _Atomic(PageTable *) table;
+    PageTable *retired;
+} PageTableShard;
+
+// Reference history of one page for LRU-K, kept for a while after the page is evicted
+typedef struct PageHistory {
+    PageNumber pageNumber;
+    long *references; // last k reference times, most recent first, 0 if not referenced that often
+    bool Resident;
+    int Prev; // neighbours in the retained list while the page is not resident
+    int Next;
+} PageHistory;
+
+// LRU-K bookkeeping of a pool
+typedef struct LRUKState {
+    long referenceClock; // logical time, advanced on every page reference
+    PageHistory *histories;
+    long *referenceTimes; // k slots for every history
+    int numHistories;
+    int historiesUsed; // histories handed out so far
+    PageTable historyTable; // page number -> history index
+    int retainedHead; // history of the most recently evicted page
+    int retainedTail; // history recycled first when a new page needs one
+    int *heap; // unpinned resident frames, the next victim on top, room for numHistories / 2
+    int heapSize;
+} LRUKState;
+
+// Frames referenced the same number of times, for LFU
+typedef struct FrequencyNode {
+    long frequency;
+    FrameList unpinned; // eviction candidates, least recently unpinned at the tail
+    FrameList pinned;
+    int Prev; // neighbouring nodes, ordered by increasing frequency
+    int Next;
+} FrequencyNode;
+
+// LFU bookkeeping of a pool
+typedef struct LFUState {
+    FrequencyNode *nodes; // empty nodes are released right away
+    int numNodes;
+    int *freeNodes; // stack of unused node indexes
+    int numFreeNodes;
+    int head; // node with the lowest frequency
+    int agingPeriod; // references between halving all frequencies, 0 disables aging
+    int referencesSinceAging;
+} LFUState;
+
+// Page number of a recently evicted page, remembered by ARC and 2Q
+typedef struct GhostEntry {
+    PageNumber pageNumber;
+    int ListId;
+    int Prev;
+    int Next;
+} GhostEntry;
+
+typedef struct GhostList {
+    int head; // most recently evicted
+    int tail;
+    int size;
+    int id;
+} GhostList;
+
+// ARC and 2Q bookkeeping of a pool. Both keep a recency and a frequency list of
+// resident frames and remember evicted pages so they can tell when they evicted too early
+typedef struct AdaptiveState {
+    FrameList recent; // ARC T1, 2Q A1in
+    FrameList frequent; // ARC T2, 2Q Am
+    GhostList recentGhosts; // ARC B1, 2Q A1out
+    GhostList frequentGhosts; // ARC B2, unused by 2Q
+    GhostEntry *ghosts;
+    int numGhosts;
+    int *freeGhosts;
+    int numFreeGhosts;
+    PageTable ghostTable; // page number -> ghost entry
+    int target; // ARC: target size of T1, 2Q: target size of A1in
+    int maxTarget;
+    int ghostLimit; // 2Q: size of A1out
+} AdaptiveState;
+
+// Page and frame of a batched flush or a batched pin, sorted by page number
+typedef struct FlushEntry {
+    PageNumber pageNum;
+    int frameNum;
+} FlushEntry;
+
+// Latency histogram of one code path, updated with relaxed atomics from any thread
+typedef struct LatencyCounters {
+    atomic_llong count;
+    atomic_llong sumNanos;
+    atomic_llong maxNanos;
+    atomic_llong buckets[BM_LATENCY_BUCKETS];
+} LatencyCounters;
+
+//Metadata for storing frame information, one per buffer pool (kept in bm->mgmtData)
 typedef struct PageFrameMD
 {    
-void *queue; 
+PageFrameNode *frames; // dense metadata array, frame i owns bytes [i * PAGE_SIZE, (i + 1) * PAGE_SIZE) of frameArena
+size_t FrameNodesReserved; // address space of frames, room for ReservedFrames, never moves
+size_t FrameNodesCommitted; // bytes of it that are readable and writable
+int ReservedFrames; // largest size the pool can be resized to
+int FramesInitialized; // frames whose latches are set up, released frames keep theirs
+char *frameArena; // page-aligned data of all frames, inside a reservation for ReservedFrames
+char *frameArenaReservation;
+size_t FrameArenaReserved;
+size_t FrameArenaSize; // bytes mapped, rounded up to the huge page size when huge pages are used
+bool FrameArenaHugePages; // the start of the arena is backed by explicit 2 MB huge pages
+int PageTableFrames; // frames the page table shards are sized for
+FrameList freeList; // frames that hold no page yet
+FrameList replacementList; // FIFO: every resident frame in load order, LRU: unpinned frames in recency order
 int NumberOfFramesFilled;   
-int NumberOfFrames;  
-} PageFrameMD; 
-
-// Global variables //
-//Variables to store read/write
-int NoOfWrites;
-int NoOfReads;
+atomic_int NumberOfFrames; // changed by resizeBufferPool under the replacement latch, bm->numPages follows it
+PageTableShard pageTable[NUM_PAGE_TABLE_SHARDS]; // page number -> frame index for resident pages
+
+// Lock order: replacementLatch or a shard latch first, frame latches last, fileLatch on its own
+pthread_mutex_t replacementLatch; // free list, strategy bookkeeping and victim selection
+pthread_mutex_t fileLatch; // the storage manager is not thread safe, guards files
+SM_FileHandle files[BM_MAX_PAGE_FILES]; // page files by file id, file 0 is opened by initBufferPool, see registerPageFile
+bool MappedFrames; // frames point into the file mapping instead of copying pages, guarded by fileLatch
+
+//Variables to store read/write, see getPoolStats
+atomic_int NoOfWrites; // pages written to disk
+atomic_int NoOfReads; // pages read from disk, read-ahead included
+atomic_long NoOfReadCalls; // storage manager calls for them, pages of mapped frames take none
+atomic_long NoOfWriteCalls;
+atomic_long BytesRead;
+atomic_long BytesWritten;
+atomic_long NoOfHits;
+atomic_long NoOfMisses;
+atomic_long NoOfCleanEvictions;
+atomic_long NoOfDirtyEvictions;
+atomic_long NoOfFlushes;
+atomic_long NoOfPinFailures;
+atomic_bool LatencyTracking; // see enableLatencyHistograms
+LatencyCounters latency[BM_NUM_LATENCY_KINDS];
+
+// Pin trace, see startPinTrace
+atomic_bool Tracing; // lets untraced pools skip the trace latch
+pthread_mutex_t traceLatch; // guards the fields below and keeps the records in timestamp order
+FILE *traceFile; // NULL while no trace is recorded
+BM_TraceRecord *traceBuffer;
+int TraceBuffered;
+bool TraceWriteFailed;
+long long TraceStart;
+int LastFlushPages; // pages written by the last forceFlushPool
+int LastFlushWriteCalls; // write calls it took for them
 
 //variable k used in LRU_K stratergy
 int k;
+LRUKState lruK;
+LFUState lfu;
+AdaptiveState adaptive;
+
+int clockPosition; // clock hand remembers positions between evictions 
+
+// Background page cleaner, see startPageCleaner
+atomic_int NumberOfDirtyFrames; // changed together with DirtyFlag, under the frame latch
+atomic_int CleanerHighWatermark; // dirty frames that wake the cleaner up, 0 while no cleaner runs
+int CleanerLowWatermark; // dirty frames the cleaner writes back down to
+bool CleanerStopping;
+pthread_t cleanerThread;
+pthread_mutex_t cleanerLatch; // guards CleanerStopping and orders cleanerWakeup
+pthread_cond_t cleanerWakeup;
+int *cleanerOrder; // frames in the order they are going to be evicted, scratch space of the cleaner
+int CleanerOrderSize; // grown by the cleaner itself once the pool has grown
+RC CleanerError; // first write-back of the cleaner that failed, reported by stopPageCleaner
+
+// Sequential read-ahead, see detectSequentialMiss
+pthread_mutex_t readAheadLatch; // guards the stream fields below
+PageNumber NextSequentialPage; // page a scan is expected to miss on next
+int SequentialMisses; // consecutive misses that continued the scan
+int ReadAheadWindow; // pages to read ahead next time
+PageNumber ReadAheadNext; // first page after the last read-ahead window
+atomic_bool ReadAheadDisabled; // see disableReadAhead
+
+// Asynchronous pins, see pinPageAsync
+pthread_mutex_t ioLatch; // guards the read queue and the I/O threads
+pthread_cond_t ioWork;
+BM_PinRequest *ioHead; // reads waiting for an I/O thread
+BM_PinRequest *ioTail;
+pthread_t ioThreads[NUM_IO_THREADS];
+bool IoThreadsStarted;
+int NumberOfIoThreads;
+bool IoStopping;
+pthread_mutex_t completionLatch; // guards the completed queue and PendingPins
+pthread_cond_t completionReady;
+BM_PinRequest *completedHead; // pins waiting to be handed back by pollPinCompletions
+BM_PinRequest *completedTail;
+int PendingPins; // submitted pins not handed back yet
+
+// Warm restarts, see startPoolSnapshots and startPoolWarmup
+pthread_mutex_t snapshotLatch; // guards the snapshot fields, one snapshot is written at a time
+pthread_cond_t snapshotWakeup;
+char *snapshotFile; // NULL while no snapshots are taken, shutdownBufferPool writes the last one
+bool SnapshotStopping;
+bool SnapshotThreadStarted; // snapshots are also taken every SnapshotIntervalMillis
+int SnapshotIntervalMillis;
+pthread_t snapshotThread;
+bool WarmupRunning;
+atomic_bool WarmupStopping;
+pthread_t warmupThread;
+BM_SnapshotRecord *warmupRecords; // pages still to be loaded, hottest first
+int WarmupRecordCount;
+atomic_int WarmupPagesLoaded;
+} PageFrameMD; 
 
-int clockPosition = 0; // clock hand remembers positions between evictions 
-
-struct PageFrameMD pfmd;
+// Returns the bookkeeping of a pool, NULL if the pool is not open
+PageFrameMD *getPoolMetadata(BM_BufferPool *const bm) {
+    return (PageFrameMD *)bm->mgmtData;
+}
 
 RC checkFileExistence(const char *fileName) {
     return (access(fileName, F_OK) != 0) ? RC_FILE_NOT_FOUND : RC_OK;
 }
 
-RC allocatePageFrameNodes(PageFrameNode **nodes, int count) {
-    *nodes = (PageFrameNode *)malloc(sizeof(PageFrameNode) * count);
-    return (*nodes == NULL) ? RC_FILE_NOT_FOUND : RC_OK;
+// File holding a page key, see registerPageFile
+SM_FileHandle *getPageFile(PageFrameMD *pfmd, PageNumber pageKey) {
+    return &pfmd->files[BM_PAGE_FILE_ID(pageKey)];
+}
+
+// Page keys of files that are not registered are refused before they reach the page table
+bool isValidPageKey(PageFrameMD *pfmd, PageNumber pageKey) {
+    return pageKey >= 0 && getPageFile(pfmd, pageKey)->mgmtInfo != NULL;
+}
+
+size_t systemPageSize(void) {
+    long size = sysconf(_SC_PAGESIZE);
+    return (size > 0) ? (size_t)size : PAGE_SIZE;
+}
+
+size_t roundUpTo(size_t size, size_t unit) {
+    return (size + unit - 1) / unit * unit;
+}
+
+// Makes the frame metadata of numPages frames accessible, the rest of the reservation stays unbacked
+RC commitPageFrameNodes(PageFrameMD *pfmd, int numPages) {
+    size_t size = roundUpTo(sizeof(PageFrameNode) * numPages, systemPageSize());
+    if (size <= pfmd->FrameNodesCommitted) {
+        return RC_OK;
+    }
+    if (mprotect((char *)pfmd->frames + pfmd->FrameNodesCommitted, size - pfmd->FrameNodesCommitted,
+                 PROT_READ | PROT_WRITE) != 0) {
+        return RC_FILE_NOT_FOUND;
+    }
+    pfmd->FrameNodesCommitted = size;
+    return RC_OK;
+}
+
+// The metadata array is reserved for the largest size the pool can grow to, so it never moves
+// and latch-free readers can index it while the pool is resized
+RC allocatePageFrameNodes(PageFrameMD *pfmd, int numPages) {
+    size_t reserved = roundUpTo(sizeof(PageFrameNode) * pfmd->ReservedFrames, systemPageSize());
+    void *nodes = mmap(NULL, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (nodes == MAP_FAILED) {
+        return RC_FILE_NOT_FOUND;
+    }
+    pfmd->frames = (PageFrameNode *)nodes;
+    pfmd->FrameNodesReserved = reserved;
+    pfmd->FrameNodesCommitted = 0;
+    return commitPageFrameNodes(pfmd, numPages);
+}
+
+void freePageFrameNodes(PageFrameMD *pfmd) {
+    if (pfmd->frames != NULL) {
+        munmap(pfmd->frames, pfmd->FrameNodesReserved);
+        pfmd->frames = NULL;
+    }
+}
+
+// Maps the arena read-write up to numPages frames, new parts with normal pages advised for transparent huge pages
+RC commitFrameArena(PageFrameMD *pfmd, int numPages) {
+    size_t size = roundUpTo((size_t)numPages * PAGE_SIZE, systemPageSize());
+    if (size <= pfmd->FrameArenaSize) {
+        return RC_OK;
+    }
+
+    char *start = pfmd->frameArena + pfmd->FrameArenaSize;
+    if (mmap(start, size - pfmd->FrameArenaSize, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+        return RC_FILE_NOT_FOUND;
+    }
+#ifdef MADV_HUGEPAGE
+    if (size >= HUGE_PAGE_SIZE) {
+        madvise(start, size - pfmd->FrameArenaSize, MADV_HUGEPAGE);
+    }
+#endif
+    pfmd->FrameArenaSize = size;
+    return RC_OK;
 }
 
-RC allocateQueueMemory(Queue **frameQueue, int count) {
-    *frameQueue = (Queue *)malloc(sizeof(Queue) * count);
-    return (*frameQueue == NULL) ? RC_FILE_NOT_FOUND : RC_OK;
+// Gives the memory of the frames from numPages on back to the system. The address range stays
+// reserved, explicit huge pages can only be returned in whole
+void releaseFrameArena(PageFrameMD *pfmd, int numPages) {
+    size_t unit = pfmd->FrameArenaHugePages ? HUGE_PAGE_SIZE : systemPageSize();
+    size_t keep = roundUpTo((size_t)numPages * PAGE_SIZE, unit);
+
+    if (keep < pfmd->FrameArenaSize &&
+        mmap(pfmd->frameArena + keep, pfmd->FrameArenaSize - keep, PROT_NONE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0) != MAP_FAILED) {
+        pfmd->FrameArenaSize = keep;
+    }
 }
 
-RC initializePageFrameNode(PageFrameNode *node, int index) {
-    node->bh = MAKE_PAGE_HANDLE();
-    node->readContent = (SM_PageHandle)malloc(PAGE_SIZE);
+// Reserves the data of all frames the pool can grow to as one page-aligned region and maps the first numPages.
+// Arenas of 2 MB and more ask for explicit huge pages first and fall back to normal pages, advised for
+// transparent huge pages where available
+RC allocateFrameArena(PageFrameMD *pfmd, int numPages) {
+    size_t size = (size_t)numPages * PAGE_SIZE;
+    size_t reserved = (size_t)pfmd->ReservedFrames * PAGE_SIZE + HUGE_PAGE_SIZE;
 
-    if (node->readContent == NULL) {
+    void *reservation = mmap(NULL, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reservation == MAP_FAILED) {
         return RC_FILE_NOT_FOUND;
     }
+    pfmd->frameArenaReservation = (char *)reservation;
+    pfmd->FrameArenaReserved = reserved;
+    pfmd->frameArena = (char *)roundUpTo((size_t)reservation, HUGE_PAGE_SIZE);
+    pfmd->FrameArenaSize = 0;
+    pfmd->FrameArenaHugePages = false;
+
+#ifdef MAP_HUGETLB
+    if (size >= HUGE_PAGE_SIZE) {
+        size_t hugeSize = roundUpTo(size, HUGE_PAGE_SIZE);
+        if (mmap(pfmd->frameArena, hugeSize, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0) != MAP_FAILED) {
+            pfmd->FrameArenaSize = hugeSize;
+            pfmd->FrameArenaHugePages = true;
+            return RC_OK;
+        }
+    }
+#endif
+
+    return commitFrameArena(pfmd, numPages);
+}
+
+// Own data slot of a frame, used whenever the frame does not point into the file mapping
+SM_PageHandle frameArenaSlot(PageFrameMD *pfmd, int frameNum) {
+    return pfmd->frameArena + (size_t)frameNum * PAGE_SIZE;
+}
+
+void freeFrameArena(PageFrameMD *pfmd) {
+    if (pfmd->frameArenaReservation != NULL) {
+        munmap(pfmd->frameArenaReservation, pfmd->FrameArenaReserved);
+        pfmd->frameArenaReservation = NULL;
+        pfmd->frameArena = NULL;
+    }
+}
+
+// Empties the metadata of a frame. Frames released by a shrink are reset this way when the pool grows again,
+// their latches stay as they are because a stale reader may still take them
+void resetPageFrameNode(PageFrameNode *node, int index, char *arena) {
+    node->bh = &node->handle;
+    node->readContent = arena + (size_t)index * PAGE_SIZE; // frameArenaSlot
 
     node->bh->pageNum = NO_PAGE;
     node->bh->data = NULL;
     node->FrameNum = index;
     node->DirtyFlag = false;
-    node->FixCount = 0;
+    atomic_init(&node->UsedFlag, 0);
+    atomic_init(&node->FixCount, -1); // the frame starts out on the free list
+    atomic_init(&node->IoInProgress, false);
+    atomic_init(&node->ReadAheadMark, 0);
+    node->ioWaiters = NULL;
+    node->ReadError = RC_OK;
+    node->Prev = NO_FRAME;
+    node->Next = NO_FRAME;
+    node->ListId = NO_LIST;
+    node->HistoryIndex = NO_PAGE;
+    node->HeapPos = NO_FRAME;
+    node->FrequencyNode = NO_FRAME;
+}
 
-    return RC_OK;
+void initializePageFrameNode(PageFrameNode *node, int index, char *arena) {
+    resetPageFrameNode(node, index, arena);
+    pthread_mutex_init(&node->latch, NULL);
+    pthread_cond_init(&node->ioDone, NULL);
 }
 
-void resetQueueEntry(Queue *queueEntry) {
-    queueEntry->pageNumber = NO_PAGE;
-    queueEntry->frameNumber = NO_PAGE;
+/// Frame Lists ///
+
+void initFrameList(FrameList *list, int id) {
+    list->head = NO_FRAME;
+    list->tail = NO_FRAME;
+    list->size = 0;
+    list->id = id;
 }
 
-RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, const int numPages, ReplacementStrategy strategy, void *stratData) {
-    NoOfReads = 0;
-    NoOfWrites = 0;
+void linkFrameAtHead(PageFrameNode *frames, FrameList *list, int frameNum) {
+    PageFrameNode *frame = &frames[frameNum];
 
-    if (checkFileExistence(pageFileName) != RC_OK) {
-        return (RC_message = "Unable to locate the specified file.", RC_FILE_NOT_FOUND);
+    frame->Prev = NO_FRAME;
+    frame->Next = list->head;
+    if (list->head != NO_FRAME) {
+        frames[list->head].Prev = frameNum;
+    } else {
+        list->tail = frameNum;
+    }
+    list->head = frameNum;
+    frame->ListId = list->id;
+    list->size++;
+}
+
+// Does nothing if the frame is not linked into this list
+void unlinkFrame(PageFrameNode *frames, FrameList *list, int frameNum) {
+    PageFrameNode *frame = &frames[frameNum];
+    if (frame->ListId != list->id) {
+        return;
     }
 
-    PageFrameNode *pageFrameNodes;
-    Queue *frameQueue;
+    if (frame->Prev != NO_FRAME) {
+        frames[frame->Prev].Next = frame->Next;
+    } else {
+        list->head = frame->Next;
+    }
+    if (frame->Next != NO_FRAME) {
+        frames[frame->Next].Prev = frame->Prev;
+    } else {
+        list->tail = frame->Prev;
+    }
 
-    if (allocatePageFrameNodes(&pageFrameNodes, numPages) != RC_OK) return RC_FILE_NOT_FOUND;
+    frame->Prev = NO_FRAME;
+    frame->Next = NO_FRAME;
+    frame->ListId = NO_LIST;
+    list->size--;
+}
 
-    if (allocateQueueMemory(&frameQueue, numPages) != RC_OK) {
-        free(pageFrameNodes);
-        return RC_FILE_NOT_FOUND;
+void moveFrameToHead(PageFrameNode *frames, FrameList *list, int frameNum) {
+    unlinkFrame(frames, list, frameNum);
+    linkFrameAtHead(frames, list, frameNum);
+}
+
+// Links frame to into the place of frame from, which leaves the list
+void replaceFrameInList(PageFrameNode *frames, FrameList *list, int from, int to) {
+    PageFrameNode *source = &frames[from];
+    PageFrameNode *target = &frames[to];
+
+    target->Prev = source->Prev;
+    target->Next = source->Next;
+    target->ListId = list->id;
+    if (source->Prev != NO_FRAME) {
+        frames[source->Prev].Next = to;
+    } else {
+        list->head = to;
+    }
+    if (source->Next != NO_FRAME) {
+        frames[source->Next].Prev = to;
+    } else {
+        list->tail = to;
     }
 
-    for (int index = 0; index < numPages; index++) {
-        // Initialize the page frame node
-        RC rc = initializePageFrameNode(&pageFrameNodes[index], index);
-        if (rc != RC_OK) {
-            free(pageFrameNodes);
-            free(frameQueue);
-            return rc; // Handle allocation failure
-        }
+    source->Prev = NO_FRAME;
+    source->Next = NO_FRAME;
+    source->ListId = NO_LIST;
+}
 
-        // Reset the corresponding entry in the frame queue
-        resetQueueEntry(&frameQueue[index]);
+// Removes and returns the tail frame, NO_FRAME if the list is empty
+int popFrameAtTail(PageFrameNode *frames, FrameList *list) {
+    int frameNum = list->tail;
+    if (frameNum != NO_FRAME) {
+        unlinkFrame(frames, list, frameNum);
     }
+    return frameNum;
+}
 
-    // Assign values to the buffer pool structure
-    bm->numPages = numPages;
-    bm->pageFile = (char *)pageFileName;
-    bm->strategy = strategy;
-    bm->mgmtData = pageFrameNodes;
+/// Page Table ///
 
-    // Initialize the page frame metadata structure
-    pfmd.NumberOfFrames = numPages;
-    pfmd.NumberOfFramesFilled = 0;
-    pfmd.queue = frameQueue;
+unsigned long long makePageTableEntry(PageNumber pageNum, int frameNumber) {
+    return ((unsigned long long)(unsigned int)pageNum << 32) | (unsigned int)frameNumber;
+}
 
-    return RC_OK;
+PageNumber entryPageNumber(unsigned long long entry) {
+    return (PageNumber)(int)(unsigned int)(entry >> 32);
 }
 
-//shutting down buffer bool 
-#include <stdlib.h>
+int entryFrameNumber(unsigned long long entry) {
+    return (int)(unsigned int)entry;
+}
+
+// Writers hold the shard latch, which orders their stores. Latch-free readers validate
+// what they find against the frame, so relaxed accesses are enough
+unsigned long long loadPageTableEntry(const PageTable *table, int slot) {
+    return atomic_load_explicit(&table->entries[slot], memory_order_relaxed);
+}
+
+void storePageTableEntry(PageTable *table, int slot, unsigned long long entry) {
+    atomic_store_explicit(&table->entries[slot], entry, memory_order_relaxed);
+}
+
+// Sizes the table to at least twice the number of frames so probe chains stay short
+RC initPageTable(PageTable *table, int numPages) {
+    int capacity = 8;
+    while (capacity < 2 * numPages) {
+        capacity <<= 1;
+    }
+
+    table->entries = (PageTableEntry *)malloc(sizeof(PageTableEntry) * capacity);
+    if (table->entries == NULL) {
+        return RC_FILE_NOT_FOUND;
+    }
+
+    for (int slot = 0; slot < capacity; slot++) {
+        atomic_init(&table->entries[slot], EMPTY_PAGE_TABLE_ENTRY);
+    }
+    table->capacity = capacity;
+    table->mask = capacity - 1;
 
-RC freePageFrameResources(PageFrameNode *frame) {
-    free(frame->bh);
-    free(frame->readContent);
     return RC_OK;
 }
 
-RC flushDirtyPages(BM_BufferPool *const bm, PageFrameNode *pageFrames, int numPages) {
-    bool flushRequired = false;
+void freePageTable(PageTable *table) {
+    free(table->entries);
+    table->entries = NULL;
+    table->capacity = 0;
+    table->mask = 0;
+}
+
+// Fibonacci hashing spreads sequential page numbers over the whole table
+int hashPageNumber(const PageTable *table, PageNumber pageNum) {
+    unsigned int hash = (unsigned int)pageNum * 2654435769u;
+    return (int)((hash ^ (hash >> 16)) & (unsigned int)table->mask);
+}
+
+// Returns the frame holding pageNum, or NO_PAGE if the page is not resident.
+// Without the latch the result is only a hint: a page being shifted by a concurrent removal
+// can be missed, and a returned frame may have been refilled since the pair was read
+int lookupPageTable(const PageTable *table, PageNumber pageNum) {
+    int slot = hashPageNumber(table, pageNum);
 
-    for (int i = 0; i < numPages; i++) {
-        if (pageFrames[i].DirtyFlag) {
-            forcePage(bm, pageFrames[i].bh);
-            flushRequired = true;
+    // Bounded, so a reader racing with writers cannot probe forever
+    for (int probes = 0; probes < table->capacity; probes++) {
+        unsigned long long entry = loadPageTableEntry(table, slot);
+        if (entryPageNumber(entry) == NO_PAGE) {
+            break;
+        }
+        if (entryPageNumber(entry) == pageNum) {
+            return entryFrameNumber(entry);
         }
+        slot = (slot + 1) & table->mask;
     }
 
-    return flushRequired;
+    return NO_PAGE;
 }
 
-RC shutdownBufferPool(BM_BufferPool *const bm) {
-    if (bm->mgmtData == NULL) {
-        RC_message = "Shut down was unsuccessful as buffer pool does not exist.";
-        return RC_FILE_NOT_FOUND;
+void insertPageTable(PageTable *table, PageNumber pageNum, int frameNumber) {
+    int slot = hashPageNumber(table, pageNum);
+
+    while (entryPageNumber(loadPageTableEntry(table, slot)) != NO_PAGE &&
+           entryPageNumber(loadPageTableEntry(table, slot)) != pageNum) {
+        slot = (slot + 1) & table->mask;
     }
 
-    PageFrameNode *pageFrames = (PageFrameNode *)bm->mgmtData;
-    
-    // Flush dirty pages if any
-    bool flushRequired = flushDirtyPages(bm, pageFrames, bm->numPages);
+    storePageTableEntry(table, slot, makePageTableEntry(pageNum, frameNumber));
+}
 
-    // Free memory allocated for each page frame
-    for (int i = 0; i < bm->numPages; i++) {
-        freePageFrameResources(&pageFrames[i]);
-    }
+// Backward-shift deletion keeps probe chains intact without tombstones. An entry is copied
+// to its new slot before its old slot is reused, so latch-free readers at worst miss it
+void removePageTable(PageTable *table, PageNumber pageNum) {
+    int slot = hashPageNumber(table, pageNum);
 
-    // Free queue and buffer pool management data
-    free(pfmd.queue);
-    free(bm->mgmtData);
+    while (entryPageNumber(loadPageTableEntry(table, slot)) != pageNum) {
+        if (entryPageNumber(loadPageTableEntry(table, slot)) == NO_PAGE) {
+            return;
+        }
+        slot = (slot + 1) & table->mask;
+    }
 
-    // Reset buffer pool properties
-    bm->mgmtData = NULL;
-    bm->numPages = 0;
-    NoOfReads = 0;
-    NoOfWrites = 0;
+    int next = (slot + 1) & table->mask;
+    unsigned long long entry;
+    while (entryPageNumber(entry = loadPageTableEntry(table, next)) != NO_PAGE) {
+        int home = hashPageNumber(table, entryPageNumber(entry));
 
-    // Set shutdown message based on flush status
-       // Set the shutdown message based on whether flushing was required
-    if (flushRequired) {
-        RC_message = "Shut down successful with flushing dirty pages.";
-    } else {
-        RC_message = "Shut down successful without flushing any pages.";
+        // Move the entry back if the hole lies between its home slot and its current slot
+        if (((next - home) & table->mask) >= ((next - slot) & table->mask)) {
+            storePageTableEntry(table, slot, entry);
+            slot = next;
+        }
+        next = (next + 1) & table->mask;
     }
 
-    
-    return RC_OK;
+    storePageTableEntry(table, slot, EMPTY_PAGE_TABLE_ENTRY);
 }
 
+// Copies every entry of a table into another one
+void copyPageTable(const PageTable *from, PageTable *to) {
+    for (int slot = 0; slot < from->capacity; slot++) {
+        unsigned long long entry = loadPageTableEntry(from, slot);
+        if (entryPageNumber(entry) != NO_PAGE) {
+            insertPageTable(to, entryPageNumber(entry), entryFrameNumber(entry));
+        }
+    }
+}
 
-// Flushing all dirty Pages
-RC forceFlushPool(BM_BufferPool *const bm)
-{
-    // Validate if the buffer pool exists before proceeding
-    if (bm->mgmtData == NULL)
-    {
-        RC_message = "Buffer pool does not exist. Force flush unsuccessful.";
+// Rebuilds a table nobody reads without a latch for numPages entries
+RC resizePageTable(PageTable *table, int numPages) {
+    PageTable grown;
+    if (initPageTable(&grown, numPages) != RC_OK) {
         return RC_FILE_NOT_FOUND;
     }
+    copyPageTable(table, &grown);
+    freePageTable(table);
+    *table = grown;
+    return RC_OK;
+}
 
-    PageFrameNode *pageFrameList = (PageFrameNode *)bm->mgmtData;
-    bool flushSuccessful = true;
+PageTable *allocatePageTable(int numPages) {
+    PageTable *table = (PageTable *)malloc(sizeof(PageTable));
+    if (table == NULL || initPageTable(table, numPages) != RC_OK) {
+        free(table);
+        return NULL;
+    }
+    table->nextRetired = NULL;
+    return table;
+}
 
-    // Loop through all page frames in the buffer pool
-    for (int pageIndex = 0; pageIndex < bm->numPages; pageIndex++)
-    {
-        // If the page is dirty and not in use, flush it
-        if (pageFrameList[pageIndex].DirtyFlag == 1 && pageFrameList[pageIndex].FixCount == 0)
-        {
-            RC flushResult = forcePage(bm, pageFrameList[pageIndex].bh);
-            if (flushResult != RC_OK)
-            {
-                flushSuccessful = false;
-                RC_message = "Unable to flush all pages. Force flush failed.";
-                break;
-            }
+// The table of a shard. Writers hold the shard latch, latch-free readers may get a table that a resize
+// has just replaced, which is only a stale hint like any other latch-free lookup
+PageTable *getShardTable(PageTableShard *shard) {
+    return atomic_load_explicit(&shard->table, memory_order_acquire);
+}
+
+// Every shard is sized for the whole pool, so a skewed set of page numbers cannot overflow one
+RC initPageTableShards(PageTableShard *shards, int numPages) {
+    for (int index = 0; index < NUM_PAGE_TABLE_SHARDS; index++) {
+        PageTable *table = allocatePageTable(numPages);
+        if (table == NULL) {
+            return RC_FILE_NOT_FOUND;
         }
+        atomic_init(&shards[index].table, table);
+        shards[index].retired = NULL;
+        pthread_mutex_init(&shards[index].latch, NULL);
     }
+    return RC_OK;
+}
 
-    // Return the appropriate result after attempting to flush
-    if (flushSuccessful)
-    {
-        RC_message = "Force flush completed successfully.";
-        return RC_OK;
+// Replaces the table of every shard with one sized for numPages frames
+RC growPageTableShards(PageTableShard *shards, int numPages) {
+    for (int index = 0; index < NUM_PAGE_TABLE_SHARDS; index++) {
+        PageTable *grown = allocatePageTable(numPages);
+        if (grown == NULL) {
+            return RC_FILE_NOT_FOUND;
+        }
+
+        pthread_mutex_lock(&shards[index].latch);
+        PageTable *table = getShardTable(&shards[index]);
+        copyPageTable(table, grown);
+        atomic_store_explicit(&shards[index].table, grown, memory_order_release);
+        table->nextRetired = shards[index].retired;
+        shards[index].retired = table;
+        pthread_mutex_unlock(&shards[index].latch);
     }
-    else
-    {
-        return RC_FILE_NOT_FOUND;
+    return RC_OK;
+}
+
+void freePageTableShards(PageTableShard *shards) {
+    for (int index = 0; index < NUM_PAGE_TABLE_SHARDS; index++) {
+        PageTable *table = atomic_load(&shards[index].table);
+        if (table == NULL) {
+            continue;
+        }
+        pthread_mutex_destroy(&shards[index].latch);
+        while (table != NULL) {
+            PageTable *next = (table == atomic_load(&shards[index].table)) ? shards[index].retired : table->nextRetired;
+            freePageTable(table);
+            free(table);
+            table = next;
+        }
     }
 }
 
+// The top bits of the Fibonacci hash pick the shard, so strided page numbers do not pile up in one
+PageTableShard *getPageTableShard(PageFrameMD *pfmd, PageNumber pageNum) {
+    unsigned int hash = (unsigned int)pageNum * 2654435769u;
+    return &pfmd->pageTable[hash >> 28];
+}
 
+/// Frame Latches ///
 
-/// Interface Access Pages///
+// Only frames holding a page are eviction candidates, free frames are handed out through the free list.
+// Must be called with the frame latch held
+bool isFrameEvictableLocked(PageFrameNode *frame) {
+    return atomic_load(&frame->FixCount) == 0 && !atomic_load(&frame->IoInProgress) && frame->bh->pageNum != NO_PAGE;
+}
 
-// write the current content of the page back to the page file on disk
-RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page)
-{
-    // Validate if the buffer pool's management data exists
-    if (bm->mgmtData == NULL)
-    {
-        RC_message = "Buffer pool not found.";
-        return RC_FILE_NOT_FOUND;
+bool isFrameEvictable(PageFrameNode *frame) {
+    pthread_mutex_lock(&frame->latch);
+    bool evictable = isFrameEvictableLocked(frame);
+    pthread_mutex_unlock(&frame->latch);
+    return evictable;
+}
+
+// Takes exclusive ownership of an unpinned frame for eviction. The fix count of -1 keeps
+// everybody else away until the frame has been refilled. Pins do not take the latch,
+// so the fix count can only be taken from 0 by a compare-and-swap
+bool tryClaimFrame(PageFrameNode *frame) {
+    int unpinned = 0;
+
+    pthread_mutex_lock(&frame->latch);
+    bool claimed = !atomic_load(&frame->IoInProgress) && frame->bh->pageNum != NO_PAGE &&
+        atomic_compare_exchange_strong(&frame->FixCount, &unpinned, -1);
+    if (claimed) {
+        atomic_store(&frame->IoInProgress, true);
     }
+    pthread_mutex_unlock(&frame->latch);
+    return claimed;
+}
 
-    PageFrameNode *pageFrameList = (PageFrameNode *)bm->mgmtData;
-    SM_FileHandle fileHandle;
-    bool pageFound = false;
-    int targetFrameIndex = -1;
+// Claims a frame like tryClaimFrame, but only while it still holds pageNum
+bool tryClaimFrameHolding(PageFrameNode *frame, PageNumber pageNum) {
+    int unpinned = 0;
 
-    // Loop through the buffer pool to find the matching dirty page
-    for (int frameIndex = 0; frameIndex < bm->numPages; frameIndex++)
-    {
-        if (pageFrameList[frameIndex].bh->pageNum == page->pageNum &&
-            pageFrameList[frameIndex].DirtyFlag == 1)
-        {
-            targetFrameIndex = frameIndex;
-            pageFound = true;
-            break;
+    pthread_mutex_lock(&frame->latch);
+    bool claimed = !atomic_load(&frame->IoInProgress) && frame->bh->pageNum == pageNum && pageNum != NO_PAGE &&
+        atomic_compare_exchange_strong(&frame->FixCount, &unpinned, -1);
+    if (claimed) {
+        atomic_store(&frame->IoInProgress, true);
+    }
+    pthread_mutex_unlock(&frame->latch);
+    return claimed;
+}
+
+// Adds a pin unless the frame is claimed, without taking any latch
+bool tryPinFrame(PageFrameNode *frame) {
+    int fixCount = atomic_load(&frame->FixCount);
+    while (fixCount >= 0) {
+        if (atomic_compare_exchange_weak(&frame->FixCount, &fixCount, fixCount + 1)) {
+            return true;
         }
     }
+    return false;
+}
 
-    // Return error if the target page is not dirty
-    if (!pageFound)
-    {
-        RC_message = "The given page number is not marked as dirty.";
+// Drops a pin if the frame has one. Returns the remaining fix count, or -1 if there was no pin
+int tryUnpinFrame(PageFrameNode *frame) {
+    int fixCount = atomic_load(&frame->FixCount);
+    while (fixCount > 0) {
+        if (atomic_compare_exchange_weak(&frame->FixCount, &fixCount, fixCount - 1)) {
+            return fixCount - 1;
+        }
+    }
+    return -1;
+}
+
+// Must be called with the frame latch held
+void waitForFrameIo(PageFrameNode *frame) {
+    while (atomic_load(&frame->IoInProgress)) {
+        pthread_cond_wait(&frame->ioDone, &frame->latch);
+    }
+}
+
+// Wakes up the threads waiting for the owner of the frame to finish its write-back or read.
+// Returns the asynchronous pins that joined the read, for completePinRequests
+BM_PinRequest *finishFrameIo(PageFrameNode *frame) {
+    pthread_mutex_lock(&frame->latch);
+    atomic_store(&frame->IoInProgress, false);
+    pthread_cond_broadcast(&frame->ioDone);
+    BM_PinRequest *waiters = frame->ioWaiters;
+    frame->ioWaiters = NULL;
+    pthread_mutex_unlock(&frame->latch);
+    return waiters;
+}
+
+// Hands a chain of finished asynchronous pins (linked through next) to pollPinCompletions.
+// Every request already holds its pin on request->frameNum, unless its rc says the pin failed
+void completePinRequests(BM_BufferPool *const bm, BM_PinRequest *requests) {
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+
+    if (requests == NULL) {
+        return;
+    }
+
+    BM_PinRequest *last = requests;
+    for (BM_PinRequest *request = requests; request != NULL; request = request->next) {
+        if (request->rc == RC_OK) {
+            request->page->pageNum = request->pageNum;
+            request->page->data = pfmd->frames[request->frameNum].readContent;
+        }
+        last = request;
+    }
+
+    pthread_mutex_lock(&pfmd->completionLatch);
+    if (pfmd->completedTail != NULL) {
+        pfmd->completedTail->next = requests;
+    } else {
+        pfmd->completedHead = requests;
+    }
+    pfmd->completedTail = last;
+    pthread_cond_broadcast(&pfmd->completionReady);
+    pthread_mutex_unlock(&pfmd->completionLatch);
+}
+
+/// LRU-K ///
+
+// Histories are kept for twice as many pages as there are frames,
+// so at least as many evicted pages as resident ones are remembered
+RC initLRUKState(LRUKState *state, int numPages, int k) {
+    state->referenceClock = 0;
+    state->numHistories = 2 * numPages;
+    state->historiesUsed = 0;
+    state->retainedHead = NO_PAGE;
+    state->retainedTail = NO_PAGE;
+    state->heapSize = 0;
+
+    state->histories = (PageHistory *)malloc(sizeof(PageHistory) * state->numHistories);
+    state->referenceTimes = (long *)calloc((size_t)state->numHistories * k, sizeof(long));
+    state->heap = (int *)malloc(sizeof(int) * numPages);
+    if (state->histories == NULL || state->referenceTimes == NULL || state->heap == NULL ||
+        initPageTable(&state->historyTable, state->numHistories) != RC_OK) {
+        free(state->histories);
+        free(state->referenceTimes);
+        free(state->heap);
+        state->histories = NULL;
+        state->referenceTimes = NULL;
+        state->heap = NULL;
         return RC_FILE_NOT_FOUND;
     }
 
-    // Open the file and write the page data to disk
-    openPageFile(bm->pageFile, &fileHandle);
-    pageFrameList[targetFrameIndex].readContent = page->data;
-    ensureCapacity(page->pageNum, &fileHandle);
-    writeBlock(page->pageNum, &fileHandle, pageFrameList[targetFrameIndex].readContent);
+    for (int index = 0; index < state->numHistories; index++) {
+        state->histories[index].references = &state->referenceTimes[(size_t)index * k];
+    }
 
-    // Mark the page as clean after writing to disk
-    pageFrameList[targetFrameIndex].DirtyFlag = 0;
-return (RC_message = "Page successfully written and flushed to disk.", RC_OK);
+    return RC_OK;
+}
 
+void freeLRUKState(LRUKState *state) {
+    if (state->histories == NULL) {
+        return;
+    }
+    free(state->histories);
+    free(state->referenceTimes);
+    free(state->heap);
+    freePageTable(&state->historyTable);
+    state->histories = NULL;
 }
 
-//making pages dirty
-RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page)
-{
-    // Validate if the buffer pool's management data is available
-    if (bm->mgmtData == NULL)
-    {
-        RC_message = "Error: Buffer pool is not initialized or is unavailable.";
+// Makes room for a pool of numPages frames, existing histories keep their indexes
+RC growLRUKState(LRUKState *state, int numPages, int k) {
+    int numHistories = 2 * numPages;
+    if (numHistories <= state->numHistories) {
+        return RC_OK;
+    }
+
+    PageHistory *histories = (PageHistory *)realloc(state->histories, sizeof(PageHistory) * numHistories);
+    if (histories == NULL) {
         return RC_FILE_NOT_FOUND;
     }
+    state->histories = histories;
 
-    PageFrameNode *pageFrameList = (PageFrameNode *)bm->mgmtData;
-    bool pageMarkedDirty = false;
+    long *referenceTimes = (long *)realloc(state->referenceTimes, sizeof(long) * (size_t)numHistories * k);
+    if (referenceTimes == NULL) {
+        return RC_FILE_NOT_FOUND;
+    }
+    memset(&referenceTimes[(size_t)state->numHistories * k], 0,
+           sizeof(long) * (size_t)(numHistories - state->numHistories) * k);
+    state->referenceTimes = referenceTimes;
+    for (int index = 0; index < numHistories; index++) {
+        state->histories[index].references = &state->referenceTimes[(size_t)index * k];
+    }
 
-    // Loop through the buffer pool to find the page
-    for (int frameIndex = 0; frameIndex < bm->numPages; frameIndex++)
-    {
-        if (pageFrameList[frameIndex].bh->pageNum == page->pageNum)
-        {
-            // Mark the page as dirty and increment the write count
-            pageFrameList[frameIndex].DirtyFlag = 1;
-            NoOfWrites++;
-            pageMarkedDirty = true;
-            break;
+    int *heap = (int *)realloc(state->heap, sizeof(int) * numPages);
+    if (heap == NULL || resizePageTable(&state->historyTable, numHistories) != RC_OK) {
+        if (heap != NULL) {
+            state->heap = heap;
         }
+        return RC_FILE_NOT_FOUND;
     }
+    state->heap = heap;
+    state->numHistories = numHistories;
 
-    // Set success or error message based on whether the page was found and marked dirty
-    return (pageMarkedDirty ? (RC_message = "Success: Page flagged as dirty.", RC_OK) : (RC_message = "Error: Page not found in buffer pool, could not mark as dirty.", RC_FILE_NOT_FOUND));
+    return RC_OK;
+}
+
+void unlinkRetainedHistory(LRUKState *state, int index) {
+    PageHistory *history = &state->histories[index];
 
+    if (history->Prev != NO_PAGE) {
+        state->histories[history->Prev].Next = history->Next;
+    } else {
+        state->retainedHead = history->Next;
+    }
+    if (history->Next != NO_PAGE) {
+        state->histories[history->Next].Prev = history->Prev;
+    } else {
+        state->retainedTail = history->Prev;
+    }
 }
 
+// Remembers the history of an evicted page in case it is referenced again soon
+void retainPageHistory(LRUKState *state, int index) {
+    PageHistory *history = &state->histories[index];
 
+    history->Resident = false;
+    history->Prev = NO_PAGE;
+    history->Next = state->retainedHead;
+    if (state->retainedHead != NO_PAGE) {
+        state->histories[state->retainedHead].Prev = index;
+    } else {
+        state->retainedTail = index;
+    }
+    state->retainedHead = index;
+}
 
-//unpinning the page
-RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page)
-{
-    // Get the page frame nodes from the buffer pool
-    PageFrameNode *pageFrame = (PageFrameNode *)bm->mgmtData;
-    bool pageFoundAndUnpinned = false;
+// Returns the history of a page, reusing the oldest retained one if the page has none yet
+int getPageHistory(LRUKState *state, int k, PageNumber pageNum) {
+    int index = lookupPageTable(&state->historyTable, pageNum);
 
-    // Iterate through the page frames to find the matching page
-    for (int i = 0; i < bm->numPages; i++)
-    {
-        if (pageFrame[i].bh->pageNum == page->pageNum && pageFrame[i].FixCount > 0)
-        {
-            pageFrame[i].FixCount--;
-            pageFoundAndUnpinned = true;
-            break;
+    if (index != NO_PAGE) {
+        if (!state->histories[index].Resident) {
+            unlinkRetainedHistory(state, index);
         }
+        return index;
     }
 
-    // Single line for message and return
-    return (pageFoundAndUnpinned ? (RC_message = "Page successfully unpinned.", RC_OK) : (RC_message = "Failed to unpin page as it is not available in the buffer pool.", RC_FILE_NOT_FOUND));
+    if (state->historiesUsed < state->numHistories) {
+        index = state->historiesUsed++;
+    } else {
+        index = state->retainedTail;
+        unlinkRetainedHistory(state, index);
+        removePageTable(&state->historyTable, state->histories[index].pageNumber);
+    }
+
+    state->histories[index].pageNumber = pageNum;
+    memset(state->histories[index].references, 0, sizeof(long) * k);
+    insertPageTable(&state->historyTable, pageNum, index);
+
+    return index;
 }
 
-// Exit Strategies //
-// Function to write dirty page back to disk
-void writeDirtyPageToDisk(PageFrameNode *pageFrame, SM_FileHandle *fileHandle) 
-{
-    // Fetch the dirty page's data from its buffer
-    SM_PageHandle bufferData = pageFrame->bh->data;
+// Adds a reference to the history of the page held by a frame
+void recordPageReference(LRUKState *state, int k, PageFrameNode *frame) {
+    int index = getPageHistory(state, k, frame->bh->pageNum);
+    long *references = state->histories[index].references;
 
-    // Store the buffer data into the page frame's readContent field
-    pageFrame->readContent = bufferData;
+    memmove(&references[1], &references[0], sizeof(long) * (k - 1));
+    references[0] = ++state->referenceClock;
 
-    // Write the data to the disk at the appropriate block
-    writeBlock(pageFrame->bh->pageNum, fileHandle, bufferData);
+    state->histories[index].Resident = true;
+    frame->HistoryIndex = index;
 }
 
-// Function to ensure disk capacity and read new page from disk
-void loadPageFromDisk(PageFrameNode *pageFrame, SM_FileHandle *fileHandle, PageNumber pageNum)
-{
-    // Ensure enough capacity in the file before loading the page
-    ensureCapacity(pageNum, fileHandle);
+// True if frame a has a larger backward k-distance than frame b. Pages referenced fewer
+// than k times have an infinite distance, ties are broken by the last reference (plain LRU)
+bool evictsBeforeLRUK(const LRUKState *state, int k, const PageFrameNode *frames, int a, int b) {
+    const long *refA = state->histories[frames[a].HistoryIndex].references;
+    const long *refB = state->histories[frames[b].HistoryIndex].references;
+
+    if (refA[k - 1] != refB[k - 1]) {
+        return refA[k - 1] < refB[k - 1];
+    }
+    return refA[0] < refB[0];
+}
 
-    // Read the new page data into the buffer
-    readBlock(pageNum, fileHandle, pageFrame->readContent);
+void swapLRUKHeapSlots(LRUKState *state, PageFrameNode *frames, int i, int j) {
+    int frameNum = state->heap[i];
 
-    // Update the page frame with the new data
-    pageFrame->bh->pageNum = pageNum;
-    pageFrame->bh->data = pageFrame->readContent;
-    pageFrame->DirtyFlag = 0;  // Mark the page as clean
-    pageFrame->FixCount = 1;   // Set FixCount as it is now pinned
+    state->heap[i] = state->heap[j];
+    state->heap[j] = frameNum;
+    frames[state->heap[i]].HeapPos = i;
+    frames[state->heap[j]].HeapPos = j;
 }
 
-// Function to update the buffer page and page handle with new page data
-void updateBufferAndPageHandle(PageFrameNode *pageFrame, BM_PageHandle *page, PageNumber pageNum) 
-{
-    // Update the page frame's pageNum and data
-    pageFrame->bh->pageNum = pageNum;
-    pageFrame->bh->data = pageFrame->readContent;
+void siftUpLRUKHeap(LRUKState *state, int k, PageFrameNode *frames, int pos) {
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!evictsBeforeLRUK(state, k, frames, state->heap[pos], state->heap[parent])) {
+            break;
+        }
+        swapLRUKHeapSlots(state, frames, pos, parent);
+        pos = parent;
+    }
+}
+
+void siftDownLRUKHeap(LRUKState *state, int k, PageFrameNode *frames, int pos) {
+    while (true) {
+        int smallest = pos;
+        int left = 2 * pos + 1;
+        int right = left + 1;
+
+        if (left < state->heapSize && evictsBeforeLRUK(state, k, frames, state->heap[left], state->heap[smallest])) {
+            smallest = left;
+        }
+        if (right < state->heapSize && evictsBeforeLRUK(state, k, frames, state->heap[right], state->heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            break;
+        }
+        swapLRUKHeapSlots(state, frames, pos, smallest);
+        pos = smallest;
+    }
+}
+
+// Only unpinned frames are in the heap, so their keys cannot change while they are in it
+void pushLRUKHeap(LRUKState *state, int k, PageFrameNode *frames, int frameNum) {
+    int pos = state->heapSize++;
+
+    state->heap[pos] = frameNum;
+    frames[frameNum].HeapPos = pos;
+    siftUpLRUKHeap(state, k, frames, pos);
+}
+
+void removeLRUKHeap(LRUKState *state, int k, PageFrameNode *frames, int frameNum) {
+    int pos = frames[frameNum].HeapPos;
+    if (pos == NO_FRAME) {
+        return;
+    }
+
+    int last = --state->heapSize;
+    if (pos != last) {
+        swapLRUKHeapSlots(state, frames, pos, last);
+        siftDownLRUKHeap(state, k, frames, pos);
+        siftUpLRUKHeap(state, k, frames, pos);
+    }
+    frames[frameNum].HeapPos = NO_FRAME;
+}
+
+/// LFU ///
+
+// A frame moving up to a new frequency needs its new node before the old one is released,
+// so there is one node more than there are frames
+RC initLFUState(LFUState *state, int numPages, int agingPeriod) {
+    int numNodes = numPages + 1;
+
+    state->nodes = (FrequencyNode *)malloc(sizeof(FrequencyNode) * numNodes);
+    state->freeNodes = (int *)malloc(sizeof(int) * numNodes);
+    if (state->nodes == NULL || state->freeNodes == NULL) {
+        free(state->nodes);
+        free(state->freeNodes);
+        state->nodes = NULL;
+        state->freeNodes = NULL;
+        return RC_FILE_NOT_FOUND;
+    }
+
+    for (int index = 0; index < numNodes; index++) {
+        state->freeNodes[index] = numNodes - 1 - index;
+    }
+    state->numFreeNodes = numNodes;
+    state->numNodes = numNodes;
+    state->head = NO_FRAME;
+    state->agingPeriod = agingPeriod;
+    state->referencesSinceAging = 0;
+
+    return RC_OK;
+}
+
+void freeLFUState(LFUState *state) {
+    free(state->nodes);
+    free(state->freeNodes);
+    state->nodes = NULL;
+    state->freeNodes = NULL;
+}
+
+// Adds the nodes a pool of numPages frames needs, the new ones start out unused
+RC growLFUState(LFUState *state, int numPages) {
+    int numNodes = numPages + 1;
+    if (numNodes <= state->numNodes) {
+        return RC_OK;
+    }
+
+    FrequencyNode *nodes = (FrequencyNode *)realloc(state->nodes, sizeof(FrequencyNode) * numNodes);
+    if (nodes == NULL) {
+        return RC_FILE_NOT_FOUND;
+    }
+    state->nodes = nodes;
+
+    int *freeNodes = (int *)realloc(state->freeNodes, sizeof(int) * numNodes);
+    if (freeNodes == NULL) {
+        return RC_FILE_NOT_FOUND;
+    }
+    state->freeNodes = freeNodes;
+
+    for (int index = numNodes - 1; index >= state->numNodes; index--) {
+        state->freeNodes[state->numFreeNodes++] = index;
+    }
+    state->numNodes = numNodes;
+
+    return RC_OK;
+}
+
+// Takes an unused node and links it between prev and next
+int allocFrequencyNode(LFUState *state, long frequency, int prev, int next) {
+    int index = state->freeNodes[--state->numFreeNodes];
+    FrequencyNode *node = &state->nodes[index];
+
+    node->frequency = frequency;
+    initFrameList(&node->unpinned, FIRST_FREQUENCY_LIST + 2 * index);
+    initFrameList(&node->pinned, FIRST_FREQUENCY_LIST + 2 * index + 1);
+    node->Prev = prev;
+    node->Next = next;
+    if (prev != NO_FRAME) {
+        state->nodes[prev].Next = index;
+    } else {
+        state->head = index;
+    }
+    if (next != NO_FRAME) {
+        state->nodes[next].Prev = index;
+    }
+
+    return index;
+}
+
+void releaseFrequencyNodeIfEmpty(LFUState *state, int index) {
+    FrequencyNode *node = &state->nodes[index];
+    if (node->unpinned.size > 0 || node->pinned.size > 0) {
+        return;
+    }
+
+    if (node->Prev != NO_FRAME) {
+        state->nodes[node->Prev].Next = node->Next;
+    } else {
+        state->head = node->Next;
+    }
+    if (node->Next != NO_FRAME) {
+        state->nodes[node->Next].Prev = node->Prev;
+    }
+    state->freeNodes[state->numFreeNodes++] = index;
+}
+
+void detachFrameLFU(LFUState *state, PageFrameNode *frames, int frameNum) {
+    int index = frames[frameNum].FrequencyNode;
+    if (index == NO_FRAME) {
+        return;
+    }
+
+    unlinkFrame(frames, &state->nodes[index].unpinned, frameNum);
+    unlinkFrame(frames, &state->nodes[index].pinned, frameNum);
+    frames[frameNum].FrequencyNode = NO_FRAME;
+    releaseFrequencyNodeIfEmpty(state, index);
+}
+
+// Moves all frames of node from into node to, ahead of the frames already there
+void mergeFrequencyNodes(LFUState *state, PageFrameNode *frames, int from, int to) {
+    int frameNum;
+
+    while ((frameNum = popFrameAtTail(frames, &state->nodes[from].unpinned)) != NO_FRAME) {
+        linkFrameAtHead(frames, &state->nodes[to].unpinned, frameNum);
+        frames[frameNum].FrequencyNode = to;
+    }
+    while ((frameNum = popFrameAtTail(frames, &state->nodes[from].pinned)) != NO_FRAME) {
+        linkFrameAtHead(frames, &state->nodes[to].pinned, frameNum);
+        frames[frameNum].FrequencyNode = to;
+    }
+    releaseFrequencyNodeIfEmpty(state, from);
+}
+
+// Halves every frequency so pages that were hot long ago can be evicted again.
+// Halving keeps the node order, so only neighbours that end up equal are merged
+void ageFrequencies(LFUState *state, PageFrameNode *frames) {
+    int index = state->head;
+
+    while (index != NO_FRAME) {
+        int next = state->nodes[index].Next;
+        int prev = state->nodes[index].Prev;
+        long frequency = state->nodes[index].frequency / 2;
+
+        state->nodes[index].frequency = (frequency > 0) ? frequency : 1;
+        if (prev != NO_FRAME && state->nodes[prev].frequency == state->nodes[index].frequency) {
+            mergeFrequencyNodes(state, frames, index, prev);
+        }
+        index = next;
+    }
+    state->referencesSinceAging = 0;
+}
+
+void countReferenceLFU(LFUState *state, PageFrameNode *frames) {
+    if (state->agingPeriod > 0 && ++state->referencesSinceAging >= state->agingPeriod) {
+        ageFrequencies(state, frames);
+    }
+}
+
+// A freshly loaded page is pinned and has been referenced once
+void insertFrameLFU(LFUState *state, PageFrameNode *frames, int frameNum) {
+    int index = state->head;
+
+    if (index == NO_FRAME || state->nodes[index].frequency != 1) {
+        index = allocFrequencyNode(state, 1, NO_FRAME, state->head);
+    }
+    linkFrameAtHead(frames, &state->nodes[index].pinned, frameNum);
+    frames[frameNum].FrequencyNode = index;
+    countReferenceLFU(state, frames);
+}
+
+// Moves the frame to the node of the next frequency, creating it next to the current one
+void incrementFrequencyLFU(LFUState *state, PageFrameNode *frames, int frameNum) {
+    int index = frames[frameNum].FrequencyNode;
+    int next = state->nodes[index].Next;
+    long frequency = state->nodes[index].frequency + 1;
+
+    if (next == NO_FRAME || state->nodes[next].frequency != frequency) {
+        next = allocFrequencyNode(state, frequency, index, next);
+    }
+
+    detachFrameLFU(state, frames, frameNum);
+    linkFrameAtHead(frames, &state->nodes[next].pinned, frameNum);
+    frames[frameNum].FrequencyNode = next;
+    countReferenceLFU(state, frames);
+}
+
+void unpinFrameLFU(LFUState *state, PageFrameNode *frames, int frameNum) {
+    int index = frames[frameNum].FrequencyNode;
+
+    if (index != NO_FRAME && frames[frameNum].ListId == state->nodes[index].pinned.id) {
+        unlinkFrame(frames, &state->nodes[index].pinned, frameNum);
+        linkFrameAtHead(frames, &state->nodes[index].unpinned, frameNum);
+    }
+}
+
+// Gives a freshly loaded, pinned frame the frequency saved for its page by a snapshot.
+// The frequency is not counted as references, so restoring it never ages the others
+void restoreFrequencyLFU(LFUState *state, PageFrameNode *frames, int frameNum, long frequency) {
+    int index = frames[frameNum].FrequencyNode;
+    int prev = index;
+    int next = state->nodes[index].Next;
+
+    if (frequency <= state->nodes[index].frequency) {
+        return;
+    }
+    while (next != NO_FRAME && state->nodes[next].frequency < frequency) {
+        prev = next;
+        next = state->nodes[next].Next;
+    }
+    if (next == NO_FRAME || state->nodes[next].frequency != frequency) {
+        next = allocFrequencyNode(state, frequency, prev, next);
+    }
+
+    detachFrameLFU(state, frames, frameNum);
+    linkFrameAtHead(frames, &state->nodes[next].pinned, frameNum);
+    frames[frameNum].FrequencyNode = next;
+}
+
+// Claims the least recently unpinned frame of the lowest frequency. Pinned frames are kept
+// on their own lists, so only nodes holding nothing but pinned frames are passed over
+int claimVictimLFU(LFUState *state, PageFrameNode *frames) {
+    for (int index = state->head; index != NO_FRAME; index = state->nodes[index].Next) {
+        int frameNum;
+        while ((frameNum = state->nodes[index].unpinned.tail) != NO_FRAME) {
+            if (tryClaimFrame(&frames[frameNum])) {
+                return frameNum;
+            }
+            // Pinned again since its last unpin, its next unpin moves it back
+            unlinkFrame(frames, &state->nodes[index].unpinned, frameNum);
+            linkFrameAtHead(frames, &state->nodes[index].pinned, frameNum);
+        }
+    }
+    return NO_FRAME;
+}
+
+/// ARC and 2Q ///
+
+#define RECENT_GHOSTS 0
+#define FREQUENT_GHOSTS 1
+
+// Limits that depend on the number of frames, the target is clamped to the new range
+void setAdaptiveLimits(AdaptiveState *state, ReplacementStrategy strategy, int numPages) {
+    if (strategy == RS_ARC) {
+        state->maxTarget = numPages;
+        state->ghostLimit = numPages;
+    } else {
+        state->maxTarget = (numPages / 2 > 0) ? numPages / 2 : 1;
+        state->ghostLimit = (numPages / 2 > 0) ? numPages / 2 : 1;
+    }
+    if (state->target > state->maxTarget) {
+        state->target = state->maxTarget;
+    }
+}
+
+// Ghost entries for twice as many pages as there are frames, more than ARC ever keeps
+RC initAdaptiveState(AdaptiveState *state, ReplacementStrategy strategy, int numPages) {
+    int numGhosts = 2 * numPages;
+
+    state->ghosts = (GhostEntry *)malloc(sizeof(GhostEntry) * numGhosts);
+    state->freeGhosts = (int *)malloc(sizeof(int) * numGhosts);
+    if (state->ghosts == NULL || state->freeGhosts == NULL ||
+        initPageTable(&state->ghostTable, numGhosts) != RC_OK) {
+        free(state->ghosts);
+        free(state->freeGhosts);
+        state->ghosts = NULL;
+        state->freeGhosts = NULL;
+        return RC_FILE_NOT_FOUND;
+    }
+
+    for (int index = 0; index < numGhosts; index++) {
+        state->freeGhosts[index] = numGhosts - 1 - index;
+    }
+    state->numFreeGhosts = numGhosts;
+    state->numGhosts = numGhosts;
+
+    initFrameList(&state->recent, RECENT_LIST);
+    initFrameList(&state->frequent, FREQUENT_LIST);
+    state->recentGhosts = (GhostList){NO_PAGE, NO_PAGE, 0, RECENT_GHOSTS};
+    state->frequentGhosts = (GhostList){NO_PAGE, NO_PAGE, 0, FREQUENT_GHOSTS};
+
+    if (strategy == RS_ARC) {
+        // ARC starts without a preference and moves the target between 0 and all frames
+        state->target = 0;
+    } else {
+        // 2Q starts with the recommended A1in of a quarter and A1out of half the frames
+        state->target = (numPages / 4 > 0) ? numPages / 4 : 1;
+    }
+    setAdaptiveLimits(state, strategy, numPages);
+
+    return RC_OK;
+}
+
+void freeAdaptiveState(AdaptiveState *state) {
+    if (state->ghosts == NULL) {
+        return;
+    }
+    free(state->ghosts);
+    free(state->freeGhosts);
+    freePageTable(&state->ghostTable);
+    state->ghosts = NULL;
+    state->freeGhosts = NULL;
+}
+
+// Adds the ghost entries a pool of numPages frames needs, remembered pages stay where they are
+RC growAdaptiveState(AdaptiveState *state, int numPages) {
+    int numGhosts = 2 * numPages;
+    if (numGhosts <= state->numGhosts) {
+        return RC_OK;
+    }
+
+    GhostEntry *ghosts = (GhostEntry *)realloc(state->ghosts, sizeof(GhostEntry) * numGhosts);
+    if (ghosts == NULL) {
+        return RC_FILE_NOT_FOUND;
+    }
+    state->ghosts = ghosts;
+
+    int *freeGhosts = (int *)realloc(state->freeGhosts, sizeof(int) * numGhosts);
+    if (freeGhosts == NULL || resizePageTable(&state->ghostTable, numGhosts) != RC_OK) {
+        if (freeGhosts != NULL) {
+            state->freeGhosts = freeGhosts;
+        }
+        return RC_FILE_NOT_FOUND;
+    }
+    state->freeGhosts = freeGhosts;
+
+    for (int index = numGhosts - 1; index >= state->numGhosts; index--) {
+        state->freeGhosts[state->numFreeGhosts++] = index;
+    }
+    state->numGhosts = numGhosts;
+
+    return RC_OK;
+}
+
+GhostList *getGhostList(AdaptiveState *state, int listId) {
+    return (listId == RECENT_GHOSTS) ? &state->recentGhosts : &state->frequentGhosts;
+}
+
+void removeGhost(AdaptiveState *state, int index) {
+    GhostEntry *ghost = &state->ghosts[index];
+    GhostList *list = getGhostList(state, ghost->ListId);
+
+    if (ghost->Prev != NO_PAGE) {
+        state->ghosts[ghost->Prev].Next = ghost->Next;
+    } else {
+        list->head = ghost->Next;
+    }
+    if (ghost->Next != NO_PAGE) {
+        state->ghosts[ghost->Next].Prev = ghost->Prev;
+    } else {
+        list->tail = ghost->Prev;
+    }
+    list->size--;
+
+    removePageTable(&state->ghostTable, ghost->pageNumber);
+    state->freeGhosts[state->numFreeGhosts++] = index;
+}
+
+// Forgets the oldest page of a ghost list, returns false if it was empty
+bool dropGhostTail(AdaptiveState *state, GhostList *list) {
+    if (list->tail == NO_PAGE) {
+        return false;
+    }
+    removeGhost(state, list->tail);
+    return true;
+}
+
+void pushGhost(AdaptiveState *state, GhostList *list, PageNumber pageNum) {
+    if (state->numFreeGhosts == 0 && !dropGhostTail(state, &state->recentGhosts)) {
+        dropGhostTail(state, &state->frequentGhosts);
+    }
+
+    int index = state->freeGhosts[--state->numFreeGhosts];
+    GhostEntry *ghost = &state->ghosts[index];
+
+    ghost->pageNumber = pageNum;
+    ghost->ListId = list->id;
+    ghost->Prev = NO_PAGE;
+    ghost->Next = list->head;
+    if (list->head != NO_PAGE) {
+        state->ghosts[list->head].Prev = index;
+    } else {
+        list->tail = index;
+    }
+    list->head = index;
+    list->size++;
+
+    insertPageTable(&state->ghostTable, pageNum, index);
+}
+
+// Claims the least recently used frame of a list that is not pinned, NO_FRAME if there is none
+int claimFromTail(PageFrameNode *frames, const FrameList *list) {
+    for (int frameNum = list->tail; frameNum != NO_FRAME; frameNum = frames[frameNum].Prev) {
+        if (tryClaimFrame(&frames[frameNum])) {
+            return frameNum;
+        }
+    }
+    return NO_FRAME;
+}
+
+// A page found in a ghost list was evicted too early and comes back on the frequency list
+void insertFrameAdaptive(BM_BufferPool *const bm, PageFrameNode *frames, int frameNum) {
+    AdaptiveState *state = &getPoolMetadata(bm)->adaptive;
+    int ghost = lookupPageTable(&state->ghostTable, frames[frameNum].bh->pageNum);
+
+    if (ghost == NO_PAGE) {
+        linkFrameAtHead(frames, &state->recent, frameNum);
+        return;
+    }
+
+    removeGhost(state, ghost);
+    linkFrameAtHead(frames, &state->frequent, frameNum);
+}
+
+/// Replacement Bookkeeping ///
+
+// The hooks below take the replacement latch themselves. CLOCK only flips an atomic
+// reference bit and FIFO ignores hits, so hits under those strategies never take a shared latch
+
+// Called once a page has been read into a frame, the frame is pinned by the caller. Needs the replacement latch
+void trackLoadedFrameLocked(BM_BufferPool *const bm, int frameNum)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *frames = pfmd->frames;
+
+    if (bm->strategy == RS_CLOCK)
+    {
+        atomic_store(&frames[frameNum].UsedFlag, 1);
+    }
+    else if (bm->strategy == RS_LRU)
+    {
+        // Pinned frames stay off the LRU list until their last unpin
+        unlinkFrame(frames, &pfmd->replacementList, frameNum);
+    }
+    else if (bm->strategy == RS_LRU_K)
+    {
+        // Loading the page is its first reference since it became resident
+        recordPageReference(&pfmd->lruK, pfmd->k, &frames[frameNum]);
+    }
+    else if (bm->strategy == RS_LFU)
+    {
+        insertFrameLFU(&pfmd->lfu, frames, frameNum);
+    }
+    else if (bm->strategy == RS_ARC || bm->strategy == RS_2Q)
+    {
+        insertFrameAdaptive(bm, frames, frameNum);
+    }
+    else
+    {
+        // FIFO order is the load order, the newest page sits at the head
+        moveFrameToHead(frames, &pfmd->replacementList, frameNum);
+    }
+}
+
+// Called once a page has been read into a frame, the frame is pinned by the caller
+void trackLoadedFrame(BM_BufferPool *const bm, int frameNum)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+
+    if (bm->strategy == RS_CLOCK)
+    {
+        atomic_store(&pfmd->frames[frameNum].UsedFlag, 1);
+        return;
+    }
+
+    pthread_mutex_lock(&pfmd->replacementLatch);
+    trackLoadedFrameLocked(bm, frameNum);
+    pthread_mutex_unlock(&pfmd->replacementLatch);
+}
+
+// Called on every hit, after the fix count of the frame has been raised
+void trackPageHit(BM_BufferPool *const bm, int frameNum)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *frames = pfmd->frames;
+
+    if (bm->strategy == RS_CLOCK)
+    {
+        atomic_store(&frames[frameNum].UsedFlag, 1);
+        return;
+    }
+    if (bm->strategy == RS_FIFO)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pfmd->replacementLatch);
+    if (bm->strategy == RS_LRU)
+    {
+        unlinkFrame(frames, &pfmd->replacementList, frameNum);
+    }
+    else if (bm->strategy == RS_LRU_K)
+    {
+        recordPageReference(&pfmd->lruK, pfmd->k, &frames[frameNum]);
+        removeLRUKHeap(&pfmd->lruK, pfmd->k, frames, frameNum);
+    }
+    else if (bm->strategy == RS_LFU)
+    {
+        incrementFrequencyLFU(&pfmd->lfu, frames, frameNum);
+    }
+    else if (bm->strategy == RS_ARC)
+    {
+        // Any second reference promotes the page to T2
+        unlinkFrame(frames, &pfmd->adaptive.recent, frameNum);
+        moveFrameToHead(frames, &pfmd->adaptive.frequent, frameNum);
+    }
+    else if (bm->strategy == RS_2Q)
+    {
+        // A1in is FIFO, only pages already in Am are refreshed
+        if (frames[frameNum].ListId == FREQUENT_LIST)
+        {
+            moveFrameToHead(frames, &pfmd->adaptive.frequent, frameNum);
+        }
+    }
+    pthread_mutex_unlock(&pfmd->replacementLatch);
+}
+
+// Makes an unpinned frame an eviction candidate again. Needs the replacement latch
+void trackUnpinnedFrameLocked(BM_BufferPool *const bm, int frameNum)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *frames = pfmd->frames;
+
+    // Another thread may have pinned the frame again since its fix count dropped
+    if (isFrameEvictable(&frames[frameNum]))
+    {
+        if (bm->strategy == RS_LRU && frames[frameNum].ListId != REPLACEMENT_LIST)
+        {
+            // The frame becomes the most recently used eviction candidate
+            linkFrameAtHead(frames, &pfmd->replacementList, frameNum);
+        }
+        else if (bm->strategy == RS_LRU_K && frames[frameNum].HeapPos == NO_FRAME)
+        {
+            pushLRUKHeap(&pfmd->lruK, pfmd->k, frames, frameNum);
+        }
+        else if (bm->strategy == RS_LFU)
+        {
+            unpinFrameLFU(&pfmd->lfu, frames, frameNum);
+        }
+    }
+}
+
+// Called when the fix count of a frame drops to zero
+void trackUnpinnedFrame(BM_BufferPool *const bm, int frameNum)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+
+    if (bm->strategy != RS_LRU && bm->strategy != RS_LRU_K && bm->strategy != RS_LFU)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pfmd->replacementLatch);
+    trackUnpinnedFrameLocked(bm, frameNum);
+    pthread_mutex_unlock(&pfmd->replacementLatch);
+}
+
+// Drops one pin of a frame and tells the replacement strategy once the last pin is gone.
+// Returns false if the frame was not pinned
+bool releaseFramePin(BM_BufferPool *const bm, int frameNum)
+{
+    int remainingPins = tryUnpinFrame(&getPoolMetadata(bm)->frames[frameNum]);
+
+    if (remainingPins == 0)
+    {
+        trackUnpinnedFrame(bm, frameNum);
+    }
+    return remainingPins >= 0;
+}
+
+// Gives a frame claimed for eviction back once its dirty page could not be written, the page stays resident,
+// dirty and unpinned. Needs the replacement latch
+void restoreClaimedFrameLocked(BM_BufferPool *const bm, int frameNum)
+{
+    PageFrameNode *frame = &getPoolMetadata(bm)->frames[frameNum];
+
+    // The victim choosers took the frame off the strategy's bookkeeping, it comes back like a loaded page
+    trackLoadedFrameLocked(bm, frameNum);
+    atomic_store(&frame->FixCount, 0);
+    finishFrameIo(frame);
+    trackUnpinnedFrameLocked(bm, frameNum);
+}
+
+// Completes the asynchronous pins that joined the read of a page, once the reading thread has made the
+// page known to the replacement strategy. They count as hits, see completeHit
+void completeJoinedPins(BM_BufferPool *const bm, BM_PinRequest *waiters)
+{
+    for (BM_PinRequest *request = waiters; request != NULL; request = request->next)
+    {
+        atomic_fetch_add(&getPoolMetadata(bm)->NoOfHits, 1);
+        trackPageHit(bm, request->frameNum);
+    }
+    completePinRequests(bm, waiters);
+}
+
+// Frame holding a resident page. Only meant for pages the caller has pinned, which cannot move,
+// so the latch-free lookup is enough unless it raced with the removal of another page
+int findPinnedFrame(PageFrameMD *pfmd, PageNumber pageNum)
+{
+    PageTableShard *shard = getPageTableShard(pfmd, pageNum);
+    int frameNum = lookupPageTable(getShardTable(shard), pageNum);
+
+    if (frameNum == NO_PAGE)
+    {
+        pthread_mutex_lock(&shard->latch);
+        frameNum = lookupPageTable(getShardTable(shard), pageNum);
+        pthread_mutex_unlock(&shard->latch);
+    }
+    return frameNum;
+}
+
+// Counts pages read from disk. Pages that mapped frames only point at take no call and copy nothing
+void countPageReads(PageFrameMD *pfmd, int pages, bool copied)
+{
+    atomic_fetch_add(&pfmd->NoOfReads, pages);
+    if (copied)
+    {
+        atomic_fetch_add(&pfmd->NoOfReadCalls, 1);
+        atomic_fetch_add(&pfmd->BytesRead, (long)pages * PAGE_SIZE);
+    }
+}
+
+// Counts pages written to disk with one call of the storage manager
+void countPageWrites(PageFrameMD *pfmd, int pages)
+{
+    atomic_fetch_add(&pfmd->NoOfWrites, pages);
+    atomic_fetch_add(&pfmd->NoOfWriteCalls, 1);
+    atomic_fetch_add(&pfmd->BytesWritten, (long)pages * PAGE_SIZE);
+}
+
+/// Latency Histograms ///
+
+long long monotonicNanos(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Start of a timed code path, 0 while the pool keeps no histograms so the path only pays for one load
+long long startLatencyTimer(PageFrameMD *pfmd)
+{
+    if (!atomic_load_explicit(&pfmd->LatencyTracking, memory_order_relaxed))
+    {
+        return 0;
+    }
+    return monotonicNanos();
+}
+
+// Buckets 0 to 3 hold 0 to 3 ns, after that every power of two is split into four buckets of equal width
+int latencyBucket(long long nanos)
+{
+    if (nanos < 4)
+    {
+        return (nanos < 0) ? 0 : (int)nanos;
+    }
+    if (nanos > MAX_LATENCY_NANOS)
+    {
+        nanos = MAX_LATENCY_NANOS;
+    }
+    int octave = 63 - __builtin_clzll((unsigned long long)nanos);
+    return (octave - 1) * 4 + (int)((nanos >> (octave - 2)) & 3);
+}
+
+// Largest latency counted in a bucket
+long long latencyBucketLimit(int bucket)
+{
+    if (bucket < 4)
+    {
+        return bucket;
+    }
+    int octave = bucket / 4 + 1;
+    return ((long long)(4 + bucket % 4 + 1) << (octave - 2)) - 1;
+}
+
+void recordLatency(PageFrameMD *pfmd, BM_LatencyKind kind, long long start)
+{
+    if (start == 0)
+    {
+        return;
+    }
+
+    long long nanos = monotonicNanos() - start;
+    LatencyCounters *counters = &pfmd->latency[kind];
+    atomic_fetch_add_explicit(&counters->buckets[latencyBucket(nanos)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->sumNanos, nanos, memory_order_relaxed);
+
+    long long max = atomic_load_explicit(&counters->maxNanos, memory_order_relaxed);
+    while (nanos > max &&
+           !atomic_compare_exchange_weak_explicit(&counters->maxNanos, &max, nanos,
+                                                  memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+}
+
+/// Pin Trace ///
+
+// Must be called with the trace latch held
+void flushTraceBuffer(PageFrameMD *pfmd)
+{
+    if (pfmd->TraceBuffered > 0 &&
+        fwrite(pfmd->traceBuffer, sizeof(BM_TraceRecord), pfmd->TraceBuffered, pfmd->traceFile) != (size_t)pfmd->TraceBuffered)
+    {
+        pfmd->TraceWriteFailed = true;
+    }
+    pfmd->TraceBuffered = 0;
+}
+
+// Appends a record to the pin trace of the pool, if one is recorded
+void recordTrace(PageFrameMD *pfmd, int operation, PageNumber pageNum)
+{
+    if (!atomic_load_explicit(&pfmd->Tracing, memory_order_relaxed))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pfmd->traceLatch);
+    if (pfmd->traceFile != NULL)
+    {
+        BM_TraceRecord *record = &pfmd->traceBuffer[pfmd->TraceBuffered++];
+        record->timestamp = monotonicNanos() - pfmd->TraceStart;
+        record->pageNum = pageNum;
+        record->operation = operation;
+        if (pfmd->TraceBuffered == TRACE_BUFFER_RECORDS)
+        {
+            flushTraceBuffer(pfmd);
+        }
+    }
+    pthread_mutex_unlock(&pfmd->traceLatch);
+}
+
+// Exit Strategies //
+// Marks a frame dirty again after writing its page back failed, unless it was marked dirty since
+void restoreDirtyFlag(PageFrameMD *pfmd, PageFrameNode *frame)
+{
+    pthread_mutex_lock(&frame->latch);
+    bool newlyDirty = !frame->DirtyFlag;
+    frame->DirtyFlag = 1;
+    pthread_mutex_unlock(&frame->latch);
+    if (newlyDirty)
+    {
+        atomic_fetch_add(&pfmd->NumberOfDirtyFrames, 1);
+    }
+}
+
+// Function to write dirty page back to disk. The caller clears the dirty flag before, so a markDirty
+// while the page is written keeps it dirty; the flag is only left cleared if the write succeeds
+RC writeDirtyPageToDisk(BM_BufferPool *const bm, PageFrameNode *pageFrame, PageNumber pageNum)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+
+    // Write the data to the disk at the appropriate block. The page is allocated first,
+    // so the handle's page count keeps covering everything written through it
+    pthread_mutex_lock(&pfmd->fileLatch);
+    RC rc = ensureCapacity(BM_PAGE_NUMBER(pageNum) + 1, getPageFile(pfmd, pageNum));
+    if (rc == RC_OK)
+    {
+        rc = writeBlock(BM_PAGE_NUMBER(pageNum), getPageFile(pfmd, pageNum), pageFrame->readContent);
+    }
+    pthread_mutex_unlock(&pfmd->fileLatch);
+
+    if (rc != RC_OK)
+    {
+        restoreDirtyFlag(pfmd, pageFrame);
+        return rc;
+    }
+    countPageWrites(pfmd, 1);
+    return RC_OK;
+}
+
+// Function to ensure disk capacity and read new page from disk. Only pins that missed load pages this way.
+// Returns the error of extending or reading the file, the frame is then left to failPageRead
+RC loadPageFromDisk(BM_BufferPool *const bm, PageFrameNode *pageFrame, PageNumber pageNum)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+
+    pthread_mutex_lock(&pfmd->fileLatch);
+
+    // Ensure enough capacity in the file before loading the page, a page past the end reads as zeros
+    SM_FileHandle *file = getPageFile(pfmd, pageNum);
+    RC rc = ensureCapacity(BM_PAGE_NUMBER(pageNum) + 1, file);
+
+    // Mapped frames point at the page inside the mapping, the kernel brings it in on first access
+    SM_PageHandle mapped;
+    bool copied = true;
+    if (rc == RC_OK)
+    {
+        copied = !(pfmd->MappedFrames && readBlockMapped(BM_PAGE_NUMBER(pageNum), file, &mapped) == RC_OK);
+        if (!copied)
+        {
+            pageFrame->readContent = mapped;
+            pageFrame->bh->data = mapped;
+        }
+        else
+        {
+            // Read the new page data into the buffer
+            rc = readBlock(BM_PAGE_NUMBER(pageNum), file, pageFrame->readContent);
+        }
+    }
+    pthread_mutex_unlock(&pfmd->fileLatch);
+
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+    countPageReads(pfmd, 1, copied);
+    atomic_fetch_add(&pfmd->NoOfMisses, 1);
+    return RC_OK;
+}
+
+// Function to update the page handle with the page data of a frame. The frame's own handle
+// is set when the page is loaded, so hits do not write to the shared frame
+void updateBufferAndPageHandle(PageFrameNode *pageFrame, BM_PageHandle *page, PageNumber pageNum)
+{
+    // Update the page handle to reflect the new page's data
+    page->pageNum = pageNum;
+    page->data = pageFrame->readContent;
+}
+
+// Writes a resident page back if it is dirty, *written tells whether it was. Returns the error of a failed
+// write, the page then stays dirty. The page stays pinned while it is written so it cannot be evicted underneath
+RC writeBackResidentPage(BM_BufferPool *const bm, PageNumber pageNum, bool *written)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageTableShard *shard = getPageTableShard(pfmd, pageNum);
+    bool mustWrite = false;
+
+    pthread_mutex_lock(&shard->latch);
+    int frameNum = lookupPageTable(getShardTable(shard), pageNum);
+    if (frameNum != NO_PAGE)
+    {
+        PageFrameNode *frame = &pfmd->frames[frameNum];
+        pthread_mutex_lock(&frame->latch);
+
+        // A frame claimed for eviction is written back by the thread that claimed it
+        if (frame->DirtyFlag == 1 && tryPinFrame(frame))
+        {
+            frame->DirtyFlag = 0;
+            atomic_fetch_sub(&pfmd->NumberOfDirtyFrames, 1);
+            mustWrite = true;
+        }
+        pthread_mutex_unlock(&frame->latch);
+    }
+    pthread_mutex_unlock(&shard->latch);
+
+    RC rc = RC_OK;
+    if (mustWrite)
+    {
+        rc = writeDirtyPageToDisk(bm, &pfmd->frames[frameNum], pageNum);
+        releaseFramePin(bm, frameNum);
+    }
+    *written = mustWrite && rc == RC_OK;
+    return rc;
+}
+
+// Releases everything a pool owns, for pools that are only partly set up as well
+void destroyPoolMetadata(PageFrameMD *pfmd, int initializedFrames) {
+    for (int index = 0; index < initializedFrames; index++) {
+        pthread_mutex_destroy(&pfmd->frames[index].latch);
+        pthread_cond_destroy(&pfmd->frames[index].ioDone);
+    }
+    freePageTableShards(pfmd->pageTable);
+    freeLRUKState(&pfmd->lruK);
+    freeLFUState(&pfmd->lfu);
+    freeAdaptiveState(&pfmd->adaptive);
+    pthread_mutex_destroy(&pfmd->replacementLatch);
+    pthread_mutex_destroy(&pfmd->fileLatch);
+    pthread_mutex_destroy(&pfmd->cleanerLatch);
+    pthread_cond_destroy(&pfmd->cleanerWakeup);
+    pthread_mutex_destroy(&pfmd->readAheadLatch);
+    pthread_mutex_destroy(&pfmd->ioLatch);
+    pthread_cond_destroy(&pfmd->ioWork);
+    pthread_mutex_destroy(&pfmd->completionLatch);
+    pthread_cond_destroy(&pfmd->completionReady);
+    pthread_mutex_destroy(&pfmd->traceLatch);
+    pthread_mutex_destroy(&pfmd->snapshotLatch);
+    pthread_cond_destroy(&pfmd->snapshotWakeup);
+    for (int fileId = 0; fileId < BM_MAX_PAGE_FILES; fileId++) {
+        if (pfmd->files[fileId].mgmtInfo != NULL) {
+            closePageFile(&pfmd->files[fileId]);
+        }
+    }
+    freeFrameArena(pfmd);
+    freePageFrameNodes(pfmd);
+    free(pfmd);
+}
+
+RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, const int numPages, ReplacementStrategy strategy, void *stratData) {
+    if (checkFileExistence(pageFileName) != RC_OK) {
+        return (RC_message = "Unable to locate the specified file.", RC_FILE_NOT_FOUND);
+    }
+
+    PageFrameMD *pfmd;
+
+    // Zeroed so a failed initialization can be cleaned up by destroyPoolMetadata
+    pfmd = (PageFrameMD *)calloc(1, sizeof(PageFrameMD));
+    if (pfmd == NULL) return RC_FILE_NOT_FOUND;
+    pthread_mutex_init(&pfmd->replacementLatch, NULL);
+    pthread_mutex_init(&pfmd->fileLatch, NULL);
+    pthread_mutex_init(&pfmd->cleanerLatch, NULL);
+    pthread_cond_init(&pfmd->cleanerWakeup, NULL);
+    pthread_mutex_init(&pfmd->readAheadLatch, NULL);
+    pthread_mutex_init(&pfmd->ioLatch, NULL);
+    pthread_cond_init(&pfmd->ioWork, NULL);
+    pthread_mutex_init(&pfmd->completionLatch, NULL);
+    pthread_cond_init(&pfmd->completionReady, NULL);
+    pthread_mutex_init(&pfmd->traceLatch, NULL);
+    pthread_mutex_init(&pfmd->snapshotLatch, NULL);
+    pthread_cond_init(&pfmd->snapshotWakeup, NULL);
+
+    // Every read and write of the pool goes through this one handle until shutdown
+    if (openPageFile((char *)pageFileName, &pfmd->files[0]) != RC_OK) {
+        destroyPoolMetadata(pfmd, 0);
+        return RC_FILE_NOT_FOUND;
+    }
+    // The pool caches pages itself, stdio buffering would only copy them again and hold back writes
+    setvbuf(pfmd->files[0].mgmtInfo, NULL, _IONBF, 0);
+
+    // Address space for resizeBufferPool to grow into, only numPages frames are backed by memory
+    pfmd->ReservedFrames = (numPages > MAX_POOL_FRAMES) ? numPages : MAX_POOL_FRAMES;
+    if (allocatePageFrameNodes(pfmd, numPages) != RC_OK) {
+        destroyPoolMetadata(pfmd, 0);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    if (allocateFrameArena(pfmd, numPages) != RC_OK) {
+        destroyPoolMetadata(pfmd, 0);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    if (initPageTableShards(pfmd->pageTable, numPages) != RC_OK) {
+        destroyPoolMetadata(pfmd, 0);
+        return RC_FILE_NOT_FOUND;
+    }
+    pfmd->PageTableFrames = numPages;
+
+    // LRU-K reads k from stratData, without it every page keeps only its last reference (plain LRU)
+    pfmd->k = (stratData != NULL && *(int *)stratData > 0) ? *(int *)stratData : 1;
+    if (strategy == RS_LRU_K && initLRUKState(&pfmd->lruK, numPages, pfmd->k) != RC_OK) {
+        destroyPoolMetadata(pfmd, 0);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    if ((strategy == RS_ARC || strategy == RS_2Q) &&
+        initAdaptiveState(&pfmd->adaptive, strategy, numPages) != RC_OK) {
+        destroyPoolMetadata(pfmd, 0);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    // LFU reads an aging period from stratData, without it frequencies never decay
+    if (strategy == RS_LFU &&
+        initLFUState(&pfmd->lfu, numPages, (stratData != NULL) ? *(int *)stratData : 0) != RC_OK) {
+        destroyPoolMetadata(pfmd, 0);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    initFrameList(&pfmd->freeList, FREE_LIST);
+    initFrameList(&pfmd->replacementList, REPLACEMENT_LIST);
+
+    for (int index = 0; index < numPages; index++) {
+        // Initialize the page frame node, its data lives in the arena
+        initializePageFrameNode(&pfmd->frames[index], index, pfmd->frameArena);
+
+        // Every frame starts out free, frame 0 is handed out first
+        linkFrameAtHead(pfmd->frames, &pfmd->freeList, index);
+    }
+    pfmd->FramesInitialized = numPages;
+
+    // Assign values to the buffer pool structure
+    bm->numPages = numPages;
+    bm->pageFile = (char *)pageFileName;
+    bm->strategy = strategy;
+    bm->mgmtData = pfmd;
+
+    // Initialize the page frame metadata structure
+    pfmd->NumberOfFrames = numPages;
+    pfmd->NumberOfFramesFilled = 0;
+    atomic_init(&pfmd->NoOfReads, 0);
+    atomic_init(&pfmd->NoOfWrites, 0);
+    atomic_init(&pfmd->NumberOfDirtyFrames, 0);
+    atomic_init(&pfmd->CleanerHighWatermark, 0);
+    pfmd->clockPosition = 0;
+    pfmd->NextSequentialPage = NO_PAGE;
+
+    return RC_OK;
+}
+
+// Maps a page file for mapped frames. The pool does its own read-ahead, so the kernel is told not to
+// read around faults on the pages mapped so far. Needs the file latch
+RC mapFrameFile(SM_FileHandle *file)
+{
+    RC rc = mapPageFile(file);
+    if (rc == RC_OK && file->mappedPages > 0)
+    {
+        madvise(file->mapping, (size_t)file->mappedPages * PAGE_SIZE, MADV_RANDOM);
+    }
+    return rc;
+}
+
+// Maps the page files and lets frames point at their pages inside the mappings from now on, so pins copy
+// nothing. Writes to a pinned page stay private to the pool until the page is written back, evicting a
+// page drops that copy. Files registered later are mapped as well
+RC enableMappedFrames(BM_BufferPool *const bm)
+{
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    RC rc = RC_OK;
+    pthread_mutex_lock(&pfmd->fileLatch);
+    for (int fileId = 0; fileId < BM_MAX_PAGE_FILES && rc == RC_OK; fileId++)
+    {
+        if (pfmd->files[fileId].mgmtInfo != NULL)
+        {
+            rc = mapFrameFile(&pfmd->files[fileId]);
+        }
+    }
+    if (rc == RC_OK)
+    {
+        pfmd->MappedFrames = true;
+    }
+    pthread_mutex_unlock(&pfmd->fileLatch);
+    return rc;
+}
+
+// Switches the page transfers of an open pool to O_DIRECT, the pool becomes the only cache of its pages.
+// Frames live in the page-aligned arena, so every frame read and write qualifies. If the file system
+// refuses direct I/O the pool keeps working through the page cache and an error is returned.
+// Files registered later use direct I/O as well
+RC enableDirectIO(BM_BufferPool *const bm)
+{
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    RC rc = RC_OK;
+    pthread_mutex_lock(&pfmd->fileLatch);
+    for (int fileId = 0; fileId < BM_MAX_PAGE_FILES && rc == RC_OK; fileId++)
+    {
+        if (pfmd->files[fileId].mgmtInfo != NULL)
+        {
+            rc = enableDirectFileIO(&pfmd->files[fileId]);
+        }
+    }
+    pthread_mutex_unlock(&pfmd->fileLatch);
+    return rc;
+}
+
+// Starts recording every pinPage(), unpinPage() and markDirty() of the pool into a binary trace file
+// for run_trace_sim.exe: the BM_TRACE_MAGIC header followed by BM_TraceRecord entries. Batched,
+// asynchronous and scan pins are not recorded
+RC startPinTrace(BM_BufferPool *const bm, const char *const traceFileName)
+{
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    pthread_mutex_lock(&pfmd->traceLatch);
+    if (pfmd->traceFile != NULL)
+    {
+        pthread_mutex_unlock(&pfmd->traceLatch);
+        RC_message = "The pool is already recording a pin trace.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    pfmd->traceBuffer = (BM_TraceRecord *)malloc(sizeof(BM_TraceRecord) * TRACE_BUFFER_RECORDS);
+    pfmd->traceFile = (pfmd->traceBuffer != NULL) ? fopen(traceFileName, "wb") : NULL;
+    if (pfmd->traceFile == NULL || fwrite(BM_TRACE_MAGIC, 1, 8, pfmd->traceFile) != 8)
+    {
+        if (pfmd->traceFile != NULL)
+        {
+            fclose(pfmd->traceFile);
+            pfmd->traceFile = NULL;
+        }
+        free(pfmd->traceBuffer);
+        pfmd->traceBuffer = NULL;
+        pthread_mutex_unlock(&pfmd->traceLatch);
+        RC_message = "Unable to create the trace file.";
+        return RC_FILE_NOT_FOUND;
+    }
+    pfmd->TraceBuffered = 0;
+    pfmd->TraceWriteFailed = false;
+    pfmd->TraceStart = monotonicNanos();
+    atomic_store(&pfmd->Tracing, true);
+    pthread_mutex_unlock(&pfmd->traceLatch);
+
+    return RC_OK;
+}
+
+// Writes out the remaining records and closes the trace file. shutdownBufferPool stops a running trace
+RC stopPinTrace(BM_BufferPool *const bm)
+{
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    atomic_store(&pfmd->Tracing, false);
+    pthread_mutex_lock(&pfmd->traceLatch);
+    if (pfmd->traceFile == NULL)
+    {
+        pthread_mutex_unlock(&pfmd->traceLatch);
+        RC_message = "The pool is not recording a pin trace.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    flushTraceBuffer(pfmd);
+    bool failed = pfmd->TraceWriteFailed;
+    if (fclose(pfmd->traceFile) != 0)
+    {
+        failed = true;
+    }
+    pfmd->traceFile = NULL;
+    free(pfmd->traceBuffer);
+    pfmd->traceBuffer = NULL;
+    pthread_mutex_unlock(&pfmd->traceLatch);
+
+    if (failed)
+    {
+        RC_message = "The pin trace could not be written completely.";
+        return RC_WRITE_FAILED;
+    }
+    return RC_OK;
+}
+
+/// Page Cleaner ///
+
+void wakePageCleaner(PageFrameMD *pfmd)
+{
+    pthread_mutex_lock(&pfmd->cleanerLatch);
+    pthread_cond_signal(&pfmd->cleanerWakeup);
+    pthread_mutex_unlock(&pfmd->cleanerLatch);
+}
+
+// Lists the frames in the order the strategy is going to evict them, as far as it can be told
+// without changing its state. Needs the replacement latch
+int collectEvictionOrder(BM_BufferPool *const bm, int *order)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *frames = pfmd->frames;
+    int count = 0;
+
+    if (bm->strategy == RS_FIFO || bm->strategy == RS_LRU)
+    {
+        for (int i = pfmd->replacementList.tail; i != NO_FRAME; i = frames[i].Prev)
+        {
+            order[count++] = i;
+        }
+    }
+    else if (bm->strategy == RS_CLOCK)
+    {
+        // The hand sweeps forward from its current position
+        for (int step = 0; step < pfmd->NumberOfFrames; step++)
+        {
+            order[count++] = (pfmd->clockPosition + step) % pfmd->NumberOfFrames;
+        }
+    }
+    else if (bm->strategy == RS_LRU_K)
+    {
+        // Heap order, the next victim first and the rest roughly by backward k-distance
+        for (int pos = 0; pos < pfmd->lruK.heapSize; pos++)
+        {
+            order[count++] = pfmd->lruK.heap[pos];
+        }
+    }
+    else if (bm->strategy == RS_LFU)
+    {
+        for (int node = pfmd->lfu.head; node != NO_FRAME; node = pfmd->lfu.nodes[node].Next)
+        {
+            for (int i = pfmd->lfu.nodes[node].unpinned.tail; i != NO_FRAME; i = frames[i].Prev)
+            {
+                order[count++] = i;
+            }
+        }
+    }
+    else if (bm->strategy == RS_ARC || bm->strategy == RS_2Q)
+    {
+        // Which of the two lists gives up the next victim depends on the next miss, start with the recency list
+        for (int i = pfmd->adaptive.recent.tail; i != NO_FRAME; i = frames[i].Prev)
+        {
+            order[count++] = i;
+        }
+        for (int i = pfmd->adaptive.frequent.tail; i != NO_FRAME; i = frames[i].Prev)
+        {
+            order[count++] = i;
+        }
+    }
+    return count;
+}
+
+// Writes dirty, unpinned pages back in eviction order until the pool is down to the low watermark.
+// A failed write ends the round and is kept for stopPageCleaner. Returns the number of pages written
+int cleanDirtyFrames(BM_BufferPool *const bm)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    int written = 0;
+
+    pthread_mutex_lock(&pfmd->replacementLatch);
+    // The pool may have grown since the last round
+    if (pfmd->NumberOfFrames > pfmd->CleanerOrderSize)
+    {
+        int *order = (int *)realloc(pfmd->cleanerOrder, sizeof(int) * pfmd->NumberOfFrames);
+        if (order == NULL)
+        {
+            pthread_mutex_unlock(&pfmd->replacementLatch);
+            return 0;
+        }
+        pfmd->cleanerOrder = order;
+        pfmd->CleanerOrderSize = pfmd->NumberOfFrames;
+    }
+    int count = collectEvictionOrder(bm, pfmd->cleanerOrder);
+    pthread_mutex_unlock(&pfmd->replacementLatch);
+
+    for (int i = 0; i < count && atomic_load(&pfmd->NumberOfDirtyFrames) > pfmd->CleanerLowWatermark; i++)
+    {
+        PageFrameNode *frame = &pfmd->frames[pfmd->cleanerOrder[i]];
+
+        pthread_mutex_lock(&frame->latch);
+        bool cleanFrame = frame->DirtyFlag == 1 && atomic_load(&frame->FixCount) == 0;
+        PageNumber pageNum = frame->bh->pageNum;
+        pthread_mutex_unlock(&frame->latch);
+
+        // The frame may have been pinned or evicted since, writeBackResidentPage checks again
+        bool pageWritten = false;
+        RC rc = cleanFrame ? writeBackResidentPage(bm, pageNum, &pageWritten) : RC_OK;
+        if (rc != RC_OK)
+        {
+            if (pfmd->CleanerError == RC_OK)
+            {
+                pfmd->CleanerError = rc;
+            }
+            break;
+        }
+        if (pageWritten)
+        {
+            written++;
+        }
+    }
+    return written;
+}
+
+void *runPageCleaner(void *arg)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+
+    pthread_mutex_lock(&pfmd->cleanerLatch);
+    while (!pfmd->CleanerStopping)
+    {
+        if (atomic_load(&pfmd->NumberOfDirtyFrames) < atomic_load(&pfmd->CleanerHighWatermark))
+        {
+            pthread_cond_wait(&pfmd->cleanerWakeup, &pfmd->cleanerLatch);
+            continue;
+        }
+
+        pthread_mutex_unlock(&pfmd->cleanerLatch);
+        int written = cleanDirtyFrames(bm);
+        pthread_mutex_lock(&pfmd->cleanerLatch);
+
+        // Every dirty page is pinned, give the clients some time before looking again
+        if (written == 0 && !pfmd->CleanerStopping)
+        {
+            struct timespec retryAt;
+            clock_gettime(CLOCK_REALTIME, &retryAt);
+            retryAt.tv_nsec += 10 * 1000 * 1000;
+            if (retryAt.tv_nsec >= 1000 * 1000 * 1000)
+            {
+                retryAt.tv_sec++;
+                retryAt.tv_nsec -= 1000 * 1000 * 1000;
+            }
+            pthread_cond_timedwait(&pfmd->cleanerWakeup, &pfmd->cleanerLatch, &retryAt);
+        }
+    }
+    pthread_mutex_unlock(&pfmd->cleanerLatch);
+    return NULL;
+}
+
+// Starts a thread that writes dirty, unpinned pages back ahead of eviction once more than
+// highWatermark frames are dirty, until no more than lowWatermark are left
+RC startPageCleaner(BM_BufferPool *const bm, const int highWatermark, const int lowWatermark)
+{
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+    if (lowWatermark < 0 || lowWatermark >= highWatermark || highWatermark > bm->numPages)
+    {
+        RC_message = "Page cleaner watermarks must satisfy 0 <= low < high <= number of frames.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    if (atomic_load(&pfmd->CleanerHighWatermark) != 0)
+    {
+        RC_message = "The page cleaner of this buffer pool is already running.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    pthread_mutex_lock(&pfmd->replacementLatch);
+    pfmd->CleanerOrderSize = pfmd->NumberOfFrames;
+    pthread_mutex_unlock(&pfmd->replacementLatch);
+    pfmd->cleanerOrder = (int *)malloc(sizeof(int) * pfmd->CleanerOrderSize);
+    if (pfmd->cleanerOrder == NULL)
+    {
+        return RC_FILE_NOT_FOUND;
+    }
+    pfmd->CleanerLowWatermark = lowWatermark;
+    pfmd->CleanerStopping = false;
+    pfmd->CleanerError = RC_OK;
+    atomic_store(&pfmd->CleanerHighWatermark, highWatermark);
+
+    if (pthread_create(&pfmd->cleanerThread, NULL, runPageCleaner, bm) != 0)
+    {
+        atomic_store(&pfmd->CleanerHighWatermark, 0);
+        free(pfmd->cleanerOrder);
+        pfmd->cleanerOrder = NULL;
+        RC_message = "Unable to start the page cleaner thread.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    RC_message = "Page cleaner started.";
+    return RC_OK;
+}
+
+// Stops the page cleaner, pages it has not written yet stay dirty. Returns the error of the first
+// write-back of the cleaner that failed, if any
+RC stopPageCleaner(BM_BufferPool *const bm)
+{
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    if (atomic_load(&pfmd->CleanerHighWatermark) == 0)
+    {
+        RC_message = "The buffer pool has no page cleaner running.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    pthread_mutex_lock(&pfmd->cleanerLatch);
+    pfmd->CleanerStopping = true;
+    pthread_cond_signal(&pfmd->cleanerWakeup);
+    pthread_mutex_unlock(&pfmd->cleanerLatch);
+    pthread_join(pfmd->cleanerThread, NULL);
+
+    atomic_store(&pfmd->CleanerHighWatermark, 0);
+    free(pfmd->cleanerOrder);
+    pfmd->cleanerOrder = NULL;
+
+    if (pfmd->CleanerError != RC_OK)
+    {
+        RC_message = "Page cleaner stopped, writing a page back failed.";
+        return pfmd->CleanerError;
+    }
+    RC_message = "Page cleaner stopped.";
+    return RC_OK;
+}
+
+// Lets the I/O threads finish the queued reads and joins them
+void stopIoThreads(PageFrameMD *pfmd)
+{
+    pthread_mutex_lock(&pfmd->ioLatch);
+    bool started = pfmd->IoThreadsStarted;
+    pfmd->IoStopping = true;
+    pthread_cond_broadcast(&pfmd->ioWork);
+    pthread_mutex_unlock(&pfmd->ioLatch);
+
+    if (started)
+    {
+        for (int i = 0; i < pfmd->NumberOfIoThreads; i++)
+        {
+            pthread_join(pfmd->ioThreads[i], NULL);
+        }
+    }
+}
+
+//shutting down buffer bool
+#include <stdlib.h>
+
+int compareFlushEntries(const void *first, const void *second) {
+    PageNumber a = ((const FlushEntry *)first)->pageNum;
+    PageNumber b = ((const FlushEntry *)second)->pageNum;
+    return (a > b) - (a < b);
+}
+
+// Writes the dirty pages back in page order, every run of consecutive pages with one vectored write.
+// Pinned pages are left alone unless includePinned is set. *flushedPages receives the number of pages
+// written. The pages of a run that could not be written stay dirty, the first error is returned
+RC flushDirtyPages(BM_BufferPool *const bm, bool includePinned, int *flushedPages) {
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    atomic_fetch_add(&pfmd->NoOfFlushes, 1);
+    int numFrames = pfmd->NumberOfFrames; // a concurrent resize leaves the frames themselves in place
+    FlushEntry *entries = (FlushEntry *)malloc(sizeof(FlushEntry) * numFrames);
+    SM_PageHandle *run = (SM_PageHandle *)malloc(sizeof(SM_PageHandle) * MAX_PAGES_PER_WRITE);
+    int numEntries = 0;
+    int numWritten = 0;
+    int writeCalls = 0;
+    RC rc = RC_OK;
+
+    *flushedPages = 0;
+    if (entries == NULL || run == NULL) {
+        free(entries);
+        free(run);
+        RC_message = "Not enough memory to flush the dirty pages.";
+        return RC_WRITE_FAILED;
+    }
+
+    // Take the dirty pages out of the pool, pinned so they cannot be evicted while they are written
+    for (int i = 0; i < numFrames; i++) {
+        PageFrameNode *frame = &pfmd->frames[i];
+
+        pthread_mutex_lock(&frame->latch);
+        if (frame->DirtyFlag == 1 && (includePinned || atomic_load(&frame->FixCount) == 0) && tryPinFrame(frame)) {
+            entries[numEntries].pageNum = frame->bh->pageNum;
+            entries[numEntries].frameNum = i;
+            numEntries++;
+            frame->DirtyFlag = 0;
+            atomic_fetch_sub(&pfmd->NumberOfDirtyFrames, 1);
+        }
+        pthread_mutex_unlock(&frame->latch);
+    }
+
+    qsort(entries, numEntries, sizeof(FlushEntry), compareFlushEntries);
+
+    pthread_mutex_lock(&pfmd->fileLatch);
+    for (int start = 0; start < numEntries; ) {
+        int length = 0;
+        do {
+            run[length] = pfmd->frames[entries[start + length].frameNum].readContent;
+            length++;
+        } while (start + length < numEntries && length < MAX_PAGES_PER_WRITE &&
+                 entries[start + length].pageNum == entries[start].pageNum + length &&
+                 BM_PAGE_NUMBER(entries[start + length].pageNum) != 0);
+
+        // Sorted, so the last page of a run decides how far its file has to grow
+        SM_FileHandle *file = getPageFile(pfmd, entries[start].pageNum);
+        RC runRc = ensureCapacity(BM_PAGE_NUMBER(entries[start + length - 1].pageNum) + 1, file);
+        if (runRc == RC_OK) {
+            runRc = writeBlocks(BM_PAGE_NUMBER(entries[start].pageNum), length, file, run);
+        }
+        writeCalls++;
+
+        // The other runs are still written, maybe they go to a file that works
+        if (runRc != RC_OK) {
+            for (int i = start; i < start + length; i++) {
+                restoreDirtyFlag(pfmd, &pfmd->frames[entries[i].frameNum]);
+            }
+            if (rc == RC_OK) {
+                rc = runRc;
+            }
+        } else {
+            countPageWrites(pfmd, length);
+            numWritten += length;
+        }
+        start += length;
+    }
+    pthread_mutex_unlock(&pfmd->fileLatch);
+
+    for (int i = 0; i < numEntries; i++) {
+        releaseFramePin(bm, entries[i].frameNum);
+    }
+
+    pfmd->LastFlushPages = numWritten;
+    pfmd->LastFlushWriteCalls = writeCalls;
+    free(entries);
+    free(run);
+    *flushedPages = numWritten;
+    return rc;
+}
+
+// Must not run concurrently with any other call on the same pool
+RC shutdownBufferPool(BM_BufferPool *const bm) {
+    if (bm->mgmtData == NULL) {
+        RC_message = "Shut down was unsuccessful as buffer pool does not exist.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+
+    // The warmup, the cleaner and the I/O threads must not touch the frames once they are freed
+    if (pfmd->WarmupRunning)
+    {
+        atomic_store(&pfmd->WarmupStopping, true);
+        waitForPoolWarmup(bm, NULL);
+    }
+    // The last snapshot is taken while the pages are still resident
+    if (pfmd->snapshotFile != NULL)
+    {
+        savePoolContents(bm, pfmd->snapshotFile);
+        stopPoolSnapshots(bm);
+    }
+    stopPageCleaner(bm);
+    stopIoThreads(pfmd);
+    if (atomic_load(&pfmd->Tracing))
+    {
+        stopPinTrace(bm);
+    }
+
+    // Flush dirty pages if any, pinned ones included. The pool goes away even if some cannot be written
+    int flushedPages;
+    RC flushRc = flushDirtyPages(bm, true, &flushedPages);
+    int writeCalls = pfmd->LastFlushWriteCalls;
+
+    // Free the frames, page table and buffer pool management data
+    destroyPoolMetadata(pfmd, pfmd->FramesInitialized);
+
+    // Reset buffer pool properties
+    bm->mgmtData = NULL;
+    bm->numPages = 0;
+
+    // Set shutdown message based on flush status
+       // Set the shutdown message based on whether flushing was required
+    if (flushRc != RC_OK) {
+        RC_message = "Shut down with dirty pages that could not be written to disk.";
+        return flushRc;
+    }
+    if (flushedPages > 0) {
+        static char shutdownMessage[128];
+        snprintf(shutdownMessage, sizeof(shutdownMessage),
+                 "Shut down successful with flushing %d dirty pages in %d writes.", flushedPages, writeCalls);
+        RC_message = shutdownMessage;
+    } else {
+        RC_message = "Shut down successful without flushing any pages.";
+    }
+
+
+    return RC_OK;
+}
+
+
+// Flushing all dirty Pages
+RC forceFlushPool(BM_BufferPool *const bm)
+{
+    // Validate if the buffer pool exists before proceeding
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool does not exist. Force flush unsuccessful.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    // Flush the dirty pages that are not in use, getLastFlushPageCount and getLastFlushWriteCalls report the batch
+    static char flushMessage[128];
+    long long start = startLatencyTimer(getPoolMetadata(bm));
+    int flushedPages;
+    RC rc = flushDirtyPages(bm, false, &flushedPages);
+    recordLatency(getPoolMetadata(bm), BM_LATENCY_FLUSH_POOL, start);
+    if (rc != RC_OK)
+    {
+        RC_message = "Force flush failed, some dirty pages could not be written.";
+        return rc;
+    }
+    snprintf(flushMessage, sizeof(flushMessage), "Force flush completed successfully, %d pages in %d writes.",
+             flushedPages, getPoolMetadata(bm)->LastFlushWriteCalls);
+
+    RC_message = flushMessage;
+    return RC_OK;
+}
+
+
+
+/// Interface Access Pages///
+
+// write the current content of the page back to the page file on disk
+RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    // Validate if the buffer pool's management data exists
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    long long start = startLatencyTimer(pfmd);
+    atomic_fetch_add(&pfmd->NoOfFlushes, 1);
+
+    // Return error if the target page is not resident and dirty, or could not be written
+    bool written;
+    RC rc = writeBackResidentPage(bm, page->pageNum, &written);
+    recordLatency(pfmd, BM_LATENCY_FORCE_PAGE, start);
+    if (rc != RC_OK)
+    {
+        RC_message = "The page could not be written to disk.";
+        return rc;
+    }
+    if (!written)
+    {
+        RC_message = "The given page number is not marked as dirty.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+return (RC_message = "Page successfully written and flushed to disk.", RC_OK);
+
+}
+
+//making pages dirty
+RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    // Validate if the buffer pool's management data is available
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Error: Buffer pool is not initialized or is unavailable.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *pageFrameList = pfmd->frames;
+    bool pageMarkedDirty = false;
+    recordTrace(pfmd, BM_TRACE_MARK_DIRTY, page->pageNum);
+
+    // Find the frame holding the page through the page table
+    int frameIndex = findPinnedFrame(pfmd, page->pageNum);
+    if (frameIndex != NO_PAGE)
+    {
+        // Mark the page as dirty, unless the frame was refilled meanwhile. It is counted as a write once it reaches the disk
+        pthread_mutex_lock(&pageFrameList[frameIndex].latch);
+        pageMarkedDirty = pageFrameList[frameIndex].bh->pageNum == page->pageNum;
+        bool newlyDirty = pageMarkedDirty && !pageFrameList[frameIndex].DirtyFlag;
+        if (pageMarkedDirty)
+        {
+            pageFrameList[frameIndex].DirtyFlag = 1;
+        }
+        pthread_mutex_unlock(&pageFrameList[frameIndex].latch);
+
+        // Wake the page cleaner when the pool crosses its high watermark
+        if (newlyDirty)
+        {
+            int dirtyFrames = atomic_fetch_add(&pfmd->NumberOfDirtyFrames, 1) + 1;
+            if (dirtyFrames == atomic_load(&pfmd->CleanerHighWatermark))
+            {
+                wakePageCleaner(pfmd);
+            }
+        }
+    }
+
+    // Set success or error message based on whether the page was found and marked dirty
+    return (pageMarkedDirty ? (RC_message = "Success: Page flagged as dirty.", RC_OK) : (RC_message = "Error: Page not found in buffer pool, could not mark as dirty.", RC_FILE_NOT_FOUND));
+
+}
+
+//unpinning the page
+RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    // Validate that the buffer pool is open
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    recordTrace(getPoolMetadata(bm), BM_TRACE_UNPIN, page->pageNum);
+
+    // Find the frame holding the page, the caller's pin keeps it there without any latch
+    int frameIndex = findPinnedFrame(getPoolMetadata(bm), page->pageNum);
+    bool pageFoundAndUnpinned = frameIndex != NO_PAGE && releaseFramePin(bm, frameIndex);
+
+    // Single line for message and return
+    return (pageFoundAndUnpinned ? (RC_message = "Page successfully unpinned.", RC_OK) : (RC_message = "Failed to unpin page as it is not available in the buffer pool.", RC_FILE_NOT_FOUND));
+}
+
+// The victim choosers below run with the replacement latch held. They return a frame
+// claimed through tryClaimFrame and detached from the strategy's bookkeeping, or NO_FRAME
+// if every frame is pinned
+
+int chooseVictimFIFO(BM_BufferPool *const bm)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *pageFrameList = pfmd->frames;
+
+    // Walk from the oldest loaded page towards the newest one
+    for (int i = pfmd->replacementList.tail; i != NO_FRAME; i = pageFrameList[i].Prev)
+    {
+        // Check if the frame can be replaced
+        if (tryClaimFrame(&pageFrameList[i]))
+        {
+            unlinkFrame(pageFrameList, &pfmd->replacementList, i);
+            return i;
+        }
+    }
+
+    return NO_FRAME;
+}
+
+int chooseVictimLRU(BM_BufferPool *const bm)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *pageFrameList = pfmd->frames;
+
+    // Only unpinned frames are on the LRU list, its tail is the victim unless a
+    // concurrent pin got to it first
+    int j = claimFromTail(pageFrameList, &pfmd->replacementList);
+    if (j != NO_FRAME)
+    {
+        unlinkFrame(pageFrameList, &pfmd->replacementList, j);
+    }
+
+    return j;
+}
+
+int chooseVictimLRUK(BM_BufferPool *const bm)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+
+    // The top of the heap is the unpinned page with the largest backward k-distance
+    while (pfmd->lruK.heapSize > 0)
+    {
+        int j = pfmd->lruK.heap[0];
+
+        // A frame that cannot be claimed was pinned again, its next unpin pushes it back
+        removeLRUKHeap(&pfmd->lruK, pfmd->k, pfmd->frames, j);
+        if (tryClaimFrame(&pfmd->frames[j]))
+        {
+            retainPageHistory(&pfmd->lruK, pfmd->frames[j].HistoryIndex);
+            return j;
+        }
+    }
+
+    return NO_FRAME;
+}
+
+int chooseVictimLFU(BM_BufferPool *const bm)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+
+    // The new page starts over with a frequency of one once it is loaded
+    int j = claimVictimLFU(&pfmd->lfu, pfmd->frames);
+    if (j != NO_FRAME)
+    {
+        detachFrameLFU(&pfmd->lfu, pfmd->frames, j);
+    }
+
+    return j;
+}
+
+// REPLACE step of ARC: evict from T1 while it is above its target, otherwise from T2.
+// A pinned list falls back to the other one
+int claimVictimARC(AdaptiveState *state, PageFrameNode *frames, bool inFrequentGhosts)
+{
+    bool preferRecent = state->recent.size > 0 &&
+        (state->recent.size > state->target || (inFrequentGhosts && state->recent.size == state->target));
+    FrameList *first = preferRecent ? &state->recent : &state->frequent;
+    FrameList *second = preferRecent ? &state->frequent : &state->recent;
+
+    int victim = claimFromTail(frames, first);
+    return (victim != NO_FRAME) ? victim : claimFromTail(frames, second);
+}
+
+int chooseVictimARC(BM_BufferPool *const bm, const PageNumber pageNum)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    AdaptiveState *state = &pfmd->adaptive;
+    PageFrameNode *frames = pfmd->frames;
+    int capacity = pfmd->NumberOfFrames;
+    int j = NO_FRAME;
+    bool keepGhost = true;
+
+    int ghost = lookupPageTable(&state->ghostTable, pageNum);
+    bool inRecentGhosts = ghost != NO_PAGE && state->ghosts[ghost].ListId == RECENT_GHOSTS;
+    bool inFrequentGhosts = ghost != NO_PAGE && state->ghosts[ghost].ListId == FREQUENT_GHOSTS;
+    GhostList *b1 = &state->recentGhosts;
+    GhostList *b2 = &state->frequentGhosts;
+
+    if (inRecentGhosts)
+    {
+        // T1 was too small for this page, grow its target
+        int delta = (b2->size / b1->size > 1) ? b2->size / b1->size : 1;
+        state->target = (state->target + delta < capacity) ? state->target + delta : capacity;
+    }
+    else if (inFrequentGhosts)
+    {
+        // T2 was too small for this page, shrink the target of T1
+        int delta = (b1->size / b2->size > 1) ? b1->size / b2->size : 1;
+        state->target = (state->target - delta > 0) ? state->target - delta : 0;
+    }
+    else if (state->recent.size + b1->size >= capacity)
+    {
+        // Keep T1 and B1 within the pool size
+        if (state->recent.size < capacity)
+        {
+            dropGhostTail(state, b1);
+        }
+        else
+        {
+            j = claimFromTail(frames, &state->recent);
+            keepGhost = false;
+        }
+    }
+    else if (state->recent.size + state->frequent.size + b1->size + b2->size >= 2 * capacity)
+    {
+        dropGhostTail(state, b2);
+    }
+
+    if (keepGhost)
+    {
+        j = claimVictimARC(state, frames, inFrequentGhosts);
+    }
+    if (j == NO_FRAME)
+    {
+        return NO_FRAME;
+    }
+
+    if (keepGhost)
+    {
+        pushGhost(state, (frames[j].ListId == RECENT_LIST) ? b1 : b2, frames[j].bh->pageNum);
+    }
+    unlinkFrame(frames, &state->recent, j);
+    unlinkFrame(frames, &state->frequent, j);
+
+    // Loading moves ghost hits straight to T2
+    return j;
+}
+
+int chooseVictim2Q(BM_BufferPool *const bm, const PageNumber pageNum)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    AdaptiveState *state = &pfmd->adaptive;
+    PageFrameNode *frames = pfmd->frames;
+    int j = NO_FRAME;
+
+    // A1out hit: the page was re-referenced after leaving A1in, so give A1in more room
+    bool ghostHit = lookupPageTable(&state->ghostTable, pageNum) != NO_PAGE;
+    if (ghostHit && state->target < state->maxTarget)
+    {
+        state->target++;
+    }
+
+    if (state->recent.size > state->target)
+    {
+        j = claimFromTail(frames, &state->recent);
+    }
+    if (j == NO_FRAME)
+    {
+        j = claimFromTail(frames, &state->frequent);
+    }
+    if (j == NO_FRAME)
+    {
+        j = claimFromTail(frames, &state->recent);
+    }
+    if (j == NO_FRAME)
+    {
+        return NO_FRAME;
+    }
+
+    // Pages leaving A1in are remembered in A1out, pages leaving Am are not
+    if (frames[j].ListId == RECENT_LIST)
+    {
+        // The ghost of the requested page leaves A1out once the page is loaded
+        if (state->recentGhosts.size - (ghostHit ? 1 : 0) >= state->ghostLimit)
+        {
+            // The oldest ghost was never referenced again, so A1in can shrink
+            dropGhostTail(state, &state->recentGhosts);
+            if (state->target > 1)
+            {
+                state->target--;
+            }
+        }
+        pushGhost(state, &state->recentGhosts, frames[j].bh->pageNum);
+    }
+    unlinkFrame(frames, &state->recent, j);
+    unlinkFrame(frames, &state->frequent, j);
+
+    // Loading moves A1out hits straight to Am
+    return j;
+}
+
+// Main CLOCK victim selection
+int chooseVictimCLOCK(BM_BufferPool *const bm)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);  // Retrieve this pool's bookkeeping
+    PageFrameNode *pageFrameList = pfmd->frames;  // Retrieve the page frames from the buffer manager
+
+    // Two sweeps of the hand are enough: the first one clears every reference bit it passes
+    for (int step = 0; step < 2 * bm->numPages; step++)
+    {
+        int j = pfmd->clockPosition;
+        PageFrameNode *currentFrame = &pageFrameList[j];  // Get the frame under the clock hand
+        pfmd->clockPosition = (j + 1) % bm->numPages;  // Advance the clock hand
+
+        // Pinned frames are never replaced and keep their reference bit
+        if (!isFrameEvictable(currentFrame))
+        {
+            continue;
+        }
+
+        // If the page was recently used, reset the flag and continue
+        if (atomic_exchange(&currentFrame->UsedFlag, 0) == 1)
+        {
+            continue;
+        }
+
+        // The page is not recently used, so it is replaced unless it was pinned meanwhile
+        if (tryClaimFrame(currentFrame))
+        {
+            return j;
+        }
+    }
+
+    return NO_FRAME;
+}
+
+
+
+// Function to pick the frame to replace when the buffer is full (if-else version)
+int handleBufferReplacement(BM_BufferPool *const bm, const PageNumber pageNum)
+{
+    if (bm->strategy == RS_FIFO)
+    {
+        return chooseVictimFIFO(bm);
+    }
+    else if (bm->strategy == RS_LRU)
+    {
+        return chooseVictimLRU(bm);
+    }
+    else if (bm->strategy == RS_LRU_K)
+    {
+        return chooseVictimLRUK(bm);
+    }
+    else if (bm->strategy == RS_LFU)
+    {
+        return chooseVictimLFU(bm);
+    }
+    else if (bm->strategy == RS_ARC)
+    {
+        return chooseVictimARC(bm, pageNum);
+    }
+    else if (bm->strategy == RS_2Q)
+    {
+        return chooseVictim2Q(bm, pageNum);
+    }
+    else if (bm->strategy == RS_CLOCK)
+    {
+        return chooseVictimCLOCK(bm);
+    }
+    else
+    {
+        // No frame if the strategy is unknown
+        return NO_FRAME;
+    }
+}
+
+// Takes a frame claimed outside of the victim choosers off the strategy's bookkeeping, as the
+// choosers do for their victims. Scan pages leave no ghosts behind. Needs the replacement latch
+void detachClaimedFrame(BM_BufferPool *const bm, int frameNum)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *frames = pfmd->frames;
+
+    if (bm->strategy == RS_FIFO || bm->strategy == RS_LRU)
+    {
+        unlinkFrame(frames, &pfmd->replacementList, frameNum);
+    }
+    else if (bm->strategy == RS_LRU_K)
+    {
+        removeLRUKHeap(&pfmd->lruK, pfmd->k, frames, frameNum);
+        retainPageHistory(&pfmd->lruK, frames[frameNum].HistoryIndex);
+    }
+    else if (bm->strategy == RS_LFU)
+    {
+        detachFrameLFU(&pfmd->lfu, frames, frameNum);
+    }
+    else if (bm->strategy == RS_ARC || bm->strategy == RS_2Q)
+    {
+        unlinkFrame(frames, &pfmd->adaptive.recent, frameNum);
+        unlinkFrame(frames, &pfmd->adaptive.frequent, frameNum);
+    }
+}
+
+// Takes the next frame off the free list, claimed like a victim. Needs the replacement latch.
+// Free frames keep a fix count of -1, so no latch-free pin can get hold of them
+int claimEmptyFrame(PageFrameMD *pfmd)
+{
+    int i = popFrameAtTail(pfmd->frames, &pfmd->freeList);
+    if (i == NO_FRAME)
+    {
+        return NO_FRAME;  // Return no frame if no empty frame was found
+    }
+
+    pthread_mutex_lock(&pfmd->frames[i].latch);
+    atomic_store(&pfmd->frames[i].IoInProgress, true);
+    pthread_mutex_unlock(&pfmd->frames[i].latch);
+
+    pfmd->NumberOfFramesFilled++; // Increment filled frame count
+    return i;
+}
+
+// Hands out a claimed frame for a new page: an empty one while there is one, a victim otherwise
+int claimFrameForPage(BM_BufferPool *const bm, const PageNumber pageNum)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+
+    pthread_mutex_lock(&pfmd->replacementLatch);
+    int frameNum = claimEmptyFrame(pfmd);
+    if (frameNum == NO_FRAME)
+    {
+        long long start = startLatencyTimer(pfmd);
+        frameNum = handleBufferReplacement(bm, pageNum);
+        recordLatency(pfmd, BM_LATENCY_VICTIM_SELECTION, start);
+    }
+    pthread_mutex_unlock(&pfmd->replacementLatch);
+
+    return frameNum;
+}
+
+// Gives a claimed frame that ended up unused back to the free list
+void returnFrameToFreeList(BM_BufferPool *const bm, int frameNum)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *frame = &pfmd->frames[frameNum];
+
+    pthread_mutex_lock(&pfmd->replacementLatch);
+    pthread_mutex_lock(&frame->latch);
+    frame->bh->pageNum = NO_PAGE;
+    frame->DirtyFlag = 0;
+    pthread_mutex_unlock(&frame->latch);
+    linkFrameAtHead(pfmd->frames, &pfmd->freeList, frameNum);
+    pfmd->NumberOfFramesFilled--;
+    pthread_mutex_unlock(&pfmd->replacementLatch);
+
+    finishFrameIo(frame);
+}
+
+// Empties a claimed frame: writes its page back if needed and removes it from the page table.
+// If the write fails the page stays in the frame, still dirty, and the caller has to give the frame
+// back with restoreClaimedFrameLocked
+RC evictFrame(BM_BufferPool *const bm, PageFrameNode *frame)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageNumber evictedPageNum = frame->bh->pageNum;
+    if (evictedPageNum == NO_PAGE)
+    {
+        return RC_OK;
+    }
+    long long start = startLatencyTimer(pfmd);
+
+    // Check dirty status
+    pthread_mutex_lock(&frame->latch);
+    bool dirty = frame->DirtyFlag;
+    frame->DirtyFlag = 0;
+    if (dirty)
+    {
+        atomic_fetch_sub(&pfmd->NumberOfDirtyFrames, 1);
+    }
+    pthread_mutex_unlock(&frame->latch);
+    if (dirty)
+    {
+        RC rc = writeDirtyPageToDisk(bm, frame, evictedPageNum);
+        if (rc != RC_OK)
+        {
+            return rc;
+        }
+    }
+    atomic_fetch_add(dirty ? &pfmd->NoOfDirtyEvictions : &pfmd->NoOfCleanEvictions, 1);
+
+    // A frame pointing into the file mapping drops its private copy of the page, the file holds
+    // everything that was marked dirty, and the next access reads the page from the file again
+    if (frame->readContent != frameArenaSlot(pfmd, frame->FrameNum))
+    {
+        madvise(frame->readContent, PAGE_SIZE, MADV_DONTNEED);
+        frame->readContent = frameArenaSlot(pfmd, frame->FrameNum);
+    }
+
+    // The page stays mapped until it is on disk, so nobody reads a stale copy in the meantime
+    PageTableShard *shard = getPageTableShard(pfmd, evictedPageNum);
+    pthread_mutex_lock(&shard->latch);
+    removePageTable(getShardTable(shard), evictedPageNum);
+    pthread_mutex_lock(&frame->latch);
+    frame->bh->pageNum = NO_PAGE;
+    pthread_mutex_unlock(&frame->latch);
+    pthread_mutex_unlock(&shard->latch);
+
+    recordLatency(pfmd, BM_LATENCY_EVICTION, start);
+    return RC_OK;
+}
+
+// Empties a claimed frame and publishes pageNum in it, pinned once and with the read still pending.
+// Returns false if another thread loaded the same page in the meantime, the frame then goes back to the free list,
+// or if the page held by the frame could not be written back, the frame then keeps it and *rc has the error
+bool installPageInFrame(BM_BufferPool *const bm, int frameNum, const PageNumber pageNum, RC *rc)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *frame = &pfmd->frames[frameNum];
+    PageTableShard *shard = getPageTableShard(pfmd, pageNum);
+
+    *rc = evictFrame(bm, frame);
+    if (*rc != RC_OK)
+    {
+        pthread_mutex_lock(&pfmd->replacementLatch);
+        restoreClaimedFrameLocked(bm, frameNum);
+        pthread_mutex_unlock(&pfmd->replacementLatch);
+        return false;
+    }
+
+    // Publish the page before reading it, concurrent pins of the page wait for the read
+    pthread_mutex_lock(&shard->latch);
+    if (lookupPageTable(getShardTable(shard), pageNum) != NO_PAGE)
+    {
+        pthread_mutex_unlock(&shard->latch);
+        returnFrameToFreeList(bm, frameNum);
+        return false;
+    }
+    insertPageTable(getShardTable(shard), pageNum, frameNum);
+    pthread_mutex_lock(&frame->latch);
+    frame->bh->pageNum = pageNum;
+    frame->bh->data = frame->readContent;
+    frame->DirtyFlag = 0;
+    frame->ReadError = RC_OK;
+    atomic_store(&frame->ReadAheadMark, 0);
+    atomic_store(&frame->FixCount, 1); // publishes the page number to latch-free pins
+    pthread_mutex_unlock(&frame->latch);
+    pthread_mutex_unlock(&shard->latch);
+
+    return true;
+}
+
+// Undoes installPageInFrame after the read of pageNum failed with rc. The page leaves the page table,
+// the asynchronous pins that joined the read complete with rc and synchronous pins waiting for it look
+// the page up again, see completeHit. Once only the pin of the failed read is left, the frame goes back
+// to the free list. The caller owns that pin and must not have made the frame known to the strategy
+void failPageRead(BM_BufferPool *const bm, int frameNum, const PageNumber pageNum, RC rc)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *frame = &pfmd->frames[frameNum];
+    PageTableShard *shard = getPageTableShard(pfmd, pageNum);
+
+    pthread_mutex_lock(&shard->latch);
+    removePageTable(getShardTable(shard), pageNum);
+    pthread_mutex_unlock(&shard->latch);
+
+    // IoInProgress stays set, so nobody else claims the frame while the pins drain
+    pthread_mutex_lock(&frame->latch);
+    frame->ReadError = rc;
+    BM_PinRequest *waiters = frame->ioWaiters;
+    frame->ioWaiters = NULL;
+    for (BM_PinRequest *request = waiters; request != NULL; request = request->next)
+    {
+        atomic_fetch_sub(&frame->FixCount, 1);
+        request->rc = rc;
+    }
+    pthread_cond_broadcast(&frame->ioDone);
+
+    int readerPin = 1;
+    while (!atomic_compare_exchange_strong(&frame->FixCount, &readerPin, -1))
+    {
+        pthread_cond_wait(&frame->ioDone, &frame->latch);
+        readerPin = 1;
+    }
+    frame->readContent = frameArenaSlot(pfmd, frameNum);
+    pthread_mutex_unlock(&frame->latch);
+
+    completePinRequests(bm, waiters);
+    returnFrameToFreeList(bm, frameNum);
+}
+
+// Reads pageNum into a claimed frame and pins it for the caller. Returns false if another
+// thread read the same page in the meantime, the frame then goes back to the free list.
+// Otherwise *rc tells whether the eviction and the read succeeded, the page is only pinned if they did
+bool loadPageIntoFrame(BM_BufferPool *const bm, BM_PageHandle *const page, int frameNum, const PageNumber pageNum, RC *rc)
+{
+    PageFrameNode *frame = &getPoolMetadata(bm)->frames[frameNum];
+
+    if (!installPageInFrame(bm, frameNum, pageNum, rc))
+    {
+        return *rc != RC_OK;
+    }
+
+    *rc = loadPageFromDisk(bm, frame, pageNum);
+    if (*rc != RC_OK)
+    {
+        failPageRead(bm, frameNum, pageNum, *rc);
+        return true;
+    }
+    updateBufferAndPageHandle(frame, page, pageNum);
+
+    // Make the newly loaded page known to the replacement strategy before anybody else sees it
+    trackLoadedFrame(bm, frameNum);
+    completeJoinedPins(bm, finishFrameIo(frame));
+
+    return true;
+}
+
+
+/// Pool Resizing ///
+
+#define RESIZE_ATTEMPTS 50 // passes of a shrink waiting for frames that are being read or written
+#define RESIZE_RETRY_NANOS (1000 * 1000)
+
+// List a frame is linked into, from its ListId. Needs the replacement latch
+FrameList *getFrameList(PageFrameMD *pfmd, int listId)
+{
+    if (listId == FREE_LIST)
+    {
+        return &pfmd->freeList;
+    }
+    else if (listId == REPLACEMENT_LIST)
+    {
+        return &pfmd->replacementList;
+    }
+    else if (listId == RECENT_LIST)
+    {
+        return &pfmd->adaptive.recent;
+    }
+    else if (listId == FREQUENT_LIST)
+    {
+        return &pfmd->adaptive.frequent;
+    }
+    else if (listId >= FIRST_FREQUENCY_LIST)
+    {
+        FrequencyNode *node = &pfmd->lfu.nodes[(listId - FIRST_FREQUENCY_LIST) / 2];
+        return ((listId - FIRST_FREQUENCY_LIST) % 2 == 0) ? &node->unpinned : &node->pinned;
+    }
+    else
+    {
+        return NULL;
+    }
+}
+
+// Moves the page of a claimed frame into a claimed empty frame, which takes over its place in the
+// strategy's bookkeeping. The page is published unpinned in its new frame, both frames stay claimed
+// until finishFrameIo. Needs the replacement latch
+void moveFramePage(BM_BufferPool *const bm, int from, int to)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *source = &pfmd->frames[from];
+    PageFrameNode *target = &pfmd->frames[to];
+    PageNumber pageNum = source->bh->pageNum;
+
+    // A mapped frame only points at its page
+    if (source->readContent != frameArenaSlot(pfmd, from))
+    {
+        target->readContent = source->readContent;
+        source->readContent = frameArenaSlot(pfmd, from);
+    }
+    else
+    {
+        memcpy(target->readContent, source->readContent, PAGE_SIZE);
+    }
+
+    FrameList *list = getFrameList(pfmd, source->ListId);
+    if (list != NULL)
+    {
+        replaceFrameInList(pfmd->frames, list, from, to);
+    }
+    target->HistoryIndex = source->HistoryIndex;
+    target->FrequencyNode = source->FrequencyNode;
+    target->HeapPos = source->HeapPos;
+    if (target->HeapPos != NO_FRAME)
+    {
+        pfmd->lruK.heap[target->HeapPos] = to;
+    }
+    source->HistoryIndex = NO_PAGE;
+    source->FrequencyNode = NO_FRAME;
+    source->HeapPos = NO_FRAME;
+    atomic_store(&target->UsedFlag, atomic_exchange(&source->UsedFlag, 0));
+    atomic_store(&target->ReadAheadMark, atomic_exchange(&source->ReadAheadMark, 0));
+
+    // Pins that still find the page in its old frame wait for finishFrameIo and look it up again
+    PageTableShard *shard = getPageTableShard(pfmd, pageNum);
+    pthread_mutex_lock(&shard->latch);
+    insertPageTable(getShardTable(shard), pageNum, to);
+    pthread_mutex_lock(&source->latch);
+    bool dirty = source->DirtyFlag;
+    source->bh->pageNum = NO_PAGE;
+    source->bh->data = NULL;
+    source->DirtyFlag = 0;
+    pthread_mutex_unlock(&source->latch);
+    pthread_mutex_lock(&target->latch);
+    target->bh->pageNum = pageNum;
+    target->bh->data = target->readContent;
+    target->DirtyFlag = dirty;
+    atomic_store(&target->FixCount, 0); // publishes the page number to latch-free pins
+    pthread_mutex_unlock(&target->latch);
+    pthread_mutex_unlock(&shard->latch);
+}
+
+// Adds the frames from the current size up to numPages, all of them empty. Frames released by an
+// earlier shrink get their memory back and are reused. Needs the replacement latch
+RC growBufferPool(BM_BufferPool *const bm, const int numPages)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *frames = pfmd->frames;
+    RC strategyState = RC_OK;
+
+    if (commitPageFrameNodes(pfmd, numPages) != RC_OK || commitFrameArena(pfmd, numPages) != RC_OK)
+    {
+        return RC_FILE_NOT_FOUND;
+    }
+
+    // Every shard stays sized for the whole pool
+    if (numPages > pfmd->PageTableFrames)
+    {
+        if (growPageTableShards(pfmd->pageTable, numPages) != RC_OK)
+        {
+            return RC_FILE_NOT_FOUND;
+        }
+        pfmd->PageTableFrames = numPages;
+    }
+
+    if (bm->strategy == RS_LRU_K)
+    {
+        strategyState = growLRUKState(&pfmd->lruK, numPages, pfmd->k);
+    }
+    else if (bm->strategy == RS_LFU)
+    {
+        strategyState = growLFUState(&pfmd->lfu, numPages);
+    }
+    else if (bm->strategy == RS_ARC || bm->strategy == RS_2Q)
+    {
+        strategyState = growAdaptiveState(&pfmd->adaptive, numPages);
+    }
+    if (strategyState != RC_OK)
+    {
+        return RC_FILE_NOT_FOUND;
+    }
+
+    for (int index = pfmd->NumberOfFrames; index < numPages; index++)
+    {
+        if (index < pfmd->FramesInitialized)
+        {
+            // A stale reader may still look at a released frame, so it is reset under its latch
+            pthread_mutex_lock(&frames[index].latch);
+            resetPageFrameNode(&frames[index], index, pfmd->frameArena);
+            pthread_mutex_unlock(&frames[index].latch);
+        }
+        else
+        {
+            initializePageFrameNode(&frames[index], index, pfmd->frameArena);
+        }
+        linkFrameAtHead(frames, &pfmd->freeList, index);
+    }
+    if (numPages > pfmd->FramesInitialized)
+    {
+        pfmd->FramesInitialized = numPages;
+    }
+
+    pfmd->NumberOfFrames = numPages;
+    bm->numPages = numPages;
+    if (bm->strategy == RS_ARC || bm->strategy == RS_2Q)
+    {
+        setAdaptiveLimits(&pfmd->adaptive, bm->strategy, numPages);
+    }
+    return RC_OK;
+}
+
+// One pass of a shrink to numPages frames: takes the free frames past the new end off the free list,
+// evicts by the strategy until the resident pages fit into the frames that are left, and moves the pages
+// still held past the new end into the frames that were freed. vacated marks the frames emptied for good.
+// Returns how many frames past the new end are still in use, busyWithIo tells whether any of them was only
+// being read or written. A page that cannot be written back stops the evictions, *writeRc has the error.
+// Needs the replacement latch
+int vacateFrames(BM_BufferPool *const bm, const int numPages, bool *vacated, bool *busyWithIo, RC *writeRc)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *frames = pfmd->frames;
+    int inUse = 0;
+
+    for (int i = numPages; i < pfmd->NumberOfFrames; i++)
+    {
+        if (frames[i].ListId == FREE_LIST)
+        {
+            unlinkFrame(frames, &pfmd->freeList, i);
+            vacated[i] = true;
+        }
+    }
+
+    while (pfmd->NumberOfFramesFilled > numPages)
+    {
+        int victim = handleBufferReplacement(bm, NO_PAGE);
+        if (victim == NO_FRAME)
+        {
+            break;
+        }
+
+        *writeRc = evictFrame(bm, &frames[victim]);
+        if (*writeRc != RC_OK)
+        {
+            restoreClaimedFrameLocked(bm, victim);
+            break;
+        }
+        pfmd->NumberOfFramesFilled--;
+        if (victim < numPages)
+        {
+            linkFrameAtHead(frames, &pfmd->freeList, victim);
+        }
+        else
+        {
+            vacated[victim] = true;
+        }
+        finishFrameIo(&frames[victim]);
+    }
+
+    for (int i = numPages; i < pfmd->NumberOfFrames; i++)
+    {
+        if (vacated[i])
+        {
+            continue;
+        }
+
+        // Pinned pages stay where they are, frames of other threads' reads and evictions are tried again
+        int target = claimEmptyFrame(pfmd);
+        if (target == NO_FRAME || !tryClaimFrame(&frames[i]))
+        {
+            if (target != NO_FRAME)
+            {
+                linkFrameAtHead(frames, &pfmd->freeList, target);
+                pfmd->NumberOfFramesFilled--;
+                finishFrameIo(&frames[target]);
+            }
+            if (atomic_load(&frames[i].IoInProgress))
+            {
+                *busyWithIo = true;
+            }
+            inUse++;
+            continue;
+        }
+
+        moveFramePage(bm, i, target);
+        pfmd->NumberOfFramesFilled--;
+        vacated[i] = true;
+        finishFrameIo(&frames[i]);
+        completePinRequests(bm, finishFrameIo(&frames[target]));
+        trackUnpinnedFrameLocked(bm, target);
+    }
+
+    return inUse;
+}
+
+// Ends a shrink after its last pass. The pool keeps every frame up to the last one still in use,
+// the memory of the frames after it goes back to the system. Needs the replacement latch
+void finishShrink(BM_BufferPool *const bm, const int numPages, const bool *vacated)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    int newSize = numPages;
+
+    for (int i = numPages; i < pfmd->NumberOfFrames; i++)
+    {
+        if (!vacated[i])
+        {
+            newSize = i + 1;
+        }
+    }
+    for (int i = numPages; i < newSize; i++)
+    {
+        if (vacated[i])
+        {
+            linkFrameAtHead(pfmd->frames, &pfmd->freeList, i);
+        }
+    }
+
+    pfmd->NumberOfFrames = newSize;
+    bm->numPages = newSize;
+    if (pfmd->clockPosition >= newSize)
+    {
+        pfmd->clockPosition = 0;
+    }
+
+    // ARC and 2Q trim ghost lists that are now too long on their next misses
+    if (bm->strategy == RS_ARC || bm->strategy == RS_2Q)
+    {
+        setAdaptiveLimits(&pfmd->adaptive, bm->strategy, newSize);
+    }
+    releaseFrameArena(pfmd, newSize);
+}
+
+// Changes the number of frames of a pool while it is in use. Growing keeps every resident page in its frame.
+// Shrinking evicts unpinned pages by the pool's strategy until the resident pages fit, moves the pages left
+// past the new end into freed frames and gives the memory of the removed frames back to the system.
+// Pinned pages are neither evicted nor moved, the pool then stays larger and an error is returned.
+// The pool can grow up to the address space reserved by initBufferPool, resizes must not overlap each other
+RC resizeBufferPool(BM_BufferPool *const bm, const int numPages)
+{
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    if (numPages <= 0 || numPages > pfmd->ReservedFrames)
+    {
+        RC_message = "The new number of frames must be positive and within the space reserved for the pool.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    if (numPages > pfmd->NumberOfFrames)
+    {
+        pthread_mutex_lock(&pfmd->replacementLatch);
+        RC grown = growBufferPool(bm, numPages);
+        pthread_mutex_unlock(&pfmd->replacementLatch);
+
+        RC_message = (grown == RC_OK) ? "Buffer pool resized." : "Not enough memory to grow the buffer pool.";
+        return grown;
+    }
+
+    bool *vacated = (bool *)calloc(pfmd->NumberOfFrames, sizeof(bool));
+    if (vacated == NULL)
+    {
+        return RC_FILE_NOT_FOUND;
+    }
+
+    int inUse = 0;
+    RC writeRc = RC_OK;
+    for (int attempt = 0; attempt < RESIZE_ATTEMPTS; attempt++)
+    {
+        bool busyWithIo = false;
+
+        pthread_mutex_lock(&pfmd->replacementLatch);
+        inUse = vacateFrames(bm, numPages, vacated, &busyWithIo, &writeRc);
+        if (inUse == 0 || !busyWithIo || writeRc != RC_OK || attempt == RESIZE_ATTEMPTS - 1)
+        {
+            finishShrink(bm, numPages, vacated);
+            pthread_mutex_unlock(&pfmd->replacementLatch);
+            break;
+        }
+        pthread_mutex_unlock(&pfmd->replacementLatch);
+
+        // The owners of those frames need the replacement latch to finish with them
+        struct timespec pause = {0, RESIZE_RETRY_NANOS};
+        nanosleep(&pause, NULL);
+    }
+    free(vacated);
+
+    if (writeRc != RC_OK)
+    {
+        RC_message = "A page that could not be written back kept the buffer pool from shrinking.";
+        return writeRc;
+    }
+    if (inUse > 0)
+    {
+        RC_message = "Pinned pages kept the buffer pool from shrinking to the requested size.";
+        return RC_FILE_NOT_FOUND;
+    }
+    RC_message = "Buffer pool resized.";
+    return RC_OK;
+}
+
+
+/// Page Files ///
+
+#define UNREGISTER_ATTEMPTS 50 // passes waiting for the page cleaner or a read to let go of pages of the file
+
+// Adds a page file to the pool. Its pages share the frames, the page table and the replacement strategy
+// with every other file of the pool, so a busy file ends up with more frames than an idle one. They are
+// pinned, marked dirty, forced and unpinned through their page keys, BM_PAGE_KEY(*fileId, pageNum).
+// The file name is kept like the one given to initBufferPool. Mapped frames and direct I/O of the pool
+// apply to the file as well
+RC registerPageFile(BM_BufferPool *const bm, const char *const pageFileName, int *const fileId)
+{
+    if (bm->mgmtData == NULL || pageFileName == NULL || checkFileExistence(pageFileName) != RC_OK)
+    {
+        RC_message = "Buffer pool or page file not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    RC rc = RC_FILE_NOT_FOUND;
+
+    pthread_mutex_lock(&pfmd->fileLatch);
+    for (int id = 1; id < BM_MAX_PAGE_FILES && rc != RC_OK; id++)
+    {
+        SM_FileHandle *file = &pfmd->files[id];
+        if (file->mgmtInfo != NULL)
+        {
+            continue;
+        }
+        if (openPageFile((char *)pageFileName, file) != RC_OK)
+        {
+            break;
+        }
+
+        // Reads fall back to copies and the page cache if the file cannot be mapped or opened for direct I/O
+        setvbuf(file->mgmtInfo, NULL, _IONBF, 0);
+        if (pfmd->files[0].directFd >= 0)
+        {
+            enableDirectFileIO(file);
+        }
+        if (pfmd->MappedFrames)
+        {
+            mapFrameFile(file);
+        }
+        *fileId = id;
+        rc = RC_OK;
+    }
+    pthread_mutex_unlock(&pfmd->fileLatch);
+
+    RC_message = (rc == RC_OK) ? "Page file registered." : "No file id left or the page file could not be opened.";
+    return rc;
+}
+
+// Evicts the resident pages of a file that nobody holds, dirty ones are written back. Pages that cannot
+// be written back stay, *writeRc has the error. Returns how many of its pages are left. Needs the replacement latch
+int evictFilePages(BM_BufferPool *const bm, const int fileId, RC *writeRc)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *frames = pfmd->frames;
+    int remaining = 0;
+
+    for (int i = 0; i < pfmd->NumberOfFrames; i++)
+    {
+        PageFrameNode *frame = &frames[i];
+
+        pthread_mutex_lock(&frame->latch);
+        PageNumber pageNum = frame->bh->pageNum;
+        pthread_mutex_unlock(&frame->latch);
+        if (pageNum == NO_PAGE || BM_PAGE_FILE_ID(pageNum) != fileId)
+        {
+            continue;
+        }
+
+        if (!tryClaimFrameHolding(frame, pageNum))
+        {
+            remaining++;
+            continue;
+        }
+        detachClaimedFrame(bm, i);
+        RC rc = evictFrame(bm, frame);
+        if (rc != RC_OK)
+        {
+            restoreClaimedFrameLocked(bm, i);
+            *writeRc = rc;
+            remaining++;
+            continue;
+        }
+        linkFrameAtHead(frames, &pfmd->freeList, i);
+        pfmd->NumberOfFramesFilled--;
+        finishFrameIo(frame);
+    }
+
+    return remaining;
+}
+
+// Removes a file added with registerPageFile: its pages are evicted, dirty ones written back, and the file
+// is closed. Its id may be handed out again afterwards. No page of the file may be pinned; if one is, the
+// file stays registered with the pages that could not be evicted and an error is returned.
+// The file given to initBufferPool stays until shutdownBufferPool
+RC unregisterPageFile(BM_BufferPool *const bm, const int fileId)
+{
+    if (bm->mgmtData == NULL || fileId <= 0 || fileId >= BM_MAX_PAGE_FILES ||
+        getPoolMetadata(bm)->files[fileId].mgmtInfo == NULL)
+    {
+        RC_message = "Buffer pool or registered page file not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    int remaining = 0;
+    RC writeRc = RC_OK;
+    for (int attempt = 0; attempt < UNREGISTER_ATTEMPTS; attempt++)
+    {
+        pthread_mutex_lock(&pfmd->replacementLatch);
+        remaining = evictFilePages(bm, fileId, &writeRc);
+        pthread_mutex_unlock(&pfmd->replacementLatch);
+        if (remaining == 0 || writeRc != RC_OK)
+        {
+            break;
+        }
+
+        // The page cleaner pins the pages it writes back, give it time to finish
+        struct timespec pause = {0, RESIZE_RETRY_NANOS};
+        nanosleep(&pause, NULL);
+    }
+    if (writeRc != RC_OK)
+    {
+        RC_message = "Dirty pages of the file could not be written back.";
+        return writeRc;
+    }
+    if (remaining > 0)
+    {
+        RC_message = "Pages of the file are still pinned.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    pthread_mutex_lock(&pfmd->fileLatch);
+    closePageFile(&pfmd->files[fileId]);
+    pthread_mutex_unlock(&pfmd->fileLatch);
+
+    RC_message = "Page file unregistered.";
+    return RC_OK;
+}
+
+
+/// Read-Ahead ///
+
+// Largest read-ahead window of the pool, 0 if the pool is too small to spare frames for it
+// or read-ahead is turned off
+int maxReadAheadWindow(BM_BufferPool *const bm)
+{
+    if (atomic_load_explicit(&getPoolMetadata(bm)->ReadAheadDisabled, memory_order_relaxed))
+    {
+        return 0;
+    }
+
+    int window = getPoolMetadata(bm)->NumberOfFrames / 8;
+    if (window > READ_AHEAD_MAX_PAGES)
+    {
+        window = READ_AHEAD_MAX_PAGES;
+    }
+    return (window >= 2) ? window : 0;
+}
+
+// Reads up to numPages pages from firstPage on into frames of the pool with one multi-page read.
+// Stops at the end of the file, at a page that is already resident and when no frame can be claimed.
+// The pages are left unpinned. Read-ahead passes no frequencies and evicts once the pool is full;
+// the warmup passes the LFU frequencies of a snapshot and only fills free frames.
+// Returns the number of pages read, none if the read failed
+int readPageRun(BM_BufferPool *const bm, const PageNumber firstPage, int numPages, const long *frequencies)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+
+    // Read-ahead never grows the file and stays within the file of the first page
+    SM_FileHandle *file = getPageFile(pfmd, firstPage);
+    pthread_mutex_lock(&pfmd->fileLatch);
+    int fileEnd = BM_PAGE_KEY(BM_PAGE_FILE_ID(firstPage), file->totalNumPages);
+    pthread_mutex_unlock(&pfmd->fileLatch);
+    if (firstPage + numPages > fileEnd)
+    {
+        numPages = fileEnd - firstPage;
+    }
+    if (numPages <= 0)
+    {
+        return 0;
+    }
+
+    int *frameNums = (int *)malloc(sizeof(int) * numPages);
+    SM_PageHandle *buffers = (SM_PageHandle *)malloc(sizeof(SM_PageHandle) * numPages);
+    int claimed = 0;
+
+    while (frameNums != NULL && buffers != NULL && claimed < numPages)
+    {
+        PageNumber pageNum = firstPage + claimed;
+        PageTableShard *shard = getPageTableShard(pfmd, pageNum);
+
+        // The pages have to stay contiguous for a single read
+        pthread_mutex_lock(&shard->latch);
+        bool resident = lookupPageTable(getShardTable(shard), pageNum) != NO_PAGE;
+        pthread_mutex_unlock(&shard->latch);
+        if (resident)
+        {
+            break;
+        }
+
+        int frameNum;
+        if (frequencies == NULL)
+        {
+            frameNum = claimFrameForPage(bm, pageNum);
+        }
+        else
+        {
+            pthread_mutex_lock(&pfmd->replacementLatch);
+            frameNum = claimEmptyFrame(pfmd);
+            pthread_mutex_unlock(&pfmd->replacementLatch);
+        }
+        RC installRc;
+        if (frameNum == NO_FRAME || !installPageInFrame(bm, frameNum, pageNum, &installRc))
+        {
+            break;
+        }
+        frameNums[claimed] = frameNum;
+        buffers[claimed] = pfmd->frames[frameNum].readContent;
+        claimed++;
+    }
+
+    RC rc = RC_OK;
+    if (claimed > 0)
+    {
+        pthread_mutex_lock(&pfmd->fileLatch);
+        if (pfmd->MappedFrames && BM_PAGE_NUMBER(firstPage) + claimed <= file->mappedPages)
+        {
+            // Mapped frames only point at their pages, the kernel is asked to start reading them
+            for (int i = 0; i < claimed && rc == RC_OK; i++)
+            {
+                PageFrameNode *frame = &pfmd->frames[frameNums[i]];
+                rc = readBlockMapped(BM_PAGE_NUMBER(firstPage) + i, file, &frame->readContent);
+                frame->bh->data = frame->readContent;
+            }
+            if (rc == RC_OK)
+            {
+                madvise(pfmd->frames[frameNums[0]].readContent, (size_t)claimed * PAGE_SIZE, MADV_WILLNEED);
+                countPageReads(pfmd, claimed, false);
+            }
+        }
+        else
+        {
+            rc = readBlocks(BM_PAGE_NUMBER(firstPage), claimed, file, buffers);
+            if (rc == RC_OK)
+            {
+                countPageReads(pfmd, claimed, true);
+            }
+        }
+        pthread_mutex_unlock(&pfmd->fileLatch);
+    }
+
+    for (int i = 0; i < claimed; i++)
+    {
+        PageFrameNode *frame = &pfmd->frames[frameNums[i]];
+        if (rc != RC_OK)
+        {
+            failPageRead(bm, frameNums[i], firstPage + i, rc);
+            continue;
+        }
+        if (i == 0 && frequencies == NULL)
+        {
+            atomic_store(&frame->ReadAheadMark, 1);
+        }
+        trackLoadedFrame(bm, frameNums[i]);
+        if (frequencies != NULL && bm->strategy == RS_LFU)
+        {
+            pthread_mutex_lock(&pfmd->replacementLatch);
+            restoreFrequencyLFU(&pfmd->lfu, pfmd->frames, frameNums[i], frequencies[i]);
+            pthread_mutex_unlock(&pfmd->replacementLatch);
+        }
+        completeJoinedPins(bm, finishFrameIo(frame));
+        releaseFramePin(bm, frameNums[i]);
+    }
+
+    free(frameNums);
+    free(buffers);
+    return (rc == RC_OK) ? claimed : 0;
+}
+
+// Reads a read-ahead window, its first page carries the mark that triggers the next window
+void readAhead(BM_BufferPool *const bm, const PageNumber firstPage, int numPages)
+{
+    readPageRun(bm, firstPage, numPages, NULL);
+}
+
+// Stream detection, called on every miss. Returns how many pages after pageNum to read ahead,
+// 0 unless the miss continues a sequential scan
+int detectSequentialMiss(BM_BufferPool *const bm, const PageNumber pageNum)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    int maxWindow = maxReadAheadWindow(bm);
+    int window = 0;
+
+    if (maxWindow == 0)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&pfmd->readAheadLatch);
+    if (pageNum == pfmd->NextSequentialPage)
+    {
+        pfmd->SequentialMisses++;
+    }
+    else
+    {
+        // A new stream starts with the smallest window
+        pfmd->SequentialMisses = 1;
+        pfmd->ReadAheadWindow = (READ_AHEAD_MIN_PAGES < maxWindow) ? READ_AHEAD_MIN_PAGES : maxWindow;
+    }
+    pfmd->NextSequentialPage = pageNum + 1;
+
+    if (pfmd->SequentialMisses >= READ_AHEAD_TRIGGER_MISSES)
+    {
+        window = pfmd->ReadAheadWindow;
+        pfmd->ReadAheadNext = pageNum + 1 + window;
+        pfmd->NextSequentialPage = pfmd->ReadAheadNext;
+        pfmd->ReadAheadWindow = (2 * window < maxWindow) ? 2 * window : maxWindow;
+    }
+    pthread_mutex_unlock(&pfmd->readAheadLatch);
+
+    return window;
+}
+
+// Called on hits. Reaching the marked first page of a read-ahead window reads the next window,
+// so a scan keeps one window ahead of itself and only misses when it starts
+void checkReadAheadMark(BM_BufferPool *const bm, PageFrameNode *frame)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+
+    if (!atomic_load(&frame->ReadAheadMark) || !atomic_exchange(&frame->ReadAheadMark, 0))
+    {
+        return;
+    }
+
+    // The pool shrank or read-ahead was turned off since the window was marked
+    int maxWindow = maxReadAheadWindow(bm);
+    if (maxWindow == 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pfmd->readAheadLatch);
+    PageNumber firstPage = pfmd->ReadAheadNext;
+    int window = pfmd->ReadAheadWindow;
+    pfmd->ReadAheadNext += window;
+    pfmd->NextSequentialPage = pfmd->ReadAheadNext;
+    pfmd->ReadAheadWindow = (2 * window < maxWindow) ? 2 * window : maxWindow;
+    pthread_mutex_unlock(&pfmd->readAheadLatch);
+
+    readAhead(bm, firstPage, window);
+}
+
+// Turns sequential read-ahead off, so the pool only reads pages that are pinned
+RC disableReadAhead(BM_BufferPool *const bm)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    if (pfmd == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    atomic_store(&pfmd->ReadAheadDisabled, true);
+    return RC_OK;
+}
+
+
+// Finishes a pin that found its page resident and pinned its frame. A synchronous pin waits for a page
+// that is still being read. An asynchronous pin joins the read and returns at once, the thread finishing
+// the read completes it through completeJoinedPins. Asynchronous pins never read ahead, the read-ahead
+// mark is left to the next synchronous pin. Returns false if the read failed, the pin is then dropped
+// and the page is no longer in the page table, see failPageRead
+bool completeHit(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, int frameIndex, BM_PinRequest *request)
+{
+    PageFrameNode *frame = &getPoolMetadata(bm)->frames[frameIndex];
+
+    if (request != NULL)
+    {
+        request->frameNum = frameIndex;
+        request->next = NULL;
+    }
+
+    // The page may still be on its way in from disk
+    if (atomic_load(&frame->IoInProgress))
+    {
+        pthread_mutex_lock(&frame->latch);
+        if (request != NULL && atomic_load(&frame->IoInProgress) && frame->ReadError == RC_OK)
+        {
+            request->next = frame->ioWaiters;
+            frame->ioWaiters = request;
+            pthread_mutex_unlock(&frame->latch);
+            return true;
+        }
+        while (atomic_load(&frame->IoInProgress) && frame->ReadError == RC_OK)
+        {
+            pthread_cond_wait(&frame->ioDone, &frame->latch);
+        }
+        if (frame->ReadError != RC_OK)
+        {
+            // The thread that failed to read the page waits for this pin to go
+            atomic_fetch_sub(&frame->FixCount, 1);
+            pthread_cond_broadcast(&frame->ioDone);
+            pthread_mutex_unlock(&frame->latch);
+            return false;
+        }
+        pthread_mutex_unlock(&frame->latch);
+    }
+
+    // Let the replacement strategy know that this page has been accessed
+    atomic_fetch_add(&getPoolMetadata(bm)->NoOfHits, 1);
+    trackPageHit(bm, frameIndex);
+
+    if (request != NULL)
+    {
+        completePinRequests(bm, request);
+    }
+    else
+    {
+        checkReadAheadMark(bm, frame);
+        if (page != NULL)
+        {
+            // Update the page handle's information (page number and data)
+            updateBufferAndPageHandle(frame, page, pageNum);
+        }
+    }
+    return true;
+}
+
+// Function to check if the page is already present in the buffer pool. An asynchronous pin
+// passes its request, which is completed through completeHit instead of filling page
+bool checkPageInBuffer(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, PageFrameNode *pageFrame, BM_PinRequest *request)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageTableShard *shard = getPageTableShard(pfmd, pageNum);
+
+    // Fast path without any latch: pin the frame the page table points at, then make sure
+    // it still holds the page. Nobody can refill a pinned frame, so the check is final
+    int optimisticFrame = lookupPageTable(getShardTable(shard), pageNum);
+    if (optimisticFrame != NO_PAGE && tryPinFrame(&pageFrame[optimisticFrame]))
+    {
+        if (pageFrame[optimisticFrame].bh->pageNum != pageNum)
+        {
+            releaseFramePin(bm, optimisticFrame);
+        }
+        else if (completeHit(bm, (request != NULL) ? NULL : page, pageNum, optimisticFrame, request))
+        {
+            return true;
+        }
+    }
+
+    // Slow path: the page is missing, being evicted, its read failed, or the frame was refilled under the fast path
+    while (true)
+    {
+        // Ask the page table which frame holds the page
+        pthread_mutex_lock(&shard->latch);
+        int frameIndex = lookupPageTable(getShardTable(shard), pageNum);
+        if (frameIndex == NO_PAGE)
+        {
+            // Page not found in the buffer, return false
+            pthread_mutex_unlock(&shard->latch);
+            return false;
+        }
+
+        PageFrameNode *frame = &pageFrame[frameIndex];
+        pthread_mutex_lock(&frame->latch);
+        pthread_mutex_unlock(&shard->latch);
+
+        // Claims take the frame latch, so only a frame already claimed for eviction refuses the pin
+        if (!tryPinFrame(frame))
+        {
+            // The page is being written back for eviction, look again once it is gone
+            waitForFrameIo(frame);
+            pthread_mutex_unlock(&frame->latch);
+            continue;
+        }
+        pthread_mutex_unlock(&frame->latch);
+
+        // The page is already in the buffer, return true. If its read failed, the page is gone by now
+        if (completeHit(bm, (request != NULL) ? NULL : page, pageNum, frameIndex, request))
+        {
+            return true;
+        }
+    }
+}
+
+/// Warm Restarts ///
+
+// Fills a snapshot record for a frame, returns false if the frame holds no page. Needs the replacement latch
+bool fillSnapshotRecord(BM_BufferPool *const bm, int frameNum, BM_SnapshotRecord *record)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *frame = &pfmd->frames[frameNum];
+
+    pthread_mutex_lock(&frame->latch);
+    PageNumber pageNum = frame->bh->pageNum;
+    pthread_mutex_unlock(&frame->latch);
+    if (pageNum == NO_PAGE)
+    {
+        return false;
+    }
+
+    record->pageNum = pageNum;
+    record->frequency = 0;
+    if (bm->strategy == RS_LFU && frame->FrequencyNode != NO_FRAME)
+    {
+        record->frequency = pfmd->lfu.nodes[frame->FrequencyNode].frequency;
+    }
+    return true;
+}
+
+// Lists the resident pages hottest first: the pinned pages, which the strategy does not list,
+// then the others in reverse eviction order. Returns the number of records, -1 if out of memory
+int collectSnapshotRecords(BM_BufferPool *const bm, BM_SnapshotRecord **records)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+
+    pthread_mutex_lock(&pfmd->replacementLatch);
+    int numFrames = pfmd->NumberOfFrames;
+    int *order = (int *)malloc(sizeof(int) * numFrames);
+    bool *listed = (bool *)calloc(numFrames, sizeof(bool));
+    BM_SnapshotRecord *collected = (BM_SnapshotRecord *)malloc(sizeof(BM_SnapshotRecord) * numFrames);
+    if (order == NULL || listed == NULL || collected == NULL)
+    {
+        pthread_mutex_unlock(&pfmd->replacementLatch);
+        free(order);
+        free(listed);
+        free(collected);
+        return -1;
+    }
+
+    int ordered = collectEvictionOrder(bm, order);
+    int count = 0;
+    for (int i = 0; i < ordered; i++)
+    {
+        listed[order[i]] = true;
+    }
+    for (int frameNum = 0; frameNum < numFrames; frameNum++)
+    {
+        if (!listed[frameNum] && fillSnapshotRecord(bm, frameNum, &collected[count]))
+        {
+            count++;
+        }
+    }
+    for (int i = ordered - 1; i >= 0; i--)
+    {
+        if (fillSnapshotRecord(bm, order[i], &collected[count]))
+        {
+            count++;
+        }
+    }
+    pthread_mutex_unlock(&pfmd->replacementLatch);
+
+    for (int i = 0; i < count; i++)
+    {
+        collected[i].rank = i;
+    }
+    free(order);
+    free(listed);
+    *records = collected;
+    return count;
+}
+
+// Writes a snapshot of the pool to a temporary file and renames it, so a crash never leaves
+// half a snapshot behind. Needs the snapshot latch
+RC writePoolSnapshot(BM_BufferPool *const bm, const char *const snapshotFileName)
+{
+    BM_SnapshotRecord *records = NULL;
+    int count = collectSnapshotRecords(bm, &records);
+    if (count < 0)
+    {
+        RC_message = "Not enough memory for the buffer pool snapshot.";
+        return RC_WRITE_FAILED;
+    }
+
+    char tempName[FILENAME_MAX];
+    snprintf(tempName, sizeof(tempName), "%s.tmp", snapshotFileName);
+    FILE *file = fopen(tempName, "wb");
+    bool written = file != NULL && fwrite(BM_SNAPSHOT_MAGIC, 1, 8, file) == 8 &&
+                   fwrite(&count, sizeof(int), 1, file) == 1 &&
+                   fwrite(records, sizeof(BM_SnapshotRecord), count, file) == (size_t)count;
+    if (file != NULL && fclose(file) != 0)
+    {
+        written = false;
+    }
+    free(records);
+
+    if (!written || rename(tempName, snapshotFileName) != 0)
+    {
+        remove(tempName);
+        RC_message = "Unable to write the buffer pool snapshot.";
+        return RC_WRITE_FAILED;
+    }
+    return RC_OK;
+}
+
+// Writes the resident pages of the pool, hottest first, to a snapshot file for startPoolWarmup
+RC savePoolContents(BM_BufferPool *const bm, const char *const snapshotFileName)
+{
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    pthread_mutex_lock(&pfmd->snapshotLatch);
+    RC rc = writePoolSnapshot(bm, snapshotFileName);
+    pthread_mutex_unlock(&pfmd->snapshotLatch);
+
+    if (rc == RC_OK)
+    {
+        RC_message = "Buffer pool snapshot written.";
+    }
+    return rc;
+}
+
+void addMillis(struct timespec *time, int millis)
+{
+    time->tv_sec += millis / 1000;
+    time->tv_nsec += (long)(millis % 1000) * 1000 * 1000;
+    if (time->tv_nsec >= 1000 * 1000 * 1000)
+    {
+        time->tv_sec++;
+        time->tv_nsec -= 1000 * 1000 * 1000;
+    }
+}
+
+void *runPoolSnapshots(void *arg)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    struct timespec snapshotAt;
+
+    pthread_mutex_lock(&pfmd->snapshotLatch);
+    clock_gettime(CLOCK_REALTIME, &snapshotAt);
+    addMillis(&snapshotAt, pfmd->SnapshotIntervalMillis);
+    while (!pfmd->SnapshotStopping)
+    {
+        if (pthread_cond_timedwait(&pfmd->snapshotWakeup, &pfmd->snapshotLatch, &snapshotAt) == ETIMEDOUT &&
+            !pfmd->SnapshotStopping)
+        {
+            // A failed snapshot leaves the previous one in place, the next interval tries again
+            writePoolSnapshot(bm, pfmd->snapshotFile);
+            clock_gettime(CLOCK_REALTIME, &snapshotAt);
+            addMillis(&snapshotAt, pfmd->SnapshotIntervalMillis);
+        }
+    }
+    pthread_mutex_unlock(&pfmd->snapshotLatch);
+    return NULL;
+}
+
+// Keeps a snapshot of the pool in snapshotFileName: shutdownBufferPool writes one before the pages are
+// flushed, and with intervalMillis > 0 a thread also writes one every intervalMillis milliseconds
+RC startPoolSnapshots(BM_BufferPool *const bm, const char *const snapshotFileName, const int intervalMillis)
+{
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+    if (intervalMillis < 0)
+    {
+        RC_message = "The snapshot interval cannot be negative.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    pthread_mutex_lock(&pfmd->snapshotLatch);
+    if (pfmd->snapshotFile != NULL)
+    {
+        pthread_mutex_unlock(&pfmd->snapshotLatch);
+        RC_message = "The buffer pool already takes snapshots.";
+        return RC_FILE_NOT_FOUND;
+    }
+    pfmd->snapshotFile = strdup(snapshotFileName);
+    if (pfmd->snapshotFile == NULL)
+    {
+        pthread_mutex_unlock(&pfmd->snapshotLatch);
+        return RC_FILE_NOT_FOUND;
+    }
+    pfmd->SnapshotStopping = false;
+    pfmd->SnapshotIntervalMillis = intervalMillis;
+    pfmd->SnapshotThreadStarted = intervalMillis > 0;
+    if (pfmd->SnapshotThreadStarted && pthread_create(&pfmd->snapshotThread, NULL, runPoolSnapshots, bm) != 0)
+    {
+        free(pfmd->snapshotFile);
+        pfmd->snapshotFile = NULL;
+        pfmd->SnapshotThreadStarted = false;
+        pthread_mutex_unlock(&pfmd->snapshotLatch);
+        RC_message = "Unable to start the snapshot thread.";
+        return RC_FILE_NOT_FOUND;
+    }
+    pthread_mutex_unlock(&pfmd->snapshotLatch);
+
+    RC_message = "Buffer pool snapshots started.";
+    return RC_OK;
+}
+
+// Stops taking snapshots, the last snapshot written stays in place
+RC stopPoolSnapshots(BM_BufferPool *const bm)
+{
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    pthread_mutex_lock(&pfmd->snapshotLatch);
+    if (pfmd->snapshotFile == NULL)
+    {
+        pthread_mutex_unlock(&pfmd->snapshotLatch);
+        RC_message = "The buffer pool takes no snapshots.";
+        return RC_FILE_NOT_FOUND;
+    }
+    pfmd->SnapshotStopping = true;
+    pthread_cond_signal(&pfmd->snapshotWakeup);
+    pthread_mutex_unlock(&pfmd->snapshotLatch);
+    if (pfmd->SnapshotThreadStarted)
+    {
+        pthread_join(pfmd->snapshotThread, NULL);
+    }
+
+    pthread_mutex_lock(&pfmd->snapshotLatch);
+    free(pfmd->snapshotFile);
+    pfmd->snapshotFile = NULL;
+    pfmd->SnapshotThreadStarted = false;
+    pthread_mutex_unlock(&pfmd->snapshotLatch);
+
+    RC_message = "Buffer pool snapshots stopped.";
+    return RC_OK;
+}
+
+// Reads the records of a snapshot file, NULL if it is not one
+BM_SnapshotRecord *readPoolSnapshot(const char *const snapshotFileName, int *count)
+{
+    FILE *file = fopen(snapshotFileName, "rb");
+    char magic[8];
+    BM_SnapshotRecord *records = NULL;
+
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    if (fread(magic, 1, 8, file) == 8 && memcmp(magic, BM_SNAPSHOT_MAGIC, 8) == 0 &&
+        fread(count, sizeof(int), 1, file) == 1 && *count >= 0)
+    {
+        records = (BM_SnapshotRecord *)malloc(sizeof(BM_SnapshotRecord) * ((size_t)*count + 1));
+        if (records != NULL && fread(records, sizeof(BM_SnapshotRecord), *count, file) != (size_t)*count)
+        {
+            free(records);
+            records = NULL;
+        }
+    }
+    fclose(file);
+    return records;
+}
+
+int compareSnapshotRecords(const void *first, const void *second)
+{
+    PageNumber a = ((const BM_SnapshotRecord *)first)->pageNum;
+    PageNumber b = ((const BM_SnapshotRecord *)second)->pageNum;
+    return (a > b) - (a < b);
+}
+
+// Loads the snapshot pages batch by batch, hottest batch first. Each batch is read in page order
+// with one read per run of consecutive pages. Stops once no free frame is left
+void *runPoolWarmup(void *arg)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    BM_SnapshotRecord *records = pfmd->warmupRecords;
+    long frequencies[WARMUP_BATCH_PAGES];
+    bool done = false;
+
+    for (int batch = 0; batch < pfmd->WarmupRecordCount && !done; batch += WARMUP_BATCH_PAGES)
+    {
+        int batchEnd = (batch + WARMUP_BATCH_PAGES < pfmd->WarmupRecordCount) ? batch + WARMUP_BATCH_PAGES : pfmd->WarmupRecordCount;
+        qsort(&records[batch], batchEnd - batch, sizeof(BM_SnapshotRecord), compareSnapshotRecords);
+
+        for (int start = batch; start < batchEnd && !done;)
+        {
+            int length = 1;
+            while (start + length < batchEnd && records[start + length].pageNum == records[start].pageNum + length &&
+                   BM_PAGE_NUMBER(records[start + length].pageNum) != 0)
+            {
+                length++;
+            }
+            for (int i = 0; i < length; i++)
+            {
+                frequencies[i] = records[start + i].frequency;
+            }
+
+            int read = readPageRun(bm, records[start].pageNum, length, frequencies);
+            atomic_fetch_add(&pfmd->WarmupPagesLoaded, read);
+            if (read < length)
+            {
+                // The run ended at a page that is resident already, past the end of its file, or at a full pool
+                pthread_mutex_lock(&pfmd->replacementLatch);
+                done = pfmd->freeList.size == 0;
+                pthread_mutex_unlock(&pfmd->replacementLatch);
+                read++;
+            }
+            start += read;
+            done = done || atomic_load(&pfmd->WarmupStopping);
+        }
+    }
+    return NULL;
+}
+
+// Reloads the pages of a snapshot written by savePoolContents or startPoolSnapshots in the background.
+// Only the hottest pages that fit into the free frames are loaded, pages are never evicted for them,
+// and the pool serves pins meanwhile. Pages of files that are not registered are skipped, so page files
+// are registered before the warmup starts. Under LFU the pages get back their saved frequencies
+RC startPoolWarmup(BM_BufferPool *const bm, const char *const snapshotFileName)
+{
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    if (pfmd->WarmupRunning)
+    {
+        RC_message = "The buffer pool is already warming up.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    int count = 0;
+    BM_SnapshotRecord *records = readPoolSnapshot(snapshotFileName, &count);
+    if (records == NULL)
+    {
+        RC_message = "Unable to read the buffer pool snapshot.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    pthread_mutex_lock(&pfmd->replacementLatch);
+    int freeFrames = pfmd->freeList.size;
+    pthread_mutex_unlock(&pfmd->replacementLatch);
+    int kept = 0;
+    for (int i = 0; i < count && kept < freeFrames; i++)
+    {
+        if (isValidPageKey(pfmd, records[i].pageNum))
+        {
+            records[kept++] = records[i];
+        }
+    }
+
+    pfmd->warmupRecords = records;
+    pfmd->WarmupRecordCount = kept;
+    atomic_store(&pfmd->WarmupPagesLoaded, 0);
+    atomic_store(&pfmd->WarmupStopping, false);
+    if (pthread_create(&pfmd->warmupThread, NULL, runPoolWarmup, bm) != 0)
+    {
+        free(records);
+        pfmd->warmupRecords = NULL;
+        RC_message = "Unable to start the warmup thread.";
+        return RC_FILE_NOT_FOUND;
+    }
+    pfmd->WarmupRunning = true;
+
+    RC_message = "Buffer pool warmup started.";
+    return RC_OK;
+}
+
+// Waits until the warmup has loaded its pages, pagesLoaded (may be NULL) receives how many it read.
+// shutdownBufferPool cuts a running warmup short
+RC waitForPoolWarmup(BM_BufferPool *const bm, int *const pagesLoaded)
+{
+    if (bm->mgmtData == NULL)
+    {
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    if (!pfmd->WarmupRunning)
+    {
+        RC_message = "The buffer pool is not warming up.";
+        return RC_FILE_NOT_FOUND;
+    }
+
+    pthread_join(pfmd->warmupThread, NULL);
+    pfmd->WarmupRunning = false;
+    free(pfmd->warmupRecords);
+    pfmd->warmupRecords = NULL;
+    if (pagesLoaded != NULL)
+    {
+        *pagesLoaded = atomic_load(&pfmd->WarmupPagesLoaded);
+    }
+
+    RC_message = "Buffer pool warmup finished.";
+    return RC_OK;
+}
+
+/// Asynchronous Pins ///
+
+// Completes an asynchronous pin that read its page, request->rc holding the result of the read.
+// The pins that joined the read complete with it
+void finishPageReadRequest(BM_BufferPool *const bm, BM_PinRequest *request)
+{
+    if (request->rc != RC_OK)
+    {
+        failPageRead(bm, request->frameNum, request->pageNum, request->rc);
+        completePinRequests(bm, request);
+        return;
+    }
+
+    trackLoadedFrame(bm, request->frameNum);
+    BM_PinRequest *waiters = finishFrameIo(&getPoolMetadata(bm)->frames[request->frameNum]);
+    completePinRequests(bm, request);
+    completeJoinedPins(bm, waiters);
+}
+
+// Reads the pages of submitted asynchronous misses. Runs until stopIoThreads, after the queue is drained
+void *runIoThread(void *arg)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+
+    pthread_mutex_lock(&pfmd->ioLatch);
+    while (true)
+    {
+        while (pfmd->ioHead == NULL && !pfmd->IoStopping)
+        {
+            pthread_cond_wait(&pfmd->ioWork, &pfmd->ioLatch);
+        }
+        if (pfmd->ioHead == NULL)
+        {
+            break;
+        }
+
+        BM_PinRequest *request = pfmd->ioHead;
+        pfmd->ioHead = request->next;
+        if (pfmd->ioHead == NULL)
+        {
+            pfmd->ioTail = NULL;
+        }
+        pthread_mutex_unlock(&pfmd->ioLatch);
 
-    // Update the page handle to reflect the new page's data
-    page->pageNum = pageFrame->bh->pageNum;
-    page->data = pageFrame->bh->data;
-}
+        // Same steps as the tail of loadPageIntoFrame, the pins that joined the read complete with it
+        request->next = NULL;
+        request->rc = loadPageFromDisk(bm, &pfmd->frames[request->frameNum], request->pageNum);
+        finishPageReadRequest(bm, request);
 
-// Function to shift queue and insert new page at the end
-void updateQueue(Queue *queue, int numPages, PageNumber pageNum, int frameNumber)
-{
-    // Shift pages in the queue
-    for (int z = 1; z < numPages; z++)
-    {
-        queue[z - 1].pageNumber = queue[z].pageNumber;
-        queue[z - 1].frameNumber = queue[z].frameNumber;
+        pthread_mutex_lock(&pfmd->ioLatch);
     }
-
-    // Place the new page at the end of the queue
-    queue[numPages - 1].pageNumber = pageNum;
-    queue[numPages - 1].frameNumber = frameNumber;
+    pthread_mutex_unlock(&pfmd->ioLatch);
+    return NULL;
 }
 
-// Main pinFIFO function
-bool pinFIFO(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+// Queues the read of a page installed in request->frameNum. The I/O threads are started on first use
+RC submitPageRead(BM_BufferPool *const bm, BM_PinRequest *request)
 {
-    Queue *queue = (Queue *)pfmd.queue;
-    SM_FileHandle fileHandle;
-    PageFrameNode *pageFrameList = (PageFrameNode *)bm->mgmtData;
-    bool pagePinned = false;
+    PageFrameMD *pfmd = getPoolMetadata(bm);
 
-    for (int i = 0; i < bm->numPages && !pagePinned; i++)
+    pthread_mutex_lock(&pfmd->ioLatch);
+    if (!pfmd->IoThreadsStarted)
     {
-        int targetPageNum = queue[i].pageNumber;
-
-        for (int j = 0; j < bm->numPages && !pagePinned; j++)
+        for (int i = 0; i < NUM_IO_THREADS; i++)
         {
-            PageFrameNode *currentFrame = &pageFrameList[j];
-
-            // Check if the frame can be replaced
-            if (currentFrame->bh->pageNum == targetPageNum)
+            if (pthread_create(&pfmd->ioThreads[i], NULL, runIoThread, bm) != 0)
             {
-                if (currentFrame->FixCount == 0)
+                // Threads started so far stay in use, there is always at least one or the read fails below
+                if (i == 0)
                 {
-                    openPageFile(bm->pageFile, &fileHandle);
-
-                    // Check dirty status
-                    if (currentFrame->DirtyFlag == 1)
-                    {
-                        writeDirtyPageToDisk(currentFrame, &fileHandle);
-                    }
-
-                    // Load the new page from disk
-                    loadPageFromDisk(currentFrame, &fileHandle, pageNum);
-                    
-                    // Update the page handle with new data
-                    updateBufferAndPageHandle(currentFrame, page, pageNum);
-
-                    // Adjust the queue with new page info
-                    updateQueue(queue, bm->numPages, pageNum, currentFrame->FrameNum);
-
-                    // Mark page as pinned and increment read counter
-                    NoOfReads++;
-                    pagePinned = true;
+                    pthread_mutex_unlock(&pfmd->ioLatch);
+                    return RC_FILE_NOT_FOUND;
                 }
+                break;
             }
+            pfmd->NumberOfIoThreads = i + 1;
         }
+        pfmd->IoThreadsStarted = true;
     }
 
-    return pagePinned;
-}
-
-
-
-// Function to handle dirty and clean page actions
-// Function to handle dirty and clean page actions
-void handlePageReplacementLRU(BM_BufferPool *const bm, PageFrameNode *pageFrame, PageNumber pageNum, SM_FileHandle *fHandle)
-{
-    if (pageFrame->DirtyFlag == 0)
+    request->next = NULL;
+    if (pfmd->ioTail != NULL)
     {
-        // Handle clean page, ensuring file capacity
-        openPageFile(bm->pageFile, fHandle);
-        ensureCapacity(pageNum, fHandle);
+        pfmd->ioTail->next = request;
     }
     else
     {
-        // Handle dirty page by forcing it to disk
-        forcePage(bm, pageFrame->bh);
+        pfmd->ioHead = request;
     }
-}
-
-// Function to read the new page from disk and assign to buffer page handler
-void loadPageIntoFrameLRU(BM_BufferPool *const bm, BM_PageHandle *const page, PageFrameNode *pageFrame, PageNumber pageNum, SM_FileHandle *fHandle)
-{
-    // Read block from disk into the buffer
-    readBlock(pageNum, fHandle, pageFrame->readContent);
+    pfmd->ioTail = request;
+    pthread_cond_signal(&pfmd->ioWork);
+    pthread_mutex_unlock(&pfmd->ioLatch);
 
-    // Assign the page number to both the page frame and page handle
-    pageFrame->bh->pageNum = pageNum;
-    page->pageNum = pageNum;
-
-    // Copy the data from the buffer to both the page frame and page handle
-    pageFrame->bh->data = pageFrame->readContent;
-    page->data = pageFrame->readContent;
-
-    // Mark the page as clean and reset the fix count
-    pageFrame->DirtyFlag = 0;
-    pageFrame->FixCount = 0;
+    return RC_OK;
 }
 
-// Function to update the queue after pinning the page
-void updateLRUQueue(Queue *queue, int i, int numPages, PageFrameNode *pageFrame, PageNumber pageNum)
+// Starts pinning pageNum without waiting for a read. A hit completes at once, a miss claims a frame,
+// publishes the page and leaves the read to an I/O thread. Pins of a page that is already being read,
+// synchronous or not, share that read. The result is handed back by pollPinCompletions, which fills page,
+// sets request->rc and runs request->callback. Errors found before anything is submitted are returned directly
+RC pinPageAsync(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, BM_PinRequest *const request)
 {
-    for (int z = i + 1; z < numPages; z++)
+    if (bm->mgmtData == NULL || !isValidPageKey(getPoolMetadata(bm), pageNum))
     {
-        queue[z - 1].pageNumber = queue[z].pageNumber;
-        queue[z - 1].frameNumber = queue[z].frameNumber;
+        RC_message = "Buffer pool not found or page number is not valid.";
+        return RC_FILE_NOT_FOUND;
     }
 
-    int lastPageIdx = numPages - 1;
-    queue[lastPageIdx].pageNumber = pageNum;
-    queue[lastPageIdx].frameNumber = pageFrame->FrameNum;
-}
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    request->page = page;
+    request->pageNum = pageNum;
+    request->rc = RC_OK;
+    request->completed = false;
+    request->next = NULL;
 
-bool pinLRU(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
-{
-    bool isSet = false;
-    SM_FileHandle fHandle;
-    PageFrameNode *pageFrameList = (PageFrameNode *)bm->mgmtData;
-    Queue *queue = (Queue *)pfmd.queue;
+    pthread_mutex_lock(&pfmd->completionLatch);
+    pfmd->PendingPins++;
+    pthread_mutex_unlock(&pfmd->completionLatch);
 
-    for (int i = 0; i < bm->numPages && !isSet; i++)
+    RC rc = RC_OK;
+    while (true)
     {
-        int currentPageNumber = queue[i].pageNumber;
-
-        for (int j = 0; j < bm->numPages && !isSet; j++)
+        if (checkPageInBuffer(bm, page, pageNum, pfmd->frames, request))
         {
-            if (pageFrameList[j].bh->pageNum == currentPageNumber && pageFrameList[j].FixCount == 0)
-            {
-                // Handle the page replacement process (dirty/clean page)
-                handlePageReplacementLRU(bm, &pageFrameList[j], pageNum, &fHandle);
-
-                // Load the page into the frame and update the page handler
-                loadPageIntoFrameLRU(bm, page, &pageFrameList[j], pageNum, &fHandle);
+            return RC_OK;
+        }
 
-                // Update the LRU queue
-                updateLRUQueue(queue, i, bm->numPages, &pageFrameList[j], pageNum);
+        int frameNum = claimFrameForPage(bm, pageNum);
+        if (frameNum == NO_FRAME)
+        {
+            break;
+        }
 
-                // Increment read count and mark as set
-                NoOfReads++;
-                isSet = true;
+        // If another thread loaded the page first, pin its copy instead
+        if (installPageInFrame(bm, frameNum, pageNum, &rc))
+        {
+            request->frameNum = frameNum;
+            if (submitPageRead(bm, request) == RC_OK)
+            {
+                return RC_OK;
             }
+
+            // Without an I/O thread the read happens right here
+            request->next = NULL;
+            request->rc = loadPageFromDisk(bm, &pfmd->frames[frameNum], pageNum);
+            finishPageReadRequest(bm, request);
+            return RC_OK;
+        }
+        if (rc != RC_OK)
+        {
+            // The page of the victim could not be written back
+            break;
         }
     }
 
-    return isSet;
+    pthread_mutex_lock(&pfmd->completionLatch);
+    pfmd->PendingPins--;
+    pthread_mutex_unlock(&pfmd->completionLatch);
+
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+    atomic_fetch_add(&pfmd->NoOfPinFailures, 1);
+    RC_message = "Every frame of the buffer pool is pinned.";
+    return RC_FILE_NOT_FOUND;
 }
 
-/// Function to handle page replacement in the CLOCK algorithm
-void replacePageInClock(BM_BufferPool *const bm, PageFrameNode *pageFrame, PageNumber pageNum, SM_FileHandle *fHandle)
+// Hands back the asynchronous pins that completed since the last call and runs their callbacks on the
+// calling thread. With waitForCompletion set it blocks until at least one pin completes, unless none is
+// outstanding. Returns the number of pins handed back
+int pollPinCompletions(BM_BufferPool *const bm, const bool waitForCompletion)
 {
-    // Open the file associated with the buffer pool
-    openPageFile(bm->pageFile, fHandle);
+    if (bm->mgmtData == NULL)
+    {
+        return 0;
+    }
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
 
-    // If the page is dirty, write its contents to disk
-    if (pageFrame->DirtyFlag == 1)
+    pthread_mutex_lock(&pfmd->completionLatch);
+    while (waitForCompletion && pfmd->completedHead == NULL && pfmd->PendingPins > 0)
     {
-        forcePage(bm, pageFrame->bh);
+        pthread_cond_wait(&pfmd->completionReady, &pfmd->completionLatch);
     }
-    else
+    BM_PinRequest *completed = pfmd->completedHead;
+    pfmd->completedHead = NULL;
+    pfmd->completedTail = NULL;
+
+    int count = 0;
+    for (BM_PinRequest *request = completed; request != NULL; request = request->next)
+    {
+        count++;
+    }
+    pfmd->PendingPins -= count;
+    pthread_mutex_unlock(&pfmd->completionLatch);
+
+    while (completed != NULL)
     {
-        // Ensure there is sufficient capacity for the new page
-        ensureCapacity(pageNum, fHandle);
+        // The callback may reuse the request, so move on before calling it
+        BM_PinRequest *request = completed;
+        completed = request->next;
+        request->next = NULL;
+        request->completed = true;
+        if (request->callback != NULL)
+        {
+            request->callback(request);
+        }
     }
+    return count;
 }
 
-// Function to load a page into the frame and update the buffer manager's page handle
-void loadNewPageIntoFrameCLOCK(PageFrameNode *pageFrame, BM_PageHandle *const page, PageNumber pageNum, SM_FileHandle *fHandle)
+// Main pinPage function
+RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
 {
-    // Read the new page from disk into the frame's readContent buffer
-    readBlock(pageNum, fHandle, pageFrame->readContent);
+    // Check if the buffer pool exists and page number is valid
+   if (bm->mgmtData == NULL) {
+    // If the management data is NULL, the buffer pool does not exist
+    return RC_FILE_NOT_FOUND;
+} else if (!isValidPageKey(getPoolMetadata(bm), pageNum)) {
+    // Negative page numbers and pages of files that are not registered are invalid
+    return RC_FILE_NOT_FOUND;
+}
 
-    // Update the page number and content of both the page frame and the page handle
-    pageFrame->bh->pageNum = pageNum;
-    page->pageNum = pageNum;
 
-    pageFrame->bh->data = pageFrame->readContent;
-    page->data = pageFrame->readContent;
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    PageFrameNode *pageFrame = pfmd->frames;
+    long long start = startLatencyTimer(pfmd);
+    recordTrace(pfmd, BM_TRACE_PIN, pageNum);
 
-    // Mark the page as clean and set its FixCount to 1
-    pageFrame->DirtyFlag = 0;
-    pageFrame->FixCount = 1;
-}
+    while (true)
+    {
+        // Check if the page is already in the buffer pool
+        if (checkPageInBuffer(bm, page, pageNum, pageFrame, NULL))
+        {
+            recordLatency(pfmd, BM_LATENCY_PIN_HIT, start);
+            return RC_OK;
+        }
 
-// Function to update the queue after replacing a page
-void updateClockQueue(Queue *queue, int i, int j, int numPages, PageFrameNode *pageFrame, PageNumber pageNum)
-{
-    // Shift the pages in the queue to update their positions
-    queue[i].pageNumber = queue[j].pageNumber;
-    queue[i].frameNumber = queue[j].frameNumber;
+        // Take an empty frame, or replace a page based on the strategy once the pool is full
+        int frameNum = claimFrameForPage(bm, pageNum);
+        if (frameNum == NO_FRAME)
+        {
+            atomic_fetch_add(&pfmd->NoOfPinFailures, 1);
+            return RC_FILE_NOT_FOUND;
+        }
+
+        // If another thread loaded the page first, pin its copy instead
+        RC rc;
+        if (loadPageIntoFrame(bm, page, frameNum, pageNum, &rc))
+        {
+            if (rc != RC_OK)
+            {
+                return rc;
+            }
 
-    // Place the newly loaded page at the end of the queue
-    queue[numPages - 1].pageNumber = pageNum;
-    queue[numPages - 1].frameNumber = pageFrame->FrameNum;
+            // A miss that continues a scan reads the next pages ahead
+            int window = detectSequentialMiss(bm, pageNum);
+            if (window > 0)
+            {
+                readAhead(bm, pageNum + 1, window);
+            }
+            recordLatency(pfmd, BM_LATENCY_PIN_MISS, start);
+            return RC_OK;
+        }
+    }
 }
 
-// Main pinCLOCK function implementation
-bool pinCLOCK(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+// Reads the pages installed by pinPages, sorted by page number, every run of consecutive pages with one
+// vectored read. Mapped frames only point at their pages. Stops at the first error and returns it.
+// Needs the file latch
+RC readInstalledPages(BM_BufferPool *const bm, FlushEntry *entries, int numEntries)
 {
-    bool isPagePinned = false;  // Flag to track whether a page has been pinned
-    SM_FileHandle fileHandle;  // File handle for reading/writing pages to/from disk
-    PageFrameNode *pageFrameList = (PageFrameNode *)bm->mgmtData;  // Retrieve the page frames from the buffer manager
-    Queue *queue = (Queue *)pfmd.queue;  // Retrieve the queue
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    SM_PageHandle *run = (SM_PageHandle *)malloc(sizeof(SM_PageHandle) * numEntries);
+    RC rc = RC_OK;
 
-    for (int i = 0; i < bm->numPages && !isPagePinned; i++)
+    for (int start = 0; start < numEntries && rc == RC_OK;)
     {
-        int currentPageNumber = queue[i].pageNumber;  // Retrieve the current page number from the queue
+        int length = 1;
+        while (start + length < numEntries && entries[start + length].pageNum == entries[start].pageNum + length &&
+               BM_PAGE_NUMBER(entries[start + length].pageNum) != 0)
+        {
+            length++;
+        }
 
-        for (int j = clockPosition; j < bm->numPages && !isPagePinned; j++)
+        // Pages past the end of the file read as empty pages, as with pinPage
+        SM_FileHandle *file = getPageFile(pfmd, entries[start].pageNum);
+        rc = ensureCapacity(BM_PAGE_NUMBER(entries[start + length - 1].pageNum) + 1, file);
+        if (rc != RC_OK)
         {
-            PageFrameNode *currentFrame = &pageFrameList[j];  // Get the current frame being checked
+            break;
+        }
 
-            // Check whether the page number matches and if it's not currently pinned
-            if (currentFrame->bh->pageNum == currentPageNumber)
+        if (!pfmd->MappedFrames && run != NULL)
+        {
+            for (int i = start; i < start + length; i++)
+            {
+                run[i - start] = pfmd->frames[entries[i].frameNum].readContent;
+            }
+            rc = readBlocks(BM_PAGE_NUMBER(entries[start].pageNum), length, file, run);
+            if (rc == RC_OK)
+            {
+                countPageReads(pfmd, length, true);
+            }
+        }
+        else
+        {
+            for (int i = start; i < start + length && rc == RC_OK; i++)
             {
-                // Separate out FixCount check for clarity
-                if (currentFrame->FixCount == 0)
+                PageFrameNode *frame = &pfmd->frames[entries[i].frameNum];
+                SM_PageHandle mapped;
+                bool copied = !(pfmd->MappedFrames && readBlockMapped(BM_PAGE_NUMBER(entries[i].pageNum), file, &mapped) == RC_OK);
+                if (!copied)
+                {
+                    frame->readContent = mapped;
+                    frame->bh->data = mapped;
+                }
+                else
+                {
+                    rc = readBlock(BM_PAGE_NUMBER(entries[i].pageNum), file, frame->readContent);
+                }
+                if (rc == RC_OK)
                 {
-                    if (currentFrame->UsedFlag == 1)
-                    {
-                        // If the page was recently used, reset the flag and continue
-                        currentFrame->UsedFlag = 0;
-                    }
-                    else
-                    {
-                        // The page is not recently used, so handle replacement and pinning
-                        currentFrame->UsedFlag = 1;
-                        replacePageInClock(bm, currentFrame, pageNum, &fileHandle);  // Handle page replacement
-                        loadNewPageIntoFrameCLOCK(currentFrame, page, pageNum, &fileHandle);  // Load the new page into the frame
-                        updateClockQueue(queue, i, j, bm->numPages, currentFrame, pageNum);  // Update the queue for the newly loaded page
-
-                        NoOfReads++;  // Increment the read count
-                        clockPosition = (j + 1) % bm->numPages;  // Update the clock hand position
-                        isPagePinned = true;
-                    }
+                    countPageReads(pfmd, 1, copied);
                 }
             }
         }
+        start += length;
     }
-
-    return isPagePinned;  // Return whether the page has been pinned or not
+    free(run);
+    return rc;
 }
 
-
-
-// Function prototype for updateQueueOnPageHit
-void updateQueueOnPageHit(Queue *queue, int j, int numPages, PageFrameNode *pageFrame, int frameNumber, PageNumber pageNum);
-
-// Function to check if the page is already present in the buffer pool
-bool checkPageInBuffer(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, Queue *queue, PageFrameNode *pageFrame)
+// Pins numPages pages at once, pages[i] receives pageNums[i]. Resident pages are pinned first, then
+// frames are claimed for all missing pages together and the misses are read in page order with one
+// read per run of consecutive pages. Either every page gets pinned or, once the pool runs out of
+// frames or a write-back or read fails, the pages pinned so far are unpinned again and an error is returned
+RC pinPages(BM_BufferPool *const bm, BM_PageHandle *const pages, const PageNumber *const pageNums, const int numPages)
 {
-    // Iterate through the buffer pool's pages
-    for (int j = 0; j < bm->numPages; j++)
+    if (bm->mgmtData == NULL || numPages < 0)
+    {
+        RC_message = "Buffer pool not found or page count is not valid.";
+        return RC_FILE_NOT_FOUND;
+    }
+    for (int i = 0; i < numPages; i++)
     {
-        // Compare the current page number in the queue with the required page number
-        if (!(queue[j].pageNumber - pageNum))  // Alternative to queue[j].pageNumber == pageNum
+        if (!isValidPageKey(getPoolMetadata(bm), pageNums[i]))
         {
-            // Extract the frame index from the queue
-            int frameIndex ;
-            frameIndex= queue[j].frameNumber;
+            RC_message = "Page number is not valid.";
+            return RC_FILE_NOT_FOUND;
+        }
+    }
 
-            // Retrieve the page handle associated with the frame
-            BM_PageHandle* currentBufferHandle;
-             currentBufferHandle= pageFrame[frameIndex].bh;
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    FlushEntry *installed = (FlushEntry *)malloc(sizeof(FlushEntry) * numPages);
+    int *pending = (int *)malloc(sizeof(int) * numPages);
+    int *loadedFrame = (int *)malloc(sizeof(int) * numPages); // frame read for pages[i], NO_FRAME for hits
+    bool *pinned = (bool *)calloc(numPages, sizeof(bool));
+    if (installed == NULL || pending == NULL || loadedFrame == NULL || pinned == NULL)
+    {
+        free(installed);
+        free(pending);
+        free(loadedFrame);
+        free(pinned);
+        RC_message = "Not enough memory to pin the pages.";
+        return RC_FILE_NOT_FOUND;
+    }
+    int numInstalled = 0;
+    int numPending = 0;
+    bool outOfFrames = false;
+    RC ioRc = RC_OK;
 
-            // Update the page handle's information (page number and data)
-            page->pageNum = currentBufferHandle->pageNum;
-            page->data = currentBufferHandle->data;
+    // Hits first, they do not need a frame
+    for (int i = 0; i < numPages; i++)
+    {
+        loadedFrame[i] = NO_FRAME;
+        if (checkPageInBuffer(bm, &pages[i], pageNums[i], pfmd->frames, NULL))
+        {
+            pinned[i] = true;
+        }
+        else
+        {
+            pending[numPending++] = i;
+        }
+    }
 
-            // Increment the frame's fix count
-            ++pageFrame[frameIndex].FixCount;
+    // Claim and publish a frame for every miss. A page that turns out to be resident by now, because it
+    // occurs twice in the batch or another thread loaded it, is pinned once the reads are done
+    int numRetries = 0;
+    for (int j = 0; j < numPending; j++)
+    {
+        int i = pending[j];
+        int frameNum = claimFrameForPage(bm, pageNums[i]);
+        if (frameNum == NO_FRAME)
+        {
+            outOfFrames = true;
+            break;
+        }
+        RC installRc;
+        if (installPageInFrame(bm, frameNum, pageNums[i], &installRc))
+        {
+            installed[numInstalled].pageNum = pageNums[i];
+            installed[numInstalled].frameNum = frameNum;
+            numInstalled++;
+            loadedFrame[i] = frameNum;
+            pinned[i] = true;
+        }
+        else if (installRc != RC_OK)
+        {
+            // The page of the victim could not be written back
+            ioRc = installRc;
+            break;
+        }
+        else
+        {
+            pending[numRetries++] = i;
+        }
+    }
 
-            // Adjust the queue to reflect that this page has been accessed
-            updateQueueOnPageHit(queue, j, bm->numPages, pageFrame, frameIndex, pageNum);
+    if (numInstalled > 0)
+    {
+        qsort(installed, numInstalled, sizeof(FlushEntry), compareFlushEntries);
+        if (ioRc == RC_OK)
+        {
+            pthread_mutex_lock(&pfmd->fileLatch);
+            ioRc = readInstalledPages(bm, installed, numInstalled);
+            pthread_mutex_unlock(&pfmd->fileLatch);
+        }
+        if (ioRc == RC_OK)
+        {
+            atomic_fetch_add(&pfmd->NoOfMisses, numInstalled);
+        }
 
-            // The page is already in the buffer, return true
-            return true;
+        // After a failed eviction or read none of the installed pages is kept, the pins of the batch go with them
+        for (int j = 0; j < numInstalled; j++)
+        {
+            if (ioRc != RC_OK)
+            {
+                failPageRead(bm, installed[j].frameNum, installed[j].pageNum, ioRc);
+                continue;
+            }
+            PageFrameNode *frame = &pfmd->frames[installed[j].frameNum];
+            trackLoadedFrame(bm, installed[j].frameNum);
+            completeJoinedPins(bm, finishFrameIo(frame));
+        }
+        if (ioRc != RC_OK)
+        {
+            for (int i = 0; i < numPages; i++)
+            {
+                if (loadedFrame[i] != NO_FRAME)
+                {
+                    loadedFrame[i] = NO_FRAME;
+                    pinned[i] = false;
+                }
+            }
         }
     }
 
-    // Page not found in the buffer, return false
-    return false;
-}
-
+    // Mapped frames only know where their data is once the pages are read
+    for (int i = 0; i < numPages; i++)
+    {
+        if (loadedFrame[i] != NO_FRAME)
+        {
+            updateBufferAndPageHandle(&pfmd->frames[loadedFrame[i]], &pages[i], pageNums[i]);
+        }
+    }
 
+    for (int j = 0; j < numRetries && !outOfFrames && ioRc == RC_OK; j++)
+    {
+        int i = pending[j];
+        RC rc = pinPage(bm, &pages[i], pageNums[i]);
+        if (rc == RC_FILE_NOT_FOUND)
+        {
+            outOfFrames = true;
+            break;
+        }
+        if (rc != RC_OK)
+        {
+            ioRc = rc;
+            break;
+        }
+        pinned[i] = true;
+    }
 
-// Function to update the queue when the page is already in the buffer pool
-void updateQueueOnPageHit(Queue *queue, int j, int numPages, PageFrameNode *pageFrame, int frameNumber, PageNumber pageNum)
-{
-    for (int z = j + 1; z < numPages; z++)
+    if (outOfFrames || ioRc != RC_OK)
     {
-        queue[z - 1].pageNumber = queue[z].pageNumber;
-        queue[z - 1].frameNumber = queue[z].frameNumber;
+        for (int i = 0; i < numPages; i++)
+        {
+            if (pinned[i])
+            {
+                unpinPage(bm, &pages[i]);
+            }
+        }
     }
 
-    int lastIdx = numPages - 1;
-    queue[lastIdx].pageNumber = pageNum;
-    queue[lastIdx].frameNumber = pageFrame[frameNumber].FrameNum;
+    free(installed);
+    free(pending);
+    free(loadedFrame);
+    free(pinned);
+
+    if (outOfFrames)
+    {
+        atomic_fetch_add(&pfmd->NoOfPinFailures, 1);
+        RC_message = "Not enough unpinned frames for all pages.";
+        return RC_FILE_NOT_FOUND;
+    }
+    if (ioRc != RC_OK)
+    {
+        return ioRc;
+    }
+    RC_message = "Pages successfully pinned.";
+    return RC_OK;
 }
 
-// Function to handle buffer replacement when the buffer is full (if-else version)
-bool handleBufferReplacement(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+// Unpins numPages pages pinned through pinPage or pinPages. Every page is unpinned even if one of them
+// fails, the error is returned afterwards
+RC unpinPages(BM_BufferPool *const bm, BM_PageHandle *const pages, const int numPages)
 {
-    if (bm->strategy == RS_FIFO)
+    if (bm->mgmtData == NULL)
     {
-        return pinFIFO(bm, page, pageNum);
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
     }
-    else if (bm->strategy == RS_LRU)
+
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    int failed = 0;
+    for (int i = 0; i < numPages; i++)
     {
-        return pinLRU(bm, page, pageNum);
+        int frameIndex = findPinnedFrame(pfmd, pages[i].pageNum);
+        if (frameIndex == NO_PAGE || !releaseFramePin(bm, frameIndex))
+        {
+            failed++;
+        }
     }
-    else if (bm->strategy == RS_LRU_K)
+
+    return (failed == 0) ? (RC_message = "Pages successfully unpinned.", RC_OK) : (RC_message = "Failed to unpin pages that are not available in the buffer pool.", RC_FILE_NOT_FOUND);
+}
+
+/// Scan Rings ///
+
+// Starts a scan that reads its pages through a private ring of ringSize frames (a default size if
+// ringSize is 0), at most a quarter of the pool. Once the ring is full, every miss of the scan reuses
+// the frame of its oldest ring page instead of evicting a page of the main pool
+RC beginScan(BM_BufferPool *const bm, BM_ScanHandle *const scan, const int ringSize)
+{
+    if (bm->mgmtData == NULL || ringSize < 0)
     {
-        return pinLRU(bm, page, pageNum); // Handle LRU_K as a fallback strategy
+        RC_message = "Buffer pool not found or ring size is not valid.";
+        return RC_FILE_NOT_FOUND;
     }
-    else if (bm->strategy == RS_CLOCK)
+
+    int size = (ringSize > 0) ? ringSize : DEFAULT_SCAN_RING_SIZE;
+    int numFrames = getPoolMetadata(bm)->NumberOfFrames;
+    if (size > numFrames / 4)
     {
-        return pinCLOCK(bm, page, pageNum);
+        size = (numFrames / 4 > 0) ? numFrames / 4 : 1;
     }
-    else
+
+    scan->ringFrames = (int *)malloc(sizeof(int) * size);
+    scan->ringPages = (PageNumber *)malloc(sizeof(PageNumber) * size);
+    if (scan->ringFrames == NULL || scan->ringPages == NULL)
     {
-        // Return false if the strategy is unknown
-        return false;
+        free(scan->ringFrames);
+        free(scan->ringPages);
+        RC_message = "Not enough memory for the scan ring.";
+        return RC_FILE_NOT_FOUND;
     }
+    scan->ringSize = size;
+    scan->ringUsed = 0;
+    scan->ringNext = 0;
+
+    RC_message = "Scan started.";
+    return RC_OK;
 }
 
-// Function to find an empty frame and load the page into it
-bool loadPageIntoEmptyFrame(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, Queue *queue, PageFrameNode *pageFrame)
+// Frame for the next miss of a scan: the oldest ring frame if it is unpinned and still holds the
+// page the scan read into it, otherwise a frame of the pool as for pinPage
+int claimRingFrame(BM_BufferPool *const bm, BM_ScanHandle *const scan, const PageNumber pageNum)
 {
-    SM_FileHandle fHandle;
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    int frameNum = NO_FRAME;
 
-    // Iterate over the buffer pool's frames to find an empty one
-    for (int i = 0; i < bm->numPages; i++)
+    pthread_mutex_lock(&pfmd->replacementLatch);
+    if (scan->ringUsed == scan->ringSize)
     {
-        // Check if the page frame is empty by verifying the page number is invalid
-        if (pageFrame[i].bh->pageNum < 0)
+        int candidate = scan->ringFrames[scan->ringNext];
+        if (tryClaimFrameHolding(&pfmd->frames[candidate], scan->ringPages[scan->ringNext]))
         {
-            // Open the associated file for the buffer pool
-            openPageFile(bm->pageFile, &fHandle);
-
-            // Ensure that the file has the required capacity
-            ensureCapacity(pageNum, &fHandle);
-
-            // Fetch the content from the block
-            SM_PageHandle currentPageData ;
-            currentPageData= pageFrame[i].readContent;
-            readBlock(pageNum, &fHandle, currentPageData);
-
-         // Define variables to hold the new state
-int isDirty = 0; // Not dirty
-int fixCount = 1; // Pinned state
+            detachClaimedFrame(bm, candidate);
+            frameNum = candidate;
+        }
+    }
+    if (frameNum == NO_FRAME)
+    {
+        frameNum = claimEmptyFrame(pfmd);
+    }
+    if (frameNum == NO_FRAME)
+    {
+        frameNum = handleBufferReplacement(bm, pageNum);
+    }
+    pthread_mutex_unlock(&pfmd->replacementLatch);
 
-// Set the page frame properties using the defined variables
-pageFrame[i].DirtyFlag = isDirty; 
-pageFrame[i].FixCount = fixCount; 
+    return frameNum;
+}
 
-// Store the read content into the page handle
-SM_PageHandle pageContent = currentPageData; // Store the read content
-page->data = pageContent;
-page->pageNum = pageNum;
+// Pins a page for a scan started with beginScan. Hits are served like pinPage, misses go through the
+// scan's ring and do not read ahead. Pages are unpinned with unpinPage
+RC pinPageForScan(BM_BufferPool *const bm, BM_ScanHandle *const scan, BM_PageHandle *const page, const PageNumber pageNum)
+{
+    if (bm->mgmtData == NULL || !isValidPageKey(getPoolMetadata(bm), pageNum))
+    {
+        RC_message = "Buffer pool not found or page number is not valid.";
+        return RC_FILE_NOT_FOUND;
+    }
 
-// Update the buffer frame's page handle data and page number
-BM_PageHandle* bufferHandle = pageFrame[i].bh; // Store the buffer handle
-bufferHandle->data = pageContent;
-bufferHandle->pageNum = pageNum;
+    PageFrameMD *pfmd = getPoolMetadata(bm);
 
-// Reflect the newly loaded page in the queue
-int frameNumber = pageFrame[i].FrameNum; // Store the frame number
-queue[i].frameNumber = frameNumber;
-queue[i].pageNumber = pageNum;
+    while (true)
+    {
+        if (checkPageInBuffer(bm, page, pageNum, pfmd->frames, NULL))
+        {
+            return RC_OK;
+        }
 
-// Increment metadata for filled frames and read operations
-pfmd.NumberOfFramesFilled++; // Increment filled frame count
-NoOfReads++; // Increment the number of read operations
+        int frameNum = claimRingFrame(bm, scan, pageNum);
+        if (frameNum == NO_FRAME)
+        {
+            atomic_fetch_add(&pfmd->NoOfPinFailures, 1);
+            RC_message = "Every frame of the buffer pool is pinned.";
+            return RC_FILE_NOT_FOUND;
+        }
 
+        // If another thread loaded the page first, pin its copy instead. A failed read leaves the ring as it was
+        RC rc;
+        if (loadPageIntoFrame(bm, page, frameNum, pageNum, &rc))
+        {
+            if (rc != RC_OK)
+            {
+                return rc;
+            }
 
-            return true;
+            // The frame takes the place of the oldest ring page, whether it could be reused or not
+            int slot;
+            if (scan->ringUsed < scan->ringSize)
+            {
+                slot = scan->ringUsed++;
+            }
+            else
+            {
+                slot = scan->ringNext;
+                scan->ringNext = (scan->ringNext + 1) % scan->ringSize;
+            }
+            scan->ringFrames[slot] = frameNum;
+            scan->ringPages[slot] = pageNum;
+            return RC_OK;
         }
     }
-
-    return false;  // Return false if no empty frame was found
 }
 
-
-// Main pinPage function
-RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+// Ends a scan. The pages left in its ring stay in the pool like any other page
+RC endScan(BM_BufferPool *const bm, BM_ScanHandle *const scan)
 {
-    // Check if the buffer pool exists and page number is valid
-   if (bm->mgmtData == NULL) {
-    // If the management data is NULL, the buffer pool does not exist
-    return RC_FILE_NOT_FOUND; 
-} else if (pageNum < 0) {
-    // If the page number is negative, it is considered invalid
-    return RC_FILE_NOT_FOUND; 
-}
-
-
-    bool isPageSet;
-   isPageSet  = false;
-    Queue *queue ;
-    queue= (Queue *)pfmd.queue;
-    PageFrameNode *pageFrame = (PageFrameNode *)bm->mgmtData;
-
-    // Check if the page is already in the buffer pool
-    if (checkPageInBuffer(bm, page, pageNum, queue, pageFrame))
+    if (bm->mgmtData == NULL)
     {
-        return RC_OK;
+        RC_message = "Buffer pool not found.";
+        return RC_FILE_NOT_FOUND;
     }
 
-    // If the buffer pool is full, handle page replacement based on the strategy
-    if (pfmd.NumberOfFramesFilled == pfmd.NumberOfFrames)
-    {
-        isPageSet = handleBufferReplacement(bm, page, pageNum);
-    }
-    else
-    {
-        // Otherwise, find an empty frame and load the page
-        isPageSet = loadPageIntoEmptyFrame(bm, page, pageNum, queue, pageFrame);
-    }
+    free(scan->ringFrames);
+    free(scan->ringPages);
+    scan->ringFrames = NULL;
+    scan->ringPages = NULL;
+    scan->ringSize = 0;
+    scan->ringUsed = 0;
 
-    return isPageSet ? RC_OK : RC_FILE_NOT_FOUND;
+    RC_message = "Scan ended.";
+    return RC_OK;
+}
+
+// Frames of the pool, read once under the replacement latch that resizeBufferPool holds while it
+// changes the size. Frames past a later shrink keep their metadata, so callers can use the count after
+int readFrameCount(PageFrameMD *pfmd)
+{
+    pthread_mutex_lock(&pfmd->replacementLatch);
+    int numFrames = pfmd->NumberOfFrames;
+    pthread_mutex_unlock(&pfmd->replacementLatch);
+    return numFrames;
 }
 
 //returns array with all the page numbers in the buffer pool.
 PageNumber *getFrameContents(BM_BufferPool *const bm)
 {
     // Allocate memory for the array of PageNumbers
+    int numFrames = readFrameCount(getPoolMetadata(bm));
     PageNumber *pageNumbers ;
-    pageNumbers = malloc(sizeof(PageNumber) * bm->numPages);
+    pageNumbers = malloc(sizeof(PageNumber) * numFrames);
     
     // Access the page frames from the buffer pool's management data
     PageFrameNode *pageFrame ;
-    pageFrame = (PageFrameNode *)bm->mgmtData;
+    pageFrame = getPoolMetadata(bm)->frames;
     
     // Iterate over the page frames using a for loop
-    for (int i = 0; i < bm->numPages; i++)
+    for (int i = 0; i < numFrames; i++)
 {
     // Check if the frame is empty and assign the appropriate value
+    pthread_mutex_lock(&pageFrame[i].latch);
     int currentPageNum = pageFrame[i].bh->pageNum;
+    pthread_mutex_unlock(&pageFrame[i].latch);
     pageNumbers[i] = (currentPageNum == -1) ? NO_PAGE : currentPageNum;
 }
 
@@ -826,21 +5263,38 @@ return pageNumbers;
 }
 
 
+// Pages written by the last forceFlushPool of the pool
+int getLastFlushPageCount(BM_BufferPool *const bm)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    return (pfmd == NULL) ? 0 : pfmd->LastFlushPages;
+}
+
+// Write calls the last forceFlushPool needed, one per run of consecutive pages
+int getLastFlushWriteCalls(BM_BufferPool *const bm)
+{
+    PageFrameMD *pfmd = getPoolMetadata(bm);
+    return (pfmd == NULL) ? 0 : pfmd->LastFlushWriteCalls;
+}
+
 // Returns an array with dirty flags for each frame in the buffer pool
 bool *getDirtyFlags(BM_BufferPool *const bm)
 {
 
+    int numFrames = readFrameCount(getPoolMetadata(bm));
     bool *dirtyFlags;
-    dirtyFlags = malloc(sizeof(bool) * bm->numPages);
+    dirtyFlags = malloc(sizeof(bool) * numFrames);
     
 
     PageFrameNode *pageFrame;
-    pageFrame= (PageFrameNode *)bm->mgmtData;
+    pageFrame= getPoolMetadata(bm)->frames;
 
-    for (int i = 0; i < bm->numPages; i++)
+    for (int i = 0; i < numFrames; i++)
     {
-
+        // The page cleaner may be writing the frame back concurrently
+        pthread_mutex_lock(&pageFrame[i].latch);
         dirtyFlags[i] = pageFrame[i].DirtyFlag ? true : false;
+        pthread_mutex_unlock(&pageFrame[i].latch);
     }
 
 
@@ -851,18 +5305,20 @@ bool *getDirtyFlags(BM_BufferPool *const bm)
 int *getFixCounts(BM_BufferPool *const bm)
 {
     // Allocate memory for the array of fix counts
+    int numFrames = readFrameCount(getPoolMetadata(bm));
     int *FixCounts ;
-    FixCounts = malloc(sizeof(int) * bm->numPages);
+    FixCounts = malloc(sizeof(int) * numFrames);
     
     // Access the page frames from the buffer pool's management data
     PageFrameNode *pageFrame ;
-    pageFrame = (PageFrameNode *)bm->mgmtData;
+    pageFrame = getPoolMetadata(bm)->frames;
 
     // Iterate over each page frame using a for loop
-    for (int i = 0; i < bm->numPages; i++)
+    for (int i = 0; i < numFrames; i++)
     {
-        // Set the fix count for each page frame, or NO_PAGE if FixCount is -1
-        FixCounts[i] = (pageFrame[i].FixCount != -1) ? pageFrame[i].FixCount : NO_PAGE;
+        // Set the fix count for each page frame, free and claimed frames (FixCount -1) have no pins
+        int fixCount = atomic_load(&pageFrame[i].FixCount);
+        FixCounts[i] = (fixCount >= 0) ? fixCount : 0;
     }
 
     // Return the array of fix counts
@@ -873,11 +5329,106 @@ int *getFixCounts(BM_BufferPool *const bm)
 //returns total number of wites
 int getNumWriteIO (BM_BufferPool *const bm)
 {
-   return NoOfWrites;
+   PageFrameMD *pfmd = getPoolMetadata(bm);
+   return (pfmd == NULL) ? 0 : pfmd->NoOfWrites;
 }
 
 //returns total number of reads
 int getNumReadIO (BM_BufferPool *const bm)
 {
-   return NoOfReads;
-}
\ No newline at end of file
+   PageFrameMD *pfmd = getPoolMetadata(bm);
+   return (pfmd == NULL) ? 0 : pfmd->NoOfReads;
+}
+
+// Copies the counters of the pool since initBufferPool. Each counter is read atomically on its own,
+// so a snapshot taken while other threads use the pool need not add up exactly
+RC getPoolStats (BM_BufferPool *const bm, BM_PoolStats *const stats)
+{
+   PageFrameMD *pfmd = getPoolMetadata(bm);
+   if (pfmd == NULL)
+   {
+      RC_message = "Buffer pool not found.";
+      return RC_FILE_NOT_FOUND;
+   }
+
+   stats->hits = atomic_load(&pfmd->NoOfHits);
+   stats->misses = atomic_load(&pfmd->NoOfMisses);
+   stats->cleanEvictions = atomic_load(&pfmd->NoOfCleanEvictions);
+   stats->dirtyEvictions = atomic_load(&pfmd->NoOfDirtyEvictions);
+   stats->pagesRead = atomic_load(&pfmd->NoOfReads);
+   stats->pagesWritten = atomic_load(&pfmd->NoOfWrites);
+   stats->readCalls = atomic_load(&pfmd->NoOfReadCalls);
+   stats->writeCalls = atomic_load(&pfmd->NoOfWriteCalls);
+   stats->bytesRead = atomic_load(&pfmd->BytesRead);
+   stats->bytesWritten = atomic_load(&pfmd->BytesWritten);
+   stats->flushes = atomic_load(&pfmd->NoOfFlushes);
+   stats->pinFailures = atomic_load(&pfmd->NoOfPinFailures);
+   return RC_OK;
+}
+
+// Starts the latency histograms of the pool. Timing costs two clock reads and a few relaxed atomic
+// additions per timed call, pools that never enable it pay one load
+RC enableLatencyHistograms (BM_BufferPool *const bm)
+{
+   PageFrameMD *pfmd = getPoolMetadata(bm);
+   if (pfmd == NULL)
+   {
+      RC_message = "Buffer pool not found.";
+      return RC_FILE_NOT_FOUND;
+   }
+
+   atomic_store(&pfmd->LatencyTracking, true);
+   return RC_OK;
+}
+
+// Copies one latency histogram of the pool. The count is the sum of the copied buckets, so
+// latencyPercentile works on a consistent histogram even while other threads keep adding to it
+RC getLatencyHistogram (BM_BufferPool *const bm, const BM_LatencyKind kind, BM_LatencyHistogram *const histogram)
+{
+   PageFrameMD *pfmd = getPoolMetadata(bm);
+   if (pfmd == NULL || kind < 0 || kind >= BM_NUM_LATENCY_KINDS)
+   {
+      RC_message = "Buffer pool or latency histogram not found.";
+      return RC_FILE_NOT_FOUND;
+   }
+
+   LatencyCounters *counters = &pfmd->latency[kind];
+   histogram->count = 0;
+   for (int bucket = 0; bucket < BM_LATENCY_BUCKETS; bucket++)
+   {
+      histogram->buckets[bucket] = atomic_load_explicit(&counters->buckets[bucket], memory_order_relaxed);
+      histogram->count += histogram->buckets[bucket];
+   }
+   histogram->sumNanos = atomic_load_explicit(&counters->sumNanos, memory_order_relaxed);
+   histogram->maxNanos = atomic_load_explicit(&counters->maxNanos, memory_order_relaxed);
+   return RC_OK;
+}
+
+// Latency in nanoseconds that the given percentage of the calls did not exceed (50 for p50, 99.9 for p999).
+// Reported as the upper end of its bucket, at most 25% above the real value, and never above the maximum
+long long latencyPercentile (const BM_LatencyHistogram *const histogram, const double percentile)
+{
+   if (histogram->count == 0)
+   {
+      return 0;
+   }
+
+   double exactRank = histogram->count * percentile / 100.0;
+   long long rank = (long long)exactRank;
+   if (rank < exactRank || rank == 0)
+   {
+      rank++;
+   }
+
+   long long seen = 0;
+   for (int bucket = 0; bucket < BM_LATENCY_BUCKETS; bucket++)
+   {
+      seen += histogram->buckets[bucket];
+      if (seen >= rank)
+      {
+         long long limit = latencyBucketLimit(bucket);
+         return (limit < histogram->maxNanos) ? limit : histogram->maxNanos;
+      }
+   }
+   return histogram->maxNanos;
+}
@@ -13,13 +13,24 @@ typedef enum ReplacementStrategy {
 	RS_LRU = 1,
 	RS_CLOCK = 2,
 	RS_LFU = 3,
-	RS_LRU_K = 4
+	RS_LRU_K = 4,
+	RS_ARC = 5,
+	RS_2Q = 6
 } ReplacementStrategy;
 
 // Data Types and Structures
 typedef int PageNumber;
 #define NO_PAGE -1
 
+// Pages of a pool shared by several page files are pinned by their page key, which combines the
+// file id returned by registerPageFile with the page number inside the file. File 0 is the file
+// given to initBufferPool, so its page keys are its page numbers
+#define BM_MAX_PAGE_FILES 128
+#define BM_FILE_PAGE_BITS 24 // pages per registered file: 2^24, 64 GB
+#define BM_PAGE_KEY(fileId, pageNum) (((fileId) << BM_FILE_PAGE_BITS) | (pageNum))
+#define BM_PAGE_FILE_ID(pageKey) ((pageKey) >> BM_FILE_PAGE_BITS)
+#define BM_PAGE_NUMBER(pageKey) ((pageKey) & ((1 << BM_FILE_PAGE_BITS) - 1))
+
 typedef struct BM_BufferPool {
 	char *pageFile;
 	int numPages;
@@ -33,6 +44,88 @@ typedef struct BM_PageHandle {
 	char *data;
 } BM_PageHandle;
 
+// Asynchronous pin, owned by the caller. pollPinCompletions hands it back once the page is pinned
+typedef struct BM_PinRequest {
+	BM_PageHandle *page; // filled in when the pin completes
+	PageNumber pageNum;
+	RC rc; // result of the pin, valid once completed is set
+	bool completed;
+	void (*callback) (struct BM_PinRequest *request); // run by pollPinCompletions, may be NULL
+	void *context; // for the callback
+	int frameNum; // used by the buffer manager
+	struct BM_PinRequest *next; // used by the buffer manager
+} BM_PinRequest;
+
+// Sequential scan reading its pages through a small ring of frames, see beginScan
+typedef struct BM_ScanHandle {
+	int ringSize;
+	int ringUsed; // used by the buffer manager
+	int ringNext; // used by the buffer manager
+	int *ringFrames; // used by the buffer manager
+	PageNumber *ringPages; // used by the buffer manager
+} BM_ScanHandle;
+
+// Counters of a buffer pool since initBufferPool, see getPoolStats
+typedef struct BM_PoolStats {
+	long hits; // pins served from the pool
+	long misses; // pins that had to read their page
+	long cleanEvictions;
+	long dirtyEvictions; // evictions that wrote the page back first
+	long pagesRead; // pages read from disk, read-ahead included (getNumReadIO)
+	long pagesWritten; // pages written to disk (getNumWriteIO)
+	long readCalls; // storage manager calls that read them
+	long writeCalls;
+	long bytesRead;
+	long bytesWritten;
+	long flushes; // forcePage, forceFlushPool and the flush of shutdownBufferPool
+	long pinFailures; // pins refused because every frame was pinned
+} BM_PoolStats;
+
+// Code paths with a latency histogram, see enableLatencyHistograms
+typedef enum BM_LatencyKind {
+	BM_LATENCY_PIN_HIT = 0, // pinPage served from the pool
+	BM_LATENCY_PIN_MISS = 1, // pinPage that read its page, eviction and read-ahead included
+	BM_LATENCY_VICTIM_SELECTION = 2, // the replacement strategy picking a victim
+	BM_LATENCY_EVICTION = 3, // emptying a victim, write-back of a dirty page included
+	BM_LATENCY_FORCE_PAGE = 4,
+	BM_LATENCY_FLUSH_POOL = 5, // forceFlushPool
+	BM_NUM_LATENCY_KINDS = 6
+} BM_LatencyKind;
+
+// Four buckets per power of two of nanoseconds, up to about 18 minutes
+#define BM_LATENCY_BUCKETS 156
+
+// Copy of one latency histogram of a pool, see getLatencyHistogram
+typedef struct BM_LatencyHistogram {
+	long long count;
+	long long sumNanos;
+	long long maxNanos;
+	long long buckets[BM_LATENCY_BUCKETS];
+} BM_LatencyHistogram;
+
+// Operations recorded in a pin trace, see startPinTrace
+#define BM_TRACE_PIN 0
+#define BM_TRACE_UNPIN 1
+#define BM_TRACE_MARK_DIRTY 2
+#define BM_TRACE_MAGIC "BMTRACE1" // first 8 bytes of a trace file, the records follow
+
+// One record of a pin trace file, stored in the byte order of the machine that recorded it
+typedef struct BM_TraceRecord {
+	long long timestamp; // nanoseconds since startPinTrace
+	PageNumber pageNum;
+	int operation; // BM_TRACE_PIN, BM_TRACE_UNPIN or BM_TRACE_MARK_DIRTY
+} BM_TraceRecord;
+
+// Resident pages of a pool saved for a warm restart, see savePoolContents and startPoolWarmup
+#define BM_SNAPSHOT_MAGIC "BMWARM01" // first 8 bytes of a snapshot file, an int record count and the records follow
+
+// One resident page of a snapshot, the records are stored hottest first
+typedef struct BM_SnapshotRecord {
+	PageNumber pageNum; // page key
+	int rank; // 0 for the page the strategy would evict last, pinned pages rank first
+	long frequency; // LFU reference count of the page, 0 under the other strategies
+} BM_SnapshotRecord;
+
 // convenience macros
 #define MAKE_POOL()					\
 		((BM_BufferPool *) malloc (sizeof(BM_BufferPool)))
@@ -46,6 +139,9 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
 		void *stratData);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
+RC resizeBufferPool(BM_BufferPool *const bm, const int numPages);
+RC registerPageFile(BM_BufferPool *const bm, const char *const pageFileName, int *const fileId);
+RC unregisterPageFile(BM_BufferPool *const bm, const int fileId);
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page);
@@ -53,6 +149,44 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 		const PageNumber pageNum);
+RC pinPageAsync (BM_BufferPool *const bm, BM_PageHandle *const page,
+		const PageNumber pageNum, BM_PinRequest *const request);
+int pollPinCompletions (BM_BufferPool *const bm, const bool waitForCompletion);
+RC pinPages (BM_BufferPool *const bm, BM_PageHandle *const pages,
+		const PageNumber *const pageNums, const int numPages);
+RC unpinPages (BM_BufferPool *const bm, BM_PageHandle *const pages, const int numPages);
+
+// Scan-resistant access
+RC beginScan (BM_BufferPool *const bm, BM_ScanHandle *const scan, const int ringSize);
+RC pinPageForScan (BM_BufferPool *const bm, BM_ScanHandle *const scan,
+		BM_PageHandle *const page, const PageNumber pageNum);
+RC endScan (BM_BufferPool *const bm, BM_ScanHandle *const scan);
+
+// Sequential read-ahead, on by default
+RC disableReadAhead (BM_BufferPool *const bm);
+
+// Direct I/O, bypasses the kernel page cache
+RC enableDirectIO (BM_BufferPool *const bm);
+
+// Frames pointing into a memory mapping of the page file
+RC enableMappedFrames (BM_BufferPool *const bm);
+
+// Pin trace recording, replayed by run_trace_sim.exe
+RC startPinTrace (BM_BufferPool *const bm, const char *const traceFileName);
+RC stopPinTrace (BM_BufferPool *const bm);
+
+// Background Page Cleaner
+RC startPageCleaner (BM_BufferPool *const bm, const int highWatermark,
+		const int lowWatermark);
+RC stopPageCleaner (BM_BufferPool *const bm);
+
+// Warm restarts: snapshots of the resident pages, reloaded in the background by a new pool
+RC savePoolContents (BM_BufferPool *const bm, const char *const snapshotFileName);
+RC startPoolSnapshots (BM_BufferPool *const bm, const char *const snapshotFileName,
+		const int intervalMillis);
+RC stopPoolSnapshots (BM_BufferPool *const bm);
+RC startPoolWarmup (BM_BufferPool *const bm, const char *const snapshotFileName);
+RC waitForPoolWarmup (BM_BufferPool *const bm, int *const pagesLoaded);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
@@ -60,5 +194,12 @@ bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+int getLastFlushPageCount (BM_BufferPool *const bm);
+int getLastFlushWriteCalls (BM_BufferPool *const bm);
+RC getPoolStats (BM_BufferPool *const bm, BM_PoolStats *const stats);
+RC enableLatencyHistograms (BM_BufferPool *const bm);
+RC getLatencyHistogram (BM_BufferPool *const bm, const BM_LatencyKind kind,
+		BM_LatencyHistogram *const histogram);
+long long latencyPercentile (const BM_LatencyHistogram *const histogram, const double percentile);
 
 #endif
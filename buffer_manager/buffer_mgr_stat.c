@@ -50,6 +50,81 @@ sprintPoolContent (BM_BufferPool *const bm)
 	return message;
 }
 
+char *
+sprintPoolStats (BM_BufferPool *const bm)
+{
+	BM_PoolStats stats;
+	char *message;
+	long pins;
+
+	if (getPoolStats(bm, &stats) != RC_OK)
+		return NULL;
+
+	message = (char *) malloc(512);
+	pins = stats.hits + stats.misses;
+	sprintf(message, "hits=%ld misses=%ld hitRatio=%.3f cleanEvictions=%ld dirtyEvictions=%ld "
+		"pagesRead=%ld pagesWritten=%ld readCalls=%ld writeCalls=%ld bytesRead=%ld bytesWritten=%ld "
+		"flushes=%ld pinFailures=%ld",
+		stats.hits, stats.misses, (pins > 0) ? (double) stats.hits / pins : 0.0,
+		stats.cleanEvictions, stats.dirtyEvictions, stats.pagesRead, stats.pagesWritten,
+		stats.readCalls, stats.writeCalls, stats.bytesRead, stats.bytesWritten,
+		stats.flushes, stats.pinFailures);
+
+	return message;
+}
+
+void
+printPoolStats (BM_BufferPool *const bm)
+{
+	char *message = sprintPoolStats(bm);
+
+	if (message == NULL)
+		return;
+	printf("{");
+	printStrat(bm);
+	printf(" %i}: %s\n", bm->numPages, message);
+	free(message);
+}
+
+// one line per histogram, latencies in nanoseconds
+char *
+sprintLatencyHistograms (BM_BufferPool *const bm)
+{
+	static const char *names[BM_NUM_LATENCY_KINDS] = { "pinHit", "pinMiss", "victimSelection", "eviction", "forcePage", "flushPool" };
+	BM_LatencyHistogram histogram;
+	char *message;
+	int pos = 0;
+	int kind;
+
+	message = (char *) malloc(256 * BM_NUM_LATENCY_KINDS);
+	for (kind = 0; kind < BM_NUM_LATENCY_KINDS; kind++)
+	{
+		if (getLatencyHistogram(bm, (BM_LatencyKind) kind, &histogram) != RC_OK)
+		{
+			free(message);
+			return NULL;
+		}
+		pos += sprintf(message + pos, "%s count=%lld mean=%lld p50=%lld p99=%lld p999=%lld max=%lld\n",
+			names[kind], histogram.count, (histogram.count > 0) ? histogram.sumNanos / histogram.count : 0,
+			latencyPercentile(&histogram, 50), latencyPercentile(&histogram, 99),
+			latencyPercentile(&histogram, 99.9), histogram.maxNanos);
+	}
+
+	return message;
+}
+
+void
+printLatencyHistograms (BM_BufferPool *const bm)
+{
+	char *message = sprintLatencyHistograms(bm);
+
+	if (message == NULL)
+		return;
+	printf("{");
+	printStrat(bm);
+	printf(" %i}:\n%s", bm->numPages, message);
+	free(message);
+}
 
 void
 printPageContent (BM_PageHandle *const page)
@@ -98,6 +173,12 @@ printStrat (BM_BufferPool *const bm)
 	case RS_LRU_K:
 		printf("LRU-K");
 		break;
+	case RS_ARC:
+		printf("ARC");
+		break;
+	case RS_2Q:
+		printf("2Q");
+		break;
 	default:
 		printf("%i", bm->strategy);
 		break;
@@ -8,5 +8,9 @@ void printPoolContent (BM_BufferPool *const bm);
 void printPageContent (BM_PageHandle *const page);
 char *sprintPoolContent (BM_BufferPool *const bm);
 char *sprintPageContent (BM_PageHandle *const page);
+void printPoolStats (BM_BufferPool *const bm);
+char *sprintPoolStats (BM_BufferPool *const bm);
+void printLatencyHistograms (BM_BufferPool *const bm);
+char *sprintLatencyHistograms (BM_BufferPool *const bm);
 
 #endif
@@ -1,9 +1,28 @@
 // Including required Header Files
+#define _GNU_SOURCE // O_DIRECT
 #include "dberror.h"
 #include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+#include "limits.h"
+#include "sys/uio.h"
+#include "fcntl.h"
+#include "stdint.h"
+#include "sys/mman.h"
 #include "storage_mgr.h"
 #include "test_helper.h"
 
+// Vectors a single pwritev may take, where limits.h does not say
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// Buffers and offsets of direct I/O must be aligned to the device block size, a page covers every common one
+#define DIRECT_IO_ALIGNMENT 4096
+
+// Address space reserved for a file mapping, so it can grow in place and pointers into it stay valid
+#define MAPPING_RESERVATION ((sizeof(size_t) > 4) ? ((size_t)1 << 34) : ((size_t)1 << 28))
 
 FILE* currentFile = NULL; 
 
@@ -49,6 +68,10 @@ void setFileHandleInfo(SM_FileHandle *fHandle, char *fileName, FILE *currentFile
 {
     fHandle->fileName = fileName;
     fHandle->mgmtInfo = currentFile;
+    fHandle->directFd = -1;
+    fHandle->mapping = NULL;
+    fHandle->mappedPages = 0;
+    fHandle->mappingReserved = 0;
 }
 int calculateTotalPages(FILE *currentFile)
 {
@@ -83,18 +106,159 @@ RC openPageFile(char *fileName, SM_FileHandle *fHandle)
         return RC_OK;
     }
 }
-RC closePage(SM_FileHandle *fileHandle)
+// Opens a second descriptor of the page file with O_DIRECT. Page transfers from page-aligned buffers
+// go through it and bypass the kernel page cache, everything else keeps using the stdio stream
+RC enableDirectFileIO(SM_FileHandle *fHandle)
+{
+    if (fHandle->mgmtInfo == NULL)
+    {
+        return (RC_message = "Unable to locate the specified file.", RC_FILE_NOT_FOUND);
+    }
+    if (fHandle->directFd >= 0)
+    {
+        RC_message = "Direct I/O is already enabled.";
+        return RC_OK;
+    }
+#ifdef O_DIRECT
+    // Writes still buffered by stdio must not land on top of later direct writes
+    fflush(fHandle->mgmtInfo);
+    int fd = open(fHandle->fileName, O_RDWR | O_DIRECT);
+    if (fd < 0)
+    {
+        return (RC_message = "The file system does not support direct I/O.", RC_FILE_NOT_FOUND);
+    }
+    fHandle->directFd = fd;
+    RC_message = "Direct I/O enabled.";
+    return RC_OK;
+#else
+    return (RC_message = "Direct I/O is not supported on this platform.", RC_FILE_NOT_FOUND);
+#endif
+}
+// Same as openPageFile, with direct I/O for aligned page buffers
+RC openPageFileDirect(char *fileName, SM_FileHandle *fHandle)
+{
+    RC rc = openPageFile(fileName, fHandle);
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+
+    // A stdio buffer would keep copies of pages that direct writes change underneath it
+    setvbuf(fHandle->mgmtInfo, NULL, _IONBF, 0);
+    rc = enableDirectFileIO(fHandle);
+    if (rc != RC_OK)
+    {
+        fclose(fHandle->mgmtInfo);
+        fHandle->mgmtInfo = NULL;
+    }
+    return rc;
+}
+// Descriptor to transfer a page buffer with, the direct one if the buffer is aligned for it
+int transferDescriptor(SM_FileHandle *fHandle, const void *memPage)
+{
+    if (fHandle->directFd >= 0 && (uintptr_t)memPage % DIRECT_IO_ALIGNMENT == 0)
+    {
+        return fHandle->directFd;
+    }
+    return -1;
+}
+// Maps the pages added since the last call at the end of the mapping, in place inside the reservation.
+// Does nothing for handles without a mapping
+RC extendMapping(SM_FileHandle *fHandle)
+{
+    if (fHandle->mapping == NULL || fHandle->totalNumPages <= fHandle->mappedPages)
+    {
+        return RC_OK;
+    }
+    size_t oldSize = (size_t)fHandle->mappedPages * PAGE_SIZE;
+    size_t newSize = (size_t)fHandle->totalNumPages * PAGE_SIZE;
+    if (newSize > fHandle->mappingReserved)
+    {
+        return (RC_message = "The file outgrew its mapping.", RC_FILE_NOT_FOUND);
+    }
+
+    // The new pages have to be in the file before they can be mapped
+    fflush(fHandle->mgmtInfo);
+    void *tail = mmap(fHandle->mapping + oldSize, newSize - oldSize, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_FIXED, fileno(fHandle->mgmtInfo), (off_t)oldSize);
+    if (tail == MAP_FAILED)
+    {
+        return (RC_message = "The file could not be mapped.", RC_FILE_NOT_FOUND);
+    }
+    fHandle->mappedPages = fHandle->totalNumPages;
+    return RC_OK;
+}
+// Maps the page file into memory for readBlockMapped. The mapping is private: pages change when the
+// file does, but writes through a pointer into it stay in memory until they are written with writeBlock.
+// Enough address space is reserved up front for the file to grow in place
+RC mapPageFile(SM_FileHandle *fHandle)
+{
+    if (fHandle->mgmtInfo == NULL)
+    {
+        return (RC_message = "Unable to locate the specified file.", RC_FILE_NOT_FOUND);
+    }
+    if (fHandle->mapping != NULL)
+    {
+        RC_message = "The file is already mapped.";
+        return RC_OK;
+    }
+    // Pages are mapped one by one, they must start on memory page boundaries
+    if (PAGE_SIZE % sysconf(_SC_PAGESIZE) != 0)
+    {
+        return (RC_message = "Pages cannot be mapped on this platform.", RC_FILE_NOT_FOUND);
+    }
+
+    size_t reservation = MAPPING_RESERVATION;
+    if ((size_t)fHandle->totalNumPages * PAGE_SIZE * 2 > reservation)
+    {
+        reservation = (size_t)fHandle->totalNumPages * PAGE_SIZE * 2;
+    }
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+    void *region = mmap(NULL, reservation, PROT_NONE, flags, -1, 0);
+    if (region == MAP_FAILED)
+    {
+        return (RC_message = "The file could not be mapped.", RC_FILE_NOT_FOUND);
+    }
+
+    fHandle->mapping = region;
+    fHandle->mappingReserved = reservation;
+    fHandle->mappedPages = 0;
+    if (extendMapping(fHandle) != RC_OK)
+    {
+        munmap(region, reservation);
+        fHandle->mapping = NULL;
+        fHandle->mappingReserved = 0;
+        return RC_FILE_NOT_FOUND;
+    }
+    RC_message = "File has been mapped.";
+    return RC_OK;
+}
+RC closePageFile(SM_FileHandle *fileHandle)
 {
     if (fileHandle->mgmtInfo != NULL)
     {
+        if (fileHandle->mapping != NULL)
+        {
+            munmap(fileHandle->mapping, fileHandle->mappingReserved);
+            fileHandle->mapping = NULL;
+            fileHandle->mappedPages = 0;
+        }
+        if (fileHandle->directFd >= 0)
+        {
+            close(fileHandle->directFd);
+            fileHandle->directFd = -1;
+        }
         fclose(fileHandle->mgmtInfo);
         fileHandle->mgmtInfo = NULL;
-        sprintf(RC_message, "Successfully closed the file.");
+        RC_message = "Successfully closed the file.";
         return RC_OK;
     }
     else
     {
-        sprintf(RC_message, "Unable to close file: File not found.");
+        RC_message = "Unable to close file: File not found.";
         return RC_FILE_NOT_FOUND;
     }
 }
@@ -124,12 +288,134 @@ RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
         RC_message = "Page number is not valid";
         return RC_READ_NON_EXISTING_PAGE;
     }
-    fseek(fHandle->mgmtInfo, pageNum * PAGE_SIZE, SEEK_SET);
-    fread(memPage, sizeof(char), PAGE_SIZE, fHandle->mgmtInfo);
+    int directFd = transferDescriptor(fHandle, memPage);
+    if (directFd >= 0)
+    {
+        ssize_t bytesRead = pread(directFd, memPage, PAGE_SIZE, (off_t)pageNum * PAGE_SIZE);
+        if (bytesRead < 0)
+        {
+            RC_message = "File could not be read";
+            return RC_READ_NON_EXISTING_PAGE;
+        }
+        // Past the end of the file the page reads as empty
+        memset(memPage + bytesRead, 0, PAGE_SIZE - bytesRead);
+    }
+    else
+    {
+        fseek(fHandle->mgmtInfo, pageNum * PAGE_SIZE, SEEK_SET);
+        if (fread(memPage, sizeof(char), PAGE_SIZE, fHandle->mgmtInfo) < PAGE_SIZE && ferror(fHandle->mgmtInfo))
+        {
+            clearerr(fHandle->mgmtInfo);
+            RC_message = "File could not be read";
+            return RC_READ_NON_EXISTING_PAGE;
+        }
+    }
+    fHandle->curPagePos = pageNum;
+    RC_message = "File has been sucessfully read";
+    return RC_OK;
+}
+// Hands out a pointer to the page inside the mapping instead of copying it, see mapPageFile
+RC readBlockMapped(int pageNum, SM_FileHandle *fHandle, SM_PageHandle *memPage)
+{
+    if (fHandle->mapping == NULL)
+    {
+        RC_message = "File has not been mapped.";
+        return RC_FILE_NOT_FOUND;
+    }
+    if (pageNum < 0 || pageNum >= fHandle->mappedPages)
+    {
+        RC_message = "Page number is not valid";
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    *memPage = fHandle->mapping + (size_t)pageNum * PAGE_SIZE;
     fHandle->curPagePos = pageNum;
     RC_message = "File has been sucessfully read";
     return RC_OK;
 }
+// Vectored transfers go direct only if every buffer is aligned for it
+int vectorDescriptor(SM_FileHandle *fHandle, const struct iovec *vectors, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (transferDescriptor(fHandle, vectors[i].iov_base) < 0)
+        {
+            return fileno(fHandle->mgmtInfo);
+        }
+    }
+    return (fHandle->directFd >= 0) ? fHandle->directFd : fileno(fHandle->mgmtInfo);
+}
+// Reads numPages consecutive pages starting at firstPageNum into separate buffers with as few
+// system calls as the platform allows, memPages[i] receives page firstPageNum + i
+RC readBlocks(int firstPageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages)
+{
+    if (fHandle->mgmtInfo == NULL)
+    {
+        RC_message = "File has not been found.";
+        return RC_FILE_NOT_FOUND;
+    }
+    if (firstPageNum < 0 || numPages < 1 || firstPageNum + numPages > fHandle->totalNumPages)
+    {
+        RC_message = "Page number is not valid";
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    struct iovec *vectors = (struct iovec *)malloc(sizeof(struct iovec) * numPages);
+    if (vectors == NULL)
+    {
+        RC_message = "File could not be read";
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    for (int i = 0; i < numPages; i++)
+    {
+        vectors[i].iov_base = memPages[i];
+        vectors[i].iov_len = PAGE_SIZE;
+    }
+
+    // Pending stdio writes have to reach the file before it is read around them
+    fflush(fHandle->mgmtInfo);
+    int fd = vectorDescriptor(fHandle, vectors, numPages);
+    off_t offset = (off_t)firstPageNum * PAGE_SIZE;
+    int first = 0;
+
+    while (first < numPages)
+    {
+        int count = (numPages - first < IOV_MAX) ? numPages - first : IOV_MAX;
+        ssize_t bytesRead = preadv(fd, &vectors[first], count, offset);
+        if (bytesRead < 0)
+        {
+            free(vectors);
+            RC_message = "File could not be read";
+            return RC_READ_NON_EXISTING_PAGE;
+        }
+        if (bytesRead == 0)
+        {
+            // Nothing more in the file, the rest reads as empty pages
+            for (; first < numPages; first++)
+            {
+                memset(vectors[first].iov_base, 0, vectors[first].iov_len);
+            }
+            break;
+        }
+        offset += bytesRead;
+
+        // Skip the vectors filled completely and continue a partly filled one
+        while (first < numPages && bytesRead >= (ssize_t)vectors[first].iov_len)
+        {
+            bytesRead -= vectors[first].iov_len;
+            first++;
+        }
+        if (bytesRead > 0)
+        {
+            vectors[first].iov_base = (char *)vectors[first].iov_base + bytesRead;
+            vectors[first].iov_len -= bytesRead;
+        }
+    }
+    free(vectors);
+
+    fHandle->curPagePos = firstPageNum + numPages - 1;
+    RC_message = "File has been sucessfully read";
+    return RC_OK;
+}
 int retrieveCurrentBlockPosition(SM_FileHandle *fHandle)
 {
     int currentPosition = fHandle->curPagePos;
@@ -199,6 +485,13 @@ RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 RC writeDataToFile(SM_FileHandle *fHandle, SM_PageHandle memPage, int pageNum)
 {
     long offset = pageNum * PAGE_SIZE;
+
+    int directFd = transferDescriptor(fHandle, memPage);
+    if (directFd >= 0)
+    {
+        return (pwrite(directFd, memPage, PAGE_SIZE, offset) == PAGE_SIZE) ? RC_OK : RC_WRITE_FAILED;
+    }
+
     fseek(fHandle->mgmtInfo, offset, SEEK_SET);
 
     size_t totalBytesWritten = 0;
@@ -212,6 +505,12 @@ RC writeDataToFile(SM_FileHandle *fHandle, SM_PageHandle memPage, int pageNum)
         }
         totalBytesWritten += writeResult;
     }
+
+    // The mapping only sees what stdio has handed to the file
+    if (fHandle->mapping != NULL)
+    {
+        fflush(fHandle->mgmtInfo);
+    }
     
     return RC_OK;
 }
@@ -231,29 +530,95 @@ RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
     {
         rc = writeDataToFile(fHandle, memPage, pageNum);
         fHandle->curPagePos = pageNum;
-        fclose(fHandle->mgmtInfo);
         RC_message = (rc == RC_OK) ? "Content written to File successfully." : "Error occurred during writing.";
     }
 
     return rc;
 }
+// Writes numPages consecutive pages starting at firstPageNum with as few system calls as the
+// platform allows, memPages[i] holds the content of page firstPageNum + i
+RC writeBlocks(int firstPageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages)
+{
+    if (fHandle->mgmtInfo == NULL)
+    {
+        return (RC_message = "Unable to locate the specified file.", RC_FILE_NOT_FOUND);
+    }
+    if (firstPageNum < 0 || numPages < 1 || firstPageNum + numPages > fHandle->totalNumPages)
+    {
+        return (RC_message = "Page number is not exist in the file", RC_READ_NON_EXISTING_PAGE);
+    }
+
+    struct iovec *vectors = (struct iovec *)malloc(sizeof(struct iovec) * numPages);
+    if (vectors == NULL)
+    {
+        return (RC_message = "Error occurred during writing.", RC_WRITE_FAILED);
+    }
+    for (int i = 0; i < numPages; i++)
+    {
+        vectors[i].iov_base = memPages[i];
+        vectors[i].iov_len = PAGE_SIZE;
+    }
+
+    // Anything still buffered by stdio has to reach the file before it is written around
+    fflush(fHandle->mgmtInfo);
+    int fd = vectorDescriptor(fHandle, vectors, numPages);
+    off_t offset = (off_t)firstPageNum * PAGE_SIZE;
+    int first = 0;
+    RC rc = RC_OK;
+
+    while (first < numPages)
+    {
+        int count = (numPages - first < IOV_MAX) ? numPages - first : IOV_MAX;
+        ssize_t written = pwritev(fd, &vectors[first], count, offset);
+        if (written <= 0)
+        {
+            rc = RC_WRITE_FAILED;
+            break;
+        }
+        offset += written;
+
+        // Skip the vectors written completely and continue a partly written one
+        while (first < numPages && written >= (ssize_t)vectors[first].iov_len)
+        {
+            written -= vectors[first].iov_len;
+            first++;
+        }
+        if (written > 0)
+        {
+            vectors[first].iov_base = (char *)vectors[first].iov_base + written;
+            vectors[first].iov_len -= written;
+        }
+    }
+    free(vectors);
+
+    fHandle->curPagePos = firstPageNum + numPages - 1;
+    RC_message = (rc == RC_OK) ? "Content written to File successfully." : "Error occurred during writing.";
+    return rc;
+}
 RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
 	int currentPage = getCurrPage(fHandle, "curr");
     RC wrireResult = writeBlock(currentPage, fHandle, memPage);
     return wrireResult;
 }
-void writeEmptyBlock(SM_FileHandle *fHandle)
+// The page only counts once it has been written
+RC writeEmptyBlock(SM_FileHandle *fHandle)
 {
     fseek(fHandle->mgmtInfo, 0, SEEK_END);  
     char *emptyBlock = (char *)malloc(PAGE_SIZE * sizeof(char));
-    if (emptyBlock != NULL) {
-        memset(emptyBlock, 0, PAGE_SIZE);
-        fwrite(emptyBlock, sizeof(char), PAGE_SIZE, fHandle->mgmtInfo);
-        free(emptyBlock); 
-    }  
+    if (emptyBlock == NULL) {
+        return RC_WRITE_FAILED;
+    }
+    memset(emptyBlock, 0, PAGE_SIZE);
+    size_t written = fwrite(emptyBlock, sizeof(char), PAGE_SIZE, fHandle->mgmtInfo);
+    free(emptyBlock); 
+    if (written != PAGE_SIZE) {
+        clearerr(fHandle->mgmtInfo);
+        return RC_WRITE_FAILED;
+    }
     fHandle->totalNumPages++;
     fHandle->curPagePos = fHandle->totalNumPages - 1;
+    return RC_OK;
 }
 
 RC appendEmptyBlock(SM_FileHandle *fHandle)
@@ -262,9 +627,14 @@ RC appendEmptyBlock(SM_FileHandle *fHandle)
     {
         return (RC_message = "Unable to locate the specified file.", RC_FILE_NOT_FOUND);
     }
+    else if (writeEmptyBlock(fHandle) != RC_OK)
+    {
+        return (RC_message = "Unable to append an empty block.", RC_WRITE_FAILED);
+    }
     else
     {
-        writeEmptyBlock(fHandle);
+        // A mapping that cannot grow only leaves the new page to readBlock
+        extendMapping(fHandle);
         RC_message = "Appended an empty block at the end of the file successfully, filled with null values.";
         return RC_OK;
     }
@@ -281,9 +651,14 @@ RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle)
         int totalNumPages = fHandle->totalNumPages;
         while(numberOfPages > totalNumPages)
         {
-            appendEmptyBlock(fHandle);
+            if (writeEmptyBlock(fHandle) != RC_OK)
+            {
+                return (RC_message = "Unable to extend the file.", RC_WRITE_FAILED);
+            }
             totalNumPages = fHandle->totalNumPages;
         }
+        // Grow the mapping once for all new pages
+        extendMapping(fHandle);
         return RC_OK;
     }
 }
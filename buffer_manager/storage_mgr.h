@@ -1,6 +1,8 @@
 #ifndef STORAGE_MGR_H
 #define STORAGE_MGR_H
 
+#include <stddef.h>
+
 #include "dberror.h"
 
 /************************************************************
@@ -11,6 +13,10 @@ typedef struct SM_FileHandle {
 	int totalNumPages;
 	int curPagePos;
 	void *mgmtInfo;
+	int directFd; // O_DIRECT descriptor for aligned page transfers, -1 unless direct I/O is enabled
+	char *mapping; // private mapping of the file, NULL unless mapPageFile was called
+	int mappedPages; // pages of the file covered by the mapping
+	size_t mappingReserved; // address space reserved for the mapping to grow into
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
@@ -22,11 +28,16 @@ typedef char* SM_PageHandle;
 extern void initStorageManager (void);
 extern RC createPageFile (char *fileName);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileDirect (char *fileName, SM_FileHandle *fHandle);
+extern RC enableDirectFileIO (SM_FileHandle *fHandle);
 extern RC closePageFile (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
 
 /* reading blocks from disc */
 extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC readBlocks (int firstPageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
+extern RC mapPageFile (SM_FileHandle *fHandle);
+extern RC readBlockMapped (int pageNum, SM_FileHandle *fHandle, SM_PageHandle *memPage);
 extern int getBlockPos (SM_FileHandle *fHandle);
 extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
@@ -36,6 +47,7 @@ extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 
 /* writing blocks to a page file */
 extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlocks (int firstPageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
@@ -2,11 +2,20 @@
 #include "buffer_mgr_stat.h"
 #include "buffer_mgr.h"
 #include "dberror.h"
+#include "trace_replay.h"
 #include "test_helper.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <signal.h>
+#include <stdint.h>
 
 // var to store the current test's name
 char *testName;
@@ -33,8 +42,43 @@ static void createDummyPages(BM_BufferPool *bm, int num);
 
 static void testLRU_K (void);
 
+static void testLRU_K2 (void);
+
+static void testLFU (void);
+
+static void testARC (void);
+
+static void test2Q (void);
+
+static void testCLOCK (void);
+
 static void testError (void);
 
+static void testMultiplePools (void);
+
+static void testConcurrentPins (void);
+static void testConcurrentHits (void);
+static void testPoolFileHandle (void);
+static void testPageCleaner (void);
+static void testBatchedFlush (void);
+static void testReadAhead (void);
+static void testAsyncPins (void);
+static void testFrameArena (void);
+static void testDirectIO (void);
+static void testMappedFrames (void);
+static void testBatchPins (void);
+static void testScanResistance (void);
+static void testPoolStats (void);
+static void testLatencyHistograms (void);
+static void testPinTrace (void);
+static void testResizePool (void);
+static void testSharedPool (void);
+static void testWarmRestart (void);
+static void testAsyncPinJoinsRead (void);
+static void testFailedReads (void);
+static void testFailedWrites (void);
+static void testTraceReplay (void);
+
 // main method
 int
 main (void)
@@ -43,7 +87,35 @@ main (void)
     testName = "";
     
     testLRU_K();
+    testLRU_K2();
+    testLFU();
+    testARC();
+    test2Q();
+    testCLOCK();
     testError();
+    testMultiplePools();
+    testConcurrentPins();
+    testConcurrentHits();
+    testPoolFileHandle();
+    testPageCleaner();
+    testBatchedFlush();
+    testReadAhead();
+    testAsyncPins();
+    testFrameArena();
+    testDirectIO();
+    testMappedFrames();
+    testBatchPins();
+    testScanResistance();
+    testPoolStats();
+    testLatencyHistograms();
+    testPinTrace();
+    testResizePool();
+    testSharedPool();
+    testWarmRestart();
+    testAsyncPinJoinsRead();
+    testFailedReads();
+    testFailedWrites();
+    testTraceReplay();
     return 0;
 }
 
@@ -144,6 +216,305 @@ testLRU_K (void)
 }
 
 
+// test the CLOCK page replacement strategy
+void
+testLRU_K2 (void)
+{
+    // expected results
+    const char *poolContents[] = {
+        // pages 0 and 1 are referenced twice, page 2 only once
+        "[0 0],[1 0],[2 0]",
+        // pages with fewer than K references are evicted first
+        "[0 0],[1 0],[3 0]",
+        "[0 0],[1 0],[4 0]",
+        // page 2 kept its history while evicted and now has two references
+        "[0 0],[1 0],[2 0]",
+        // page 0 has the oldest second-to-last reference
+        "[5 0],[1 0],[2 0]"
+    };
+    const int warmupRequests[] = {0,0,1,1,2};
+    const int replaceRequests[] = {3,4,2,5};
+    int k = 2;
+
+    int i;
+    int snapshot = 0;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing LRU_K page replacement with K = 2";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 100);
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU_K, &k));
+
+    for(i = 0; i < 5; i++)
+    {
+        pinPage(bm, h, warmupRequests[i]);
+        unpinPage(bm, h);
+    }
+    ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content after warm-up");
+
+    // replace pages and check that it happens in backward K-distance order
+    for(i = 0; i < 4; i++)
+    {
+        pinPage(bm, h, replaceRequests[i]);
+        unpinPage(bm, h);
+        ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content using pages");
+    }
+
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+    ASSERT_EQUALS_INT(7, getNumReadIO(bm), "check number of read I/Os");
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+void
+testLFU (void)
+{
+    // expected results
+    const char *poolContents[] = {
+        // page 0 is referenced three times, page 1 twice and page 2 once
+        "[0 0],[1 0],[2 0]",
+        "[0 0],[1 0],[3 0]",
+        // page 3 stays pinned and is skipped, page 1 is the least frequently used unpinned page
+        "[0 0],[1 0],[3 1]",
+        "[0 0],[4 0],[3 1]",
+        // with aging, page 0 loses its early lead and gets evicted
+        "[0 0],[1 0],[2 0]",
+        "[0 0],[3 0],[2 0]",
+        "[0 0],[3 0],[2 0]",
+        "[4 0],[3 0],[2 0]"
+    };
+    const int warmupRequests[] = {0,0,0,1,1,2,3};
+    const int agingRequests[] = {0,0,0,0,1,1,2,2};
+    const int agingReplaceRequests[] = {3,3,4};
+    int agingPeriod = 6;
+
+    int i;
+    int snapshot = 0;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+    testName = "Testing LFU page replacement";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 100);
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LFU, NULL));
+
+    for(i = 0; i < 7; i++)
+    {
+        pinPage(bm, h, warmupRequests[i]);
+        unpinPage(bm, h);
+        if (i >= 5)
+            ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content using pages");
+    }
+
+    // keep page 3 pinned while a new page is read
+    pinPage(bm, pinned, 3);
+    ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content with a pinned page");
+    pinPage(bm, h, 4);
+    unpinPage(bm, h);
+    ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check that the pinned page was skipped");
+    unpinPage(bm, pinned);
+
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+    ASSERT_EQUALS_INT(5, getNumReadIO(bm), "check number of read I/Os");
+    CHECK(shutdownBufferPool(bm));
+
+    // halve all frequencies every six references
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LFU, &agingPeriod));
+    for(i = 0; i < 8; i++)
+    {
+        pinPage(bm, h, agingRequests[i]);
+        unpinPage(bm, h);
+    }
+    ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content after warm-up");
+
+    for(i = 0; i < 3; i++)
+    {
+        pinPage(bm, h, agingReplaceRequests[i]);
+        unpinPage(bm, h);
+        ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content with aging");
+    }
+
+    ASSERT_EQUALS_INT(5, getNumReadIO(bm), "check number of read I/Os");
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(bm);
+    free(h);
+    free(pinned);
+    TEST_DONE();
+}
+
+void
+testARC (void)
+{
+    // expected results
+    const char *poolContents[] = {
+        // page 0 is referenced twice and moves to T2, pages 1 and 2 stay in T1
+        "[0 0],[1 0],[2 0]",
+        // T1 is above its target, so its oldest page 1 goes to the ghost list B1
+        "[0 0],[3 0],[2 0]",
+        // hit in B1: the target of T1 grows and page 1 comes back into T2
+        "[0 0],[3 0],[1 0]",
+        // T1 is at its target, so the oldest page of T2 is evicted into B2
+        "[4 0],[3 0],[1 0]",
+        // hit in B2: the target of T1 shrinks again and T1 gives up page 3
+        "[4 0],[0 0],[1 0]"
+    };
+    const int warmupRequests[] = {0,1,2,0};
+    const int replaceRequests[] = {3,1,4,0};
+
+    int i;
+    int snapshot = 0;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing ARC page replacement";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 100);
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_ARC, NULL));
+
+    for(i = 0; i < 4; i++)
+    {
+        pinPage(bm, h, warmupRequests[i]);
+        unpinPage(bm, h);
+    }
+    ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content after warm-up");
+
+    for(i = 0; i < 4; i++)
+    {
+        pinPage(bm, h, replaceRequests[i]);
+        unpinPage(bm, h);
+        ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content using pages");
+    }
+
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+    ASSERT_EQUALS_INT(7, getNumReadIO(bm), "check number of read I/Os");
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+void
+test2Q (void)
+{
+    // expected results
+    const char *poolContents[] = {
+        "[0 0],[1 0],[2 0],[3 0]",
+        // A1in is over its target, its oldest page 0 is remembered in A1out
+        "[4 0],[1 0],[2 0],[3 0]",
+        // hit in A1out: page 0 comes back into Am
+        "[4 0],[0 0],[2 0],[3 0]",
+        "[4 0],[0 0],[5 0],[3 0]",
+        "[4 0],[0 0],[5 0],[3 0]",
+        // further new pages only replace pages of A1in, page 0 stays
+        "[4 0],[0 0],[5 0],[6 0]",
+        "[7 0],[0 0],[5 0],[6 0]"
+    };
+    const int warmupRequests[] = {0,1,2,3};
+    const int replaceRequests[] = {4,0,5,0,6,7};
+
+    int i;
+    int snapshot = 0;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing 2Q page replacement";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 100);
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_2Q, NULL));
+
+    for(i = 0; i < 4; i++)
+    {
+        pinPage(bm, h, warmupRequests[i]);
+        unpinPage(bm, h);
+    }
+    ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content after warm-up");
+
+    for(i = 0; i < 6; i++)
+    {
+        pinPage(bm, h, replaceRequests[i]);
+        unpinPage(bm, h);
+        ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content using pages");
+    }
+
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+    ASSERT_EQUALS_INT(9, getNumReadIO(bm), "check number of read I/Os");
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+void
+testCLOCK (void)
+{
+    // expected results
+    const char *poolContents[] = {
+        // read first three pages and directly unpin them
+        "[0 0],[-1 0],[-1 0]",
+        "[0 0],[1 0],[-1 0]",
+        "[0 0],[1 0],[2 0]",
+        // first replacement clears every reference bit and takes frame 0
+        "[3 0],[1 0],[2 0]",
+        // hit on page 1 gives it a second chance
+        "[3 0],[1 0],[2 0]",
+        "[3 0],[1 0],[4 0]",
+        "[3 0],[5 0],[4 0]"
+    };
+    const int requests[] = {0,1,2,3,1,4,5};
+    
+    int i;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing CLOCK page replacement";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 100);
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_CLOCK, NULL));
+    
+    for(i = 0; i < 7; i++)
+    {
+        pinPage(bm, h, requests[i]);
+        unpinPage(bm, h);
+        ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+    }
+    
+    // the clock hand has to skip the pinned frame
+    CHECK(pinPage(bm, h, 4));
+    CHECK(pinPage(bm, h, 6));
+    ASSERT_EQUALS_STRING("Page-6", h->data, "reading page through the clock");
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_POOL("[6 0],[5 0],[4 1]", bm, "pinned frame is not replaced");
+    
+    h->pageNum = 4;
+    CHECK(unpinPage(bm, h));
+    
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+    ASSERT_EQUALS_INT(7, getNumReadIO(bm), "check number of read I/Os");
+    
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
 // test error cases
 void
 testError (void)
@@ -191,3 +562,1959 @@ testError (void)
     free(h);
     TEST_DONE();
 }
+
+
+// test that two open buffer pools keep their own frames and counters
+void
+testMultiplePools (void)
+{
+    BM_BufferPool *hot = MAKE_POOL();
+    BM_BufferPool *cold = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    int i;
+    testName = "Testing independent buffer pools";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(hot, 10);
+    CHECK(createPageFile("testbuffer2.bin"));
+    
+    CHECK(initBufferPool(hot, "testbuffer.bin", 3, RS_LRU, NULL));
+    CHECK(initBufferPool(cold, "testbuffer2.bin", 2, RS_FIFO, NULL));
+    
+    // fill both pools, each from its own page file
+    for(i = 0; i < 3; i++)
+    {
+        CHECK(pinPage(hot, h, i));
+        CHECK(unpinPage(hot, h));
+    }
+    CHECK(pinPage(cold, h, 0));
+    CHECK(markDirty(cold, h));
+    CHECK(unpinPage(cold, h));
+    
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0]", hot, "hot pool content");
+    ASSERT_EQUALS_POOL("[0x0],[-1 0]", cold, "cold pool content");
+    
+    // a hit in one pool must not be answered by the other one
+    CHECK(pinPage(hot, h, 1));
+    ASSERT_EQUALS_STRING("Page-1", h->data, "hot pool reads its own page file");
+    CHECK(unpinPage(hot, h));
+    
+    ASSERT_EQUALS_INT(3, getNumReadIO(hot), "hot pool read I/Os");
+    ASSERT_EQUALS_INT(1, getNumReadIO(cold), "cold pool read I/Os");
+    ASSERT_EQUALS_INT(0, getNumWriteIO(hot), "hot pool write I/Os");
+    ASSERT_EQUALS_INT(0, getNumWriteIO(cold), "cold pool has not written its dirty page yet");
+    CHECK(forceFlushPool(cold));
+    ASSERT_EQUALS_INT(1, getNumWriteIO(cold), "cold pool write I/Os");
+    
+    CHECK(shutdownBufferPool(cold));
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0]", hot, "hot pool survives shutdown of the other pool");
+    CHECK(shutdownBufferPool(hot));
+    
+    CHECK(destroyPageFile("testbuffer.bin"));
+    CHECK(destroyPageFile("testbuffer2.bin"));
+    
+    free(hot);
+    free(cold);
+    free(h);
+    TEST_DONE();
+}
+
+// work of one thread in testConcurrentPins
+typedef struct PinWorker
+{
+    BM_BufferPool *bm;
+    unsigned int seed;
+    int failedPins;
+    int wrongContents;
+} PinWorker;
+
+static void *
+pinRandomPages (void *arg)
+{
+    PinWorker *worker = (PinWorker *) arg;
+    BM_PageHandle h;
+    char expected[PAGE_SIZE];
+    int i;
+
+    for(i = 0; i < 2000; i++)
+    {
+        int pageNum = rand_r(&worker->seed) % 40;
+
+        if (pinPage(worker->bm, &h, pageNum) != RC_OK)
+        {
+            worker->failedPins++;
+            continue;
+        }
+        sprintf(expected, "%s-%i", "Page", pageNum);
+        if (h.pageNum != pageNum || strcmp(h.data, expected) != 0)
+            worker->wrongContents++;
+
+        // dirty pages without changing them, so evictions write back while others read
+        if (i % 7 == 0)
+            markDirty(worker->bm, &h);
+        unpinPage(worker->bm, &h);
+    }
+    return NULL;
+}
+
+void
+testConcurrentPins (void)
+{
+    const ReplacementStrategy strategies[] = {RS_CLOCK, RS_LRU, RS_LFU, RS_ARC};
+    const int numThreads = 4;
+    pthread_t threads[4];
+    PinWorker workers[4];
+    int s, i;
+    BM_BufferPool *bm = MAKE_POOL();
+    testName = "Testing concurrent pins from several threads";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 40);
+
+    for(s = 0; s < 4; s++)
+    {
+        CHECK(initBufferPool(bm, "testbuffer.bin", 8, strategies[s], NULL));
+
+        for(i = 0; i < numThreads; i++)
+        {
+            workers[i].bm = bm;
+            workers[i].seed = 17 * (s + 1) + i;
+            workers[i].failedPins = 0;
+            workers[i].wrongContents = 0;
+            pthread_create(&threads[i], NULL, pinRandomPages, &workers[i]);
+        }
+        for(i = 0; i < numThreads; i++)
+        {
+            pthread_join(threads[i], NULL);
+            ASSERT_EQUALS_INT(0, workers[i].failedPins, "every pin finds a frame");
+            ASSERT_EQUALS_INT(0, workers[i].wrongContents, "pinned pages hold their own content");
+        }
+
+        int *fixCounts = getFixCounts(bm);
+        for(i = 0; i < 8; i++)
+            ASSERT_EQUALS_INT(0, fixCounts[i], "all pins are released");
+        free(fixCounts);
+
+        CHECK(shutdownBufferPool(bm));
+    }
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(bm);
+    TEST_DONE();
+}
+
+// pins only pages that are resident, so every pin takes the latch-free hit path
+static void *
+pinResidentPages (void *arg)
+{
+    PinWorker *worker = (PinWorker *) arg;
+    BM_PageHandle h;
+    char expected[PAGE_SIZE];
+    int i;
+
+    for(i = 0; i < 5000; i++)
+    {
+        int pageNum = rand_r(&worker->seed) % 10;
+
+        if (pinPage(worker->bm, &h, pageNum) != RC_OK)
+        {
+            worker->failedPins++;
+            continue;
+        }
+        sprintf(expected, "%s-%i", "Page", pageNum);
+        if (strcmp(h.data, expected) != 0)
+            worker->wrongContents++;
+        unpinPage(worker->bm, &h);
+    }
+    return NULL;
+}
+
+void
+testConcurrentHits (void)
+{
+    pthread_t threads[4];
+    PinWorker workers[4];
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    int i;
+    BM_BufferPool *bm = MAKE_POOL();
+    testName = "Testing concurrent hits on resident pages";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+    CHECK(initBufferPool(bm, "testbuffer.bin", 10, RS_CLOCK, NULL));
+
+    for(i = 0; i < 10; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(unpinPage(bm, h));
+    }
+
+    for(i = 0; i < 4; i++)
+    {
+        workers[i].bm = bm;
+        workers[i].seed = 101 + i;
+        workers[i].failedPins = 0;
+        workers[i].wrongContents = 0;
+        pthread_create(&threads[i], NULL, pinResidentPages, &workers[i]);
+    }
+    for(i = 0; i < 4; i++)
+    {
+        pthread_join(threads[i], NULL);
+        ASSERT_EQUALS_INT(0, workers[i].failedPins, "every pin is a hit");
+        ASSERT_EQUALS_INT(0, workers[i].wrongContents, "hits see the page content");
+    }
+
+    // hits never read from disk or give up a frame
+    ASSERT_EQUALS_INT(10, getNumReadIO(bm), "only the initial reads");
+    int *fixCounts = getFixCounts(bm);
+    for(i = 0; i < 10; i++)
+        ASSERT_EQUALS_INT(0, fixCounts[i], "all pins are released");
+    free(fixCounts);
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+// the pool keeps its page file open, forced pages must still be visible to other handles at once
+void
+testPoolFileHandle (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    SM_FileHandle fh;
+    char *onDisk = (char *) malloc(PAGE_SIZE);
+    int i;
+    testName = "Testing the file handle kept open by a buffer pool";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+    // a page past the end of the file reads as an empty page
+    CHECK(pinPage(bm, h, 5));
+    for(i = 0; i < PAGE_SIZE; i++)
+        if (h->data[i] != 0)
+            break;
+    ASSERT_EQUALS_INT(PAGE_SIZE, i, "new page is zeroed");
+
+    sprintf(h->data, "%s-%i", "Page", 5);
+    CHECK(markDirty(bm, h));
+    CHECK(forcePage(bm, h));
+    CHECK(unpinPage(bm, h));
+
+    // read the page through a separate handle while the pool is still open
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    ASSERT_EQUALS_INT(6, fh.totalNumPages, "file grew to the forced page");
+    CHECK(readBlock(5, &fh, onDisk));
+    ASSERT_EQUALS_STRING("Page-5", onDisk, "forced page is on disk");
+    CHECK(closePageFile(&fh));
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(onDisk);
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+static int
+countDirtyFrames (BM_BufferPool *bm)
+{
+    bool *dirty = getDirtyFlags(bm);
+    int i, count = 0;
+
+    for(i = 0; i < bm->numPages; i++)
+        count += dirty[i] ? 1 : 0;
+    free(dirty);
+    return count;
+}
+
+// the cleaner writes dirty pages back in the background once the high watermark is reached
+void
+testPageCleaner (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    SM_FileHandle fh;
+    char *onDisk = (char *) malloc(PAGE_SIZE);
+    char expected[PAGE_SIZE];
+    int i, waited;
+    testName = "Testing the background page cleaner";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 10, RS_FIFO, NULL));
+
+    ASSERT_TRUE((stopPageCleaner(bm) != RC_OK), "no cleaner to stop");
+    ASSERT_TRUE((startPageCleaner(bm, 4, 4) != RC_OK), "low watermark must be below the high one");
+    ASSERT_TRUE((startPageCleaner(bm, 11, 1) != RC_OK), "high watermark must fit the pool");
+    CHECK(startPageCleaner(bm, 4, 1));
+    ASSERT_TRUE((startPageCleaner(bm, 4, 1) != RC_OK), "only one cleaner per pool");
+
+    for(i = 0; i < 10; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "%s-%i", "Clean", i);
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+
+    // give the cleaner up to five seconds to get below the high watermark
+    for(waited = 0; waited < 500 && countDirtyFrames(bm) >= 4; waited++)
+        usleep(10000);
+    ASSERT_TRUE((countDirtyFrames(bm) < 4), "cleaner keeps the pool below the high watermark");
+
+    // every page that is clean again has reached the file
+    bool *dirty = getDirtyFlags(bm);
+    PageNumber *contents = getFrameContents(bm);
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    for(i = 0; i < 10; i++)
+    {
+        if (dirty[i])
+            continue;
+        CHECK(readBlock(contents[i], &fh, onDisk));
+        sprintf(expected, "%s-%i", "Clean", contents[i]);
+        ASSERT_EQUALS_STRING(expected, onDisk, "cleaned page is on disk");
+    }
+    CHECK(closePageFile(&fh));
+    free(dirty);
+    free(contents);
+
+    CHECK(stopPageCleaner(bm));
+    CHECK(startPageCleaner(bm, 2, 0));
+
+    // shutting down stops a running cleaner
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(onDisk);
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+// forceFlushPool writes runs of consecutive dirty pages with one call each
+void
+testBatchedFlush (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    SM_FileHandle fh;
+    char *onDisk = (char *) malloc(PAGE_SIZE);
+    char expected[PAGE_SIZE];
+    const int dirtyPages[] = {8, 2, 7, 5, 1, 3};
+    int i;
+    testName = "Testing sorted and coalesced flushing";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+    CHECK(initBufferPool(bm, "testbuffer.bin", 10, RS_LRU, NULL));
+
+    // load pages in reverse order, so frame order and page order differ
+    for(i = 9; i >= 0; i--)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(unpinPage(bm, h));
+    }
+    for(i = 0; i < 6; i++)
+    {
+        CHECK(pinPage(bm, h, dirtyPages[i]));
+        sprintf(h->data, "%s-%i", "Flushed", dirtyPages[i]);
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    // a pinned dirty page stays in the pool
+    CHECK(pinPage(bm, h, 9));
+    CHECK(markDirty(bm, h));
+
+    CHECK(forceFlushPool(bm));
+    ASSERT_EQUALS_INT(6, getLastFlushPageCount(bm), "unpinned dirty pages flushed");
+    ASSERT_EQUALS_INT(3, getLastFlushWriteCalls(bm), "runs 1-3, 5 and 7-8");
+    ASSERT_EQUALS_POOL("[9x1],[8 0],[7 0],[6 0],[5 0],[4 0],[3 0],[2 0],[1 0],[0 0]", bm, "only the pinned page is still dirty");
+
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    for(i = 0; i < 6; i++)
+    {
+        CHECK(readBlock(dirtyPages[i], &fh, onDisk));
+        sprintf(expected, "%s-%i", "Flushed", dirtyPages[i]);
+        ASSERT_EQUALS_STRING(expected, onDisk, "flushed page is on disk");
+    }
+    CHECK(readBlock(4, &fh, onDisk));
+    ASSERT_EQUALS_STRING("Page-4", onDisk, "page between runs is untouched");
+    CHECK(closePageFile(&fh));
+
+    CHECK(forceFlushPool(bm));
+    ASSERT_EQUALS_INT(0, getLastFlushPageCount(bm), "nothing left to flush");
+    ASSERT_EQUALS_INT(0, getLastFlushWriteCalls(bm), "no write calls");
+
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+    ASSERT_EQUALS_INT(0, getLastFlushPageCount(bm), "no flush count after shutdown");
+    ASSERT_EQUALS_INT(0, getLastFlushWriteCalls(bm), "no write calls after shutdown");
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(onDisk);
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+static int
+countResidentPages (BM_BufferPool *bm)
+{
+    PageNumber *contents = getFrameContents(bm);
+    int i, count = 0;
+
+    for(i = 0; i < bm->numPages; i++)
+        count += (contents[i] != NO_PAGE) ? 1 : 0;
+    free(contents);
+    return count;
+}
+
+// sequential pins read the following pages ahead, random ones do not
+void
+testReadAhead (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    SM_FileHandle fh;
+    char expected[PAGE_SIZE];
+    int i, wrongContents = 0;
+    testName = "Testing sequential read-ahead";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 100);
+
+    // random pins only read what is asked for
+    CHECK(initBufferPool(bm, "testbuffer.bin", 64, RS_LRU, NULL));
+    CHECK(pinPage(bm, h, 50));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, 10));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, 70));
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_INT(3, countResidentPages(bm), "no read-ahead without a scan");
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 64, RS_LRU, NULL));
+
+    // the second sequential miss reads the first window (4 pages) ahead
+    CHECK(pinPage(bm, h, 0));
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_INT(1, countResidentPages(bm), "one miss is not a scan yet");
+    CHECK(pinPage(bm, h, 1));
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_INT(6, countResidentPages(bm), "pages 2-5 read ahead");
+
+    // reaching the first page of the window reads the next, twice as large window
+    CHECK(pinPage(bm, h, 2));
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_INT(14, countResidentPages(bm), "pages 6-13 read ahead");
+
+    // the rest of the scan sees the right pages and reads every page exactly once
+    for(i = 3; i < 100; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(expected, "%s-%i", "Page", i);
+        if (strcmp(h->data, expected) != 0)
+            wrongContents++;
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_INT(0, wrongContents, "read-ahead pages hold their content");
+    ASSERT_EQUALS_INT(100, getNumReadIO(bm), "each page read once");
+    CHECK(shutdownBufferPool(bm));
+
+    // read-ahead stops at the end of the file
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    ASSERT_EQUALS_INT(100, fh.totalNumPages, "file did not grow");
+    CHECK(closePageFile(&fh));
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+// counts the completed pins through the request context
+static void
+countCompletion (BM_PinRequest *request)
+{
+    (*(int *) request->context)++;
+}
+
+// asynchronous pins complete through pollPinCompletions, pins of the same page share one read
+void
+testAsyncPins (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle h[5];
+    BM_PinRequest req[5];
+    BM_PageHandle *extra = MAKE_PAGE_HANDLE();
+    BM_PinRequest extraReq;
+    PageNumber pages[5] = {0, 1, 2, 1, 1};
+    char expected[PAGE_SIZE];
+    int i, completed = 0, callbacks = 0, wrongContents = 0;
+    testName = "Testing asynchronous pins";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+    completed = pollPinCompletions(bm, true);
+    ASSERT_EQUALS_INT(0, completed, "nothing to wait for");
+
+    // page 1 is pinned three times while its read may still be in flight
+    completed = 0;
+    for(i = 0; i < 5; i++)
+    {
+        req[i].callback = countCompletion;
+        req[i].context = &callbacks;
+        CHECK(pinPageAsync(bm, &h[i], pages[i], &req[i]));
+    }
+    while (completed < 5)
+        completed += pollPinCompletions(bm, true);
+
+    for(i = 0; i < 5; i++)
+    {
+        ASSERT_TRUE(req[i].completed, "request completed");
+        ASSERT_EQUALS_INT(RC_OK, req[i].rc, "request succeeded");
+        ASSERT_EQUALS_INT(pages[i], h[i].pageNum, "handle filled in");
+        sprintf(expected, "%s-%i", "Page", pages[i]);
+        if (strcmp(h[i].data, expected) != 0)
+            wrongContents++;
+    }
+    ASSERT_EQUALS_INT(0, wrongContents, "pinned pages hold their content");
+    ASSERT_EQUALS_INT(5, callbacks, "every callback ran once");
+    ASSERT_EQUALS_INT(3, getNumReadIO(bm), "shared reads of page 1");
+    ASSERT_EQUALS_POOL("[0 1],[1 3],[2 1]", bm, "fix counts of the async pins");
+
+    // every frame is pinned, the next miss fails right away
+    extraReq.callback = NULL;
+    ASSERT_ERROR(pinPageAsync(bm, extra, 5, &extraReq), "no frame for an async miss");
+    completed = pollPinCompletions(bm, false);
+    ASSERT_EQUALS_INT(0, completed, "failed pin is not handed back");
+
+    // a hit completes without a read, async pins are released with unpinPage
+    extraReq.context = NULL;
+    CHECK(pinPageAsync(bm, extra, 2, &extraReq));
+    completed = pollPinCompletions(bm, true);
+    ASSERT_EQUALS_INT(1, completed, "hit handed back");
+    ASSERT_EQUALS_INT(3, getNumReadIO(bm), "hit needs no read");
+    CHECK(unpinPage(bm, extra));
+    for(i = 0; i < 5; i++)
+        CHECK(unpinPage(bm, &h[i]));
+
+    // a miss that has to evict
+    CHECK(pinPageAsync(bm, extra, 7, &extraReq));
+    completed = pollPinCompletions(bm, true);
+    ASSERT_EQUALS_INT(1, completed, "miss handed back");
+    ASSERT_EQUALS_STRING("Page-7", extra->data, "evicting miss holds its content");
+    CHECK(unpinPage(bm, extra));
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(extra);
+    free(bm);
+    TEST_DONE();
+}
+
+// frames hand out page-aligned slots of one contiguous arena
+void
+testFrameArena (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle h[3];
+    int i, misaligned = 0;
+    testName = "Testing the frame arena";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 3);
+
+    // 600 frames make an arena above 2 MB, which tries huge pages first
+    CHECK(initBufferPool(bm, "testbuffer.bin", 600, RS_FIFO, NULL));
+    for(i = 0; i < 3; i++)
+    {
+        CHECK(pinPage(bm, &h[i], i));
+        if ((uintptr_t) h[i].data % PAGE_SIZE != 0)
+            misaligned++;
+    }
+    ASSERT_EQUALS_INT(0, misaligned, "frame data is page aligned");
+    ASSERT_EQUALS_INT(PAGE_SIZE, (int) (h[1].data - h[0].data), "frames 0 and 1 are neighbours");
+    ASSERT_EQUALS_INT(PAGE_SIZE, (int) (h[2].data - h[1].data), "frames 1 and 2 are neighbours");
+    ASSERT_EQUALS_STRING("Page-2", h[2].data, "arena frames hold their pages");
+    for(i = 0; i < 3; i++)
+        CHECK(unpinPage(bm, &h[i]));
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(bm);
+    TEST_DONE();
+}
+
+// a pool with direct I/O reads and writes the same pages as one going through the page cache
+void
+testDirectIO (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    SM_FileHandle fh;
+    char expected[PAGE_SIZE];
+    char *aligned;
+    char *unaligned = (char *) malloc(PAGE_SIZE + 1);
+    int i, wrongContents = 0;
+    testName = "Testing direct I/O";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 20);
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+    // file systems without O_DIRECT (tmpfs) keep the pool on the page cache
+    if (enableDirectIO(bm) != RC_OK)
+        printf("[%s] direct I/O not supported here, testing the fallback\n", testName);
+
+    // every page is read and written back through the pool, evictions write directly
+    for(i = 0; i < 20; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(expected, "%s-%i", "Page", i);
+        if (strcmp(h->data, expected) != 0)
+            wrongContents++;
+        sprintf(h->data, "%s-%i", "Direct", i);
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_INT(0, wrongContents, "pages read directly");
+    CHECK(forceFlushPool(bm));
+    ASSERT_EQUALS_INT(20, getNumWriteIO(bm), "every page written once");
+
+    // a page past the end of the file still reads as empty
+    CHECK(pinPage(bm, h, 25));
+    ASSERT_EQUALS_INT(0, h->data[0], "new page is zeroed");
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+
+    // direct and buffered handles see the same file
+    ASSERT_EQUALS_INT(0, posix_memalign((void **) &aligned, PAGE_SIZE, PAGE_SIZE), "aligned buffer");
+    if (openPageFileDirect("testbuffer.bin", &fh) != RC_OK)
+        CHECK(openPageFile("testbuffer.bin", &fh));
+    CHECK(readBlock(7, &fh, aligned));
+    ASSERT_EQUALS_STRING("Direct-7", aligned, "aligned read");
+    CHECK(readBlock(8, &fh, unaligned + 1));
+    ASSERT_EQUALS_STRING("Direct-8", unaligned + 1, "unaligned read falls back to stdio");
+    sprintf(aligned, "%s-%i", "Again", 9);
+    CHECK(writeBlock(9, &fh, aligned));
+    CHECK(readBlock(9, &fh, unaligned + 1));
+    ASSERT_EQUALS_STRING("Again-9", unaligned + 1, "buffered read sees the direct write");
+
+    // a failing direct descriptor reports an error instead of an empty page
+    if (fh.directFd >= 0)
+        close(fh.directFd);
+    fh.directFd = open("testbuffer.bin", O_WRONLY);
+    ASSERT_ERROR(readBlock(7, &fh, aligned), "failed direct read");
+    ASSERT_ERROR(readBlocks(7, 1, &fh, &aligned), "failed direct multi-page read");
+    CHECK(closePageFile(&fh));
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(aligned);
+    free(unaligned);
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+// mapped frames point into the page file instead of holding a copy of their page
+void
+testMappedFrames (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *h2 = MAKE_PAGE_HANDLE();
+    SM_FileHandle fh;
+    SM_PageHandle mapped;
+    int i;
+    testName = "Testing memory-mapped frames";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+
+    // the storage manager hands out pointers into the mapping and maps appended pages in place
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    CHECK(mapPageFile(&fh));
+    CHECK(readBlockMapped(4, &fh, &mapped));
+    ASSERT_EQUALS_STRING("Page-4", mapped, "page read through the mapping");
+    ASSERT_ERROR(readBlockMapped(10, &fh, &mapped), "page past the end is not mapped");
+    CHECK(appendEmptyBlock(&fh));
+    CHECK(readBlockMapped(10, &fh, &mapped));
+    ASSERT_EQUALS_INT(0, mapped[0], "appended page is mapped and empty");
+    CHECK(readBlockMapped(4, &fh, &mapped));
+    ASSERT_EQUALS_STRING("Page-4", mapped, "growth keeps the mapping in place");
+    CHECK(closePageFile(&fh));
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+    CHECK(enableMappedFrames(bm));
+
+    // the frames of pages 7 and 2 lie as far apart as the pages do in the file
+    CHECK(pinPage(bm, h, 7));
+    CHECK(pinPage(bm, h2, 2));
+    ASSERT_EQUALS_STRING("Page-7", h->data, "mapped page 7");
+    ASSERT_EQUALS_STRING("Page-2", h2->data, "mapped page 2");
+    ASSERT_EQUALS_INT(5 * PAGE_SIZE, (int) (h->data - h2->data), "frames point into the file mapping");
+    CHECK(unpinPage(bm, h));
+
+    // a change marked dirty survives the eviction of the private copy
+    sprintf(h2->data, "%s-%i", "Mapped", 2);
+    CHECK(markDirty(bm, h2));
+    CHECK(unpinPage(bm, h2));
+    for(i = 3; i < 6; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(pinPage(bm, h2, 2));
+    ASSERT_EQUALS_STRING("Mapped-2", h2->data, "written page read back through the mapping");
+
+    // pages past the end of the file are mapped once the file grows
+    CHECK(pinPage(bm, h, 15));
+    ASSERT_EQUALS_INT(0, h->data[0], "new page is zeroed");
+    ASSERT_EQUALS_INT(13 * PAGE_SIZE, (int) (h->data - h2->data), "new page is mapped");
+    CHECK(unpinPage(bm, h));
+    CHECK(unpinPage(bm, h2));
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(h);
+    free(h2);
+    free(bm);
+    TEST_DONE();
+}
+
+// pinPages pins hits and misses of a batch together, all or nothing
+void
+testBatchPins (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle batch[9];
+    PageNumber pages[6] = {5, 6, 7, 1, 3, 6};
+    PageNumber tooMany[9] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+    char expected[PAGE_SIZE];
+    int i, wrongContents = 0, *fixCounts;
+    testName = "Testing batched pins";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_LRU, NULL));
+    CHECK(pinPage(bm, h, 1));
+    CHECK(unpinPage(bm, h));
+
+    // page 1 is a hit, 5, 6, 7 and 3 are read, 6 is pinned twice
+    CHECK(pinPages(bm, batch, pages, 6));
+    for(i = 0; i < 6; i++)
+    {
+        sprintf(expected, "%s-%i", "Page", pages[i]);
+        if (batch[i].pageNum != pages[i] || strcmp(batch[i].data, expected) != 0)
+            wrongContents++;
+    }
+    ASSERT_EQUALS_INT(0, wrongContents, "every handle holds its page");
+    ASSERT_EQUALS_INT(5, getNumReadIO(bm), "only the missing pages are read");
+    ASSERT_EQUALS_POOL("[1 1],[5 1],[6 2],[7 1],[3 1],[-1 0],[-1 0],[-1 0]", bm, "batch pinned in one go");
+    CHECK(unpinPages(bm, batch, 6));
+    ASSERT_EQUALS_POOL("[1 0],[5 0],[6 0],[7 0],[3 0],[-1 0],[-1 0],[-1 0]", bm, "batch unpinned");
+    ASSERT_ERROR(unpinPages(bm, batch, 1), "page is no longer pinned");
+
+    // a batch larger than the pool pins nothing
+    ASSERT_ERROR(pinPages(bm, batch, tooMany, 9), "more pages than frames");
+    fixCounts = getFixCounts(bm);
+    for(i = 0; i < 8; i++)
+        if (fixCounts[i] != 0)
+            wrongContents++;
+    free(fixCounts);
+    ASSERT_EQUALS_INT(0, wrongContents, "failed batch leaves nothing pinned");
+
+    CHECK(pinPages(bm, batch, pages, 0));
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+// reads of pages 0-5 after touching them three times, scanning pages 20-119 and touching them again
+static int
+hotSetRereads (ReplacementStrategy strategy, bool useRing)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_ScanHandle scan;
+    int i, round, readsBefore;
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 12, strategy, NULL));
+    for(round = 0; round < 3; round++)
+        for(i = 0; i < 6; i++)
+        {
+            CHECK(pinPage(bm, h, i));
+            CHECK(unpinPage(bm, h));
+        }
+
+    CHECK(beginScan(bm, &scan, 2));
+    for(i = 20; i < 120; i++)
+    {
+        if (useRing)
+        {
+            CHECK(pinPageForScan(bm, &scan, h, i));
+        }
+        else
+        {
+            CHECK(pinPage(bm, h, i));
+        }
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(endScan(bm, &scan));
+
+    readsBefore = getNumReadIO(bm);
+    for(i = 0; i < 6; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(unpinPage(bm, h));
+    }
+    readsBefore = getNumReadIO(bm) - readsBefore;
+
+    CHECK(shutdownBufferPool(bm));
+    free(h);
+    free(bm);
+    return readsBefore;
+}
+
+// a scan through its own ring leaves the hot set of every strategy resident
+void
+testScanResistance (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    ReplacementStrategy strategies[7] = {RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q};
+    int i, rereads;
+    testName = "Testing scan-resistant rings";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 120);
+
+    rereads = hotSetRereads(RS_LRU, false);
+    ASSERT_EQUALS_INT(6, rereads, "a plain scan flushes the LRU hot set");
+    rereads = hotSetRereads(RS_CLOCK, false);
+    ASSERT_EQUALS_INT(6, rereads, "a plain scan flushes the CLOCK hot set");
+
+    for(i = 0; i < 7; i++)
+    {
+        rereads = hotSetRereads(strategies[i], true);
+        ASSERT_EQUALS_INT(0, rereads, "hot set hit ratio survives a ring scan");
+    }
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(bm);
+    TEST_DONE();
+}
+
+// the pool counts hits, misses, evictions and the I/O that really reached the disk
+void
+testPoolStats (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle held[3];
+    BM_PoolStats stats;
+    char *summary;
+    int i;
+    testName = "Testing pool statistics";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+    // three misses, one hit and a dirty mark
+    for(i = 0; i < 3; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        if (i == 1)
+            CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(pinPage(bm, h, 0));
+    CHECK(unpinPage(bm, h));
+
+    // page 0 is evicted clean, page 1 dirty
+    CHECK(pinPage(bm, h, 3));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, 4));
+    CHECK(markDirty(bm, h));
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+
+    // every frame pinned, the next miss fails
+    for(i = 0; i < 3; i++)
+        CHECK(pinPage(bm, &held[i], i + 2));
+    ASSERT_ERROR(pinPage(bm, h, 5), "no frame left");
+    for(i = 0; i < 3; i++)
+        CHECK(unpinPage(bm, &held[i]));
+
+    CHECK(forceFlushPool(bm));
+
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(4, (int) stats.hits, "hits");
+    ASSERT_EQUALS_INT(5, (int) stats.misses, "misses");
+    ASSERT_EQUALS_INT(1, (int) stats.cleanEvictions, "clean evictions");
+    ASSERT_EQUALS_INT(1, (int) stats.dirtyEvictions, "dirty evictions");
+    ASSERT_EQUALS_INT(5, (int) stats.pagesRead, "pages read");
+    ASSERT_EQUALS_INT(5, (int) stats.readCalls, "read calls");
+    ASSERT_EQUALS_INT(5 * PAGE_SIZE, (int) stats.bytesRead, "bytes read");
+    ASSERT_EQUALS_INT(2, (int) stats.pagesWritten, "pages written, not dirty marks");
+    ASSERT_EQUALS_INT(2, (int) stats.writeCalls, "write calls");
+    ASSERT_EQUALS_INT(2 * PAGE_SIZE, (int) stats.bytesWritten, "bytes written");
+    ASSERT_EQUALS_INT(1, (int) stats.flushes, "flushes");
+    ASSERT_EQUALS_INT(1, (int) stats.pinFailures, "pin failures");
+    ASSERT_EQUALS_INT(2, getNumWriteIO(bm), "getNumWriteIO counts disk writes");
+    ASSERT_EQUALS_INT(5, getNumReadIO(bm), "getNumReadIO counts disk reads");
+
+    summary = sprintPoolStats(bm);
+    ASSERT_TRUE(strncmp(summary, "hits=4 misses=5 hitRatio=0.444", 30) == 0, "printable summary");
+    free(summary);
+
+    CHECK(shutdownBufferPool(bm));
+    ASSERT_ERROR(getPoolStats(bm, &stats), "no stats of a closed pool");
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+// latency histograms count every timed call once they are enabled, percentiles come out ordered
+void
+testLatencyHistograms (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_LatencyHistogram histogram;
+    long long p50, p99, p999;
+    char *summary;
+    int i;
+    testName = "Testing latency histograms";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+    // nothing is timed before the histograms are enabled
+    CHECK(pinPage(bm, h, 0));
+    CHECK(unpinPage(bm, h));
+    CHECK(getLatencyHistogram(bm, BM_LATENCY_PIN_MISS, &histogram));
+    ASSERT_EQUALS_INT(0, (int) histogram.count, "no misses timed while disabled");
+    ASSERT_EQUALS_INT(0, (int) latencyPercentile(&histogram, 50), "empty histogram");
+
+    CHECK(enableLatencyHistograms(bm));
+
+    // one hit, six misses, the last four evict a page, page 3 dirty
+    for(i = 0; i <= 6; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        if (i == 3)
+            CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(pinPage(bm, h, 6));
+    CHECK(markDirty(bm, h));
+    CHECK(forcePage(bm, h));
+    CHECK(unpinPage(bm, h));
+    CHECK(forceFlushPool(bm));
+
+    CHECK(getLatencyHistogram(bm, BM_LATENCY_PIN_HIT, &histogram));
+    ASSERT_EQUALS_INT(2, (int) histogram.count, "timed hits");
+    CHECK(getLatencyHistogram(bm, BM_LATENCY_VICTIM_SELECTION, &histogram));
+    ASSERT_EQUALS_INT(4, (int) histogram.count, "timed victim selections");
+    CHECK(getLatencyHistogram(bm, BM_LATENCY_EVICTION, &histogram));
+    ASSERT_EQUALS_INT(4, (int) histogram.count, "timed evictions, one of them dirty");
+    CHECK(getLatencyHistogram(bm, BM_LATENCY_FORCE_PAGE, &histogram));
+    ASSERT_EQUALS_INT(1, (int) histogram.count, "timed forcePage");
+    CHECK(getLatencyHistogram(bm, BM_LATENCY_FLUSH_POOL, &histogram));
+    ASSERT_EQUALS_INT(1, (int) histogram.count, "timed forceFlushPool");
+
+    CHECK(getLatencyHistogram(bm, BM_LATENCY_PIN_MISS, &histogram));
+    ASSERT_EQUALS_INT(6, (int) histogram.count, "timed misses");
+    p50 = latencyPercentile(&histogram, 50);
+    p99 = latencyPercentile(&histogram, 99);
+    p999 = latencyPercentile(&histogram, 99.9);
+    ASSERT_TRUE(p50 > 0 && p50 <= p99 && p99 <= p999 && p999 <= histogram.maxNanos, "ordered miss percentiles");
+    ASSERT_TRUE(histogram.sumNanos >= histogram.maxNanos, "sum covers the slowest miss");
+
+    summary = sprintLatencyHistograms(bm);
+    ASSERT_TRUE(strncmp(summary, "pinHit count=2 ", 15) == 0, "printable histograms");
+    free(summary);
+
+    ASSERT_ERROR(getLatencyHistogram(bm, BM_NUM_LATENCY_KINDS, &histogram), "unknown histogram");
+
+    // 90 calls of 2 ns and 10 slow ones: the median is exact, the tail never exceeds the maximum
+    memset(&histogram, 0, sizeof(histogram));
+    histogram.buckets[2] = 90;
+    histogram.buckets[40] = 10;
+    histogram.count = 100;
+    histogram.maxNanos = 1000;
+    ASSERT_EQUALS_INT(2, (int) latencyPercentile(&histogram, 50), "p50 of a synthetic histogram");
+    ASSERT_EQUALS_INT(2, (int) latencyPercentile(&histogram, 90), "p90 of a synthetic histogram");
+    ASSERT_EQUALS_INT(1000, (int) latencyPercentile(&histogram, 99), "p99 capped by the maximum");
+
+    // the last bucket ends past 32 bits of nanoseconds
+    memset(&histogram, 0, sizeof(histogram));
+    histogram.buckets[BM_LATENCY_BUCKETS - 1] = 1;
+    histogram.count = 1;
+    histogram.maxNanos = 1LL << 41;
+    p50 = latencyPercentile(&histogram, 50);
+    ASSERT_TRUE(p50 == (1LL << 40) - 1, "p50 in the last bucket");
+
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+// a pin trace holds the pins, unpins and dirty marks of the pool in order
+void
+testPinTrace (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_TraceRecord records[8];
+    char magic[8];
+    FILE *file;
+    int numRecords;
+    int expectedPages[] = { 1, 1, 1, 4, 4 };
+    int expectedOperations[] = { BM_TRACE_PIN, BM_TRACE_MARK_DIRTY, BM_TRACE_UNPIN, BM_TRACE_PIN, BM_TRACE_UNPIN };
+    int i;
+    testName = "Testing pin trace recording";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+    CHECK(pinPage(bm, h, 0));
+    CHECK(unpinPage(bm, h));
+
+    CHECK(startPinTrace(bm, "testtrace.bin"));
+    ASSERT_ERROR(startPinTrace(bm, "testtrace.bin"), "one trace per pool");
+    CHECK(pinPage(bm, h, 1));
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, 4));
+    CHECK(unpinPage(bm, h));
+    CHECK(stopPinTrace(bm));
+    ASSERT_ERROR(stopPinTrace(bm), "no trace running");
+
+    // nothing is recorded after the trace stopped
+    CHECK(pinPage(bm, h, 2));
+    CHECK(unpinPage(bm, h));
+
+    file = fopen("testtrace.bin", "rb");
+    ASSERT_TRUE(file != NULL, "trace file written");
+    ASSERT_TRUE(fread(magic, 1, 8, file) == 8 && memcmp(magic, BM_TRACE_MAGIC, 8) == 0, "trace header");
+    numRecords = (int) fread(records, sizeof(BM_TraceRecord), 8, file);
+    fclose(file);
+    ASSERT_EQUALS_INT(5, numRecords, "one record per call");
+    for(i = 0; i < 5 && i < numRecords; i++)
+    {
+        ASSERT_EQUALS_INT(expectedPages[i], records[i].pageNum, "traced page");
+        ASSERT_EQUALS_INT(expectedOperations[i], records[i].operation, "traced operation");
+        ASSERT_TRUE(i == 0 || records[i].timestamp >= records[i - 1].timestamp, "records in time order");
+    }
+
+    // shutdown closes a running trace
+    CHECK(startPinTrace(bm, "testtrace.bin"));
+    CHECK(pinPage(bm, h, 3));
+    CHECK(shutdownBufferPool(bm));
+    file = fopen("testtrace.bin", "rb");
+    ASSERT_TRUE(file != NULL, "trace file written on shutdown");
+    fseek(file, 0, SEEK_END);
+    ASSERT_EQUALS_INT(8 + (int) sizeof(BM_TraceRecord), (int) ftell(file), "header and one record");
+    fclose(file);
+
+    remove("testtrace.bin");
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+// pins the given pages one after the other and checks that each holds its own content
+static int
+countWrongPages (BM_BufferPool *bm, int firstPage, int numPages)
+{
+    BM_PageHandle h;
+    char expected[PAGE_SIZE];
+    int wrong = 0;
+    int i;
+
+    for(i = firstPage; i < firstPage + numPages; i++)
+    {
+        sprintf(expected, "%s-%i", "Page", i);
+        if (pinPage(bm, &h, i) != RC_OK || strcmp(h.data, expected) != 0)
+            wrong++;
+        else
+            unpinPage(bm, &h);
+    }
+    return wrong;
+}
+
+// counts the pages resident in more than one frame
+static int
+countDuplicatePages (BM_BufferPool *bm)
+{
+    PageNumber *contents = getFrameContents(bm);
+    int i, j, duplicates = 0;
+
+    for(i = 0; i < bm->numPages; i++)
+        for(j = 0; j < i; j++)
+            if (contents[i] != NO_PAGE && contents[j] == contents[i])
+                duplicates++;
+    free(contents);
+    return duplicates;
+}
+
+// resizes the pool over and over while pinRandomPages runs
+typedef struct ResizeWorker
+{
+    BM_BufferPool *bm;
+    int resizes;
+} ResizeWorker;
+
+static void *
+resizeRepeatedly (void *arg)
+{
+    ResizeWorker *worker = (ResizeWorker *) arg;
+    const int sizes[] = { 16, 6, 12, 7, 24, 8 };
+    int i;
+
+    for(i = 0; i < 60; i++)
+    {
+        // shrinks may stop early at pages the workers hold pinned
+        resizeBufferPool(worker->bm, sizes[i % 6]);
+        worker->resizes++;
+    }
+    return NULL;
+}
+
+// a live pool grows without touching its pages and shrinks by evicting and moving them
+void
+testResizePool (void)
+{
+    const ReplacementStrategy strategies[] = {RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q};
+    const ReplacementStrategy concurrentStrategies[] = {RS_LRU, RS_CLOCK, RS_LRU_K, RS_2Q};
+    const int sizes[] = { 16, 3, 12, 5, 9 };
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolStats stats;
+    pthread_t threads[4];
+    pthread_t resizer;
+    PinWorker workers[4];
+    ResizeWorker resizeWorker;
+    long misses;
+    int wrong, resident;
+    int k = 2;
+    int s, i;
+    testName = "Testing online resizing of a buffer pool";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 40);
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+    wrong = countWrongPages(bm, 0, 4);
+    ASSERT_EQUALS_INT(0, wrong, "pages 0-3 loaded");
+    ASSERT_ERROR(resizeBufferPool(bm, 0), "a pool needs frames");
+
+    // growing keeps the resident pages in their frames
+    CHECK(resizeBufferPool(bm, 8));
+    ASSERT_EQUALS_INT(8, bm->numPages, "grown pool size");
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[3 0],[-1 0],[-1 0],[-1 0],[-1 0]", bm, "resident pages stay in place");
+    CHECK(getPoolStats(bm, &stats));
+    misses = stats.misses;
+    wrong = countWrongPages(bm, 0, 4);
+    ASSERT_EQUALS_INT(0, wrong, "resident pages still hit");
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT((int) misses, (int) stats.misses, "no misses after growing");
+    wrong = countWrongPages(bm, 4, 4);
+    ASSERT_EQUALS_INT(0, wrong, "new frames take pages 4-7");
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[3 0],[4 0],[5 0],[6 0],[7 0]", bm, "every frame in use");
+
+    // page 6 is changed before it is moved, page 5 stays pinned across the shrink
+    CHECK(pinPage(bm, h, 6));
+    sprintf(h->data, "%s-%i", "Moved", 6);
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, 5));
+
+    // LRU evicts pages 0-4, page 5 keeps its frame and with it the pool at six frames
+    ASSERT_ERROR(resizeBufferPool(bm, 3), "pinned page past the new end");
+    ASSERT_EQUALS_INT(6, bm->numPages, "shrunk as far as the pinned page allows");
+    ASSERT_EQUALS_INT(3, countResidentPages(bm), "pages 5-7 left");
+    ASSERT_EQUALS_INT(0, countDuplicatePages(bm), "no page resident twice");
+    CHECK(unpinPage(bm, h));
+
+    CHECK(getPoolStats(bm, &stats));
+    misses = stats.misses;
+    CHECK(resizeBufferPool(bm, 3));
+    ASSERT_EQUALS_INT(3, bm->numPages, "shrunk pool size");
+    wrong = countWrongPages(bm, 5, 1);
+    ASSERT_EQUALS_INT(0, wrong, "page 5 moved down");
+    wrong = countWrongPages(bm, 7, 1);
+    ASSERT_EQUALS_INT(0, wrong, "page 7 moved down");
+    CHECK(pinPage(bm, h, 6));
+    ASSERT_EQUALS_STRING("Moved-6", h->data, "moved page keeps its changes");
+    CHECK(unpinPage(bm, h));
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT((int) misses, (int) stats.misses, "moved pages are not read again");
+    ASSERT_EQUALS_INT(3, countResidentPages(bm), "every frame in use");
+    ASSERT_EQUALS_INT(0, countDuplicatePages(bm), "no page resident twice");
+
+    // released frames come back when the pool grows again
+    CHECK(resizeBufferPool(bm, 8));
+    wrong = countWrongPages(bm, 0, 5);
+    ASSERT_EQUALS_INT(0, wrong, "pages 0-4 loaded again");
+    CHECK(shutdownBufferPool(bm));
+
+    // the moved dirty page reached the disk
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+    CHECK(pinPage(bm, h, 6));
+    ASSERT_EQUALS_STRING("Moved-6", h->data, "moved page written back on shutdown");
+    sprintf(h->data, "%s-%i", "Page", 6);
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+
+    // every strategy keeps serving the right pages through a sequence of resizes
+    for(s = 0; s < 7; s++)
+    {
+        CHECK(initBufferPool(bm, "testbuffer.bin", 8, strategies[s], (strategies[s] == RS_LRU_K) ? &k : NULL));
+        wrong = countWrongPages(bm, 0, 20);
+        ASSERT_EQUALS_INT(0, wrong, "pages before resizing");
+
+        for(i = 0; i < 5; i++)
+        {
+            CHECK(resizeBufferPool(bm, sizes[i]));
+            ASSERT_EQUALS_INT(sizes[i], bm->numPages, "resized pool size");
+            resident = countResidentPages(bm);
+            ASSERT_TRUE(resident <= sizes[i], "resident pages fit the pool");
+            ASSERT_EQUALS_INT(0, countDuplicatePages(bm), "no page resident twice");
+            wrong = countWrongPages(bm, 3 * i, 20);
+            ASSERT_EQUALS_INT(0, wrong, "pages after resizing");
+            wrong = countWrongPages(bm, 3 * i, 2);
+            ASSERT_EQUALS_INT(0, wrong, "hot pages after resizing");
+        }
+        CHECK(shutdownBufferPool(bm));
+    }
+
+    // resizing while other threads pin, dirty and unpin pages
+    for(s = 0; s < 4; s++)
+    {
+        CHECK(initBufferPool(bm, "testbuffer.bin", 8, concurrentStrategies[s], (concurrentStrategies[s] == RS_LRU_K) ? &k : NULL));
+        CHECK(startPageCleaner(bm, 4, 1));
+
+        resizeWorker.bm = bm;
+        resizeWorker.resizes = 0;
+        for(i = 0; i < 4; i++)
+        {
+            workers[i].bm = bm;
+            workers[i].seed = 31 * (s + 1) + i;
+            workers[i].failedPins = 0;
+            workers[i].wrongContents = 0;
+            pthread_create(&threads[i], NULL, pinRandomPages, &workers[i]);
+        }
+        pthread_create(&resizer, NULL, resizeRepeatedly, &resizeWorker);
+
+        pthread_join(resizer, NULL);
+        for(i = 0; i < 4; i++)
+        {
+            pthread_join(threads[i], NULL);
+            ASSERT_EQUALS_INT(0, workers[i].failedPins, "every pin finds a frame while resizing");
+            ASSERT_EQUALS_INT(0, workers[i].wrongContents, "pinned pages hold their own content while resizing");
+        }
+        ASSERT_EQUALS_INT(60, resizeWorker.resizes, "all resizes done");
+
+        // without pins the last shrink goes all the way
+        CHECK(resizeBufferPool(bm, 5));
+        ASSERT_EQUALS_INT(5, bm->numPages, "final pool size");
+        resident = countResidentPages(bm);
+        ASSERT_TRUE(resident <= 5, "resident pages fit the pool");
+        ASSERT_EQUALS_INT(0, countDuplicatePages(bm), "no page resident twice");
+        wrong = countWrongPages(bm, 0, 40);
+        ASSERT_EQUALS_INT(0, wrong, "pages after concurrent resizing");
+
+        CHECK(stopPageCleaner(bm));
+        CHECK(shutdownBufferPool(bm));
+    }
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+// reads one page of a page file without a buffer pool
+static void
+readPageFromFile (char *fileName, int pageNum, char *memPage)
+{
+    SM_FileHandle fh;
+
+    CHECK(openPageFile(fileName, &fh));
+    CHECK(readBlock(pageNum, &fh, memPage));
+    CHECK(closePageFile(&fh));
+}
+
+// counts the frames holding pages of one file
+static int
+countFilePages (BM_BufferPool *bm, int fileId)
+{
+    PageNumber *contents = getFrameContents(bm);
+    int i, count = 0;
+
+    for(i = 0; i < bm->numPages; i++)
+        if (contents[i] != NO_PAGE && BM_PAGE_FILE_ID(contents[i]) == fileId)
+            count++;
+    free(contents);
+    return count;
+}
+
+// several page files share the frames, the page table and the replacement strategy of one pool
+void
+testSharedPool (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *other = MAKE_PAGE_HANDLE();
+    BM_PageHandle pages[4];
+    PageNumber keys[4];
+    char expected[PAGE_SIZE];
+    char onDisk[PAGE_SIZE];
+    int fileId = 0;
+    int secondId = 0;
+    int pinned;
+    int i, round;
+    testName = "Testing a buffer pool shared by several page files";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 20);
+    CHECK(createPageFile("testbuffer2.bin"));
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 6, RS_LRU, NULL));
+    ASSERT_ERROR(pinPage(bm, h, BM_PAGE_KEY(1, 0)), "pages of unregistered files cannot be pinned");
+    ASSERT_ERROR(registerPageFile(bm, "nosuchfile.bin", &fileId), "missing page file");
+    CHECK(registerPageFile(bm, "testbuffer2.bin", &fileId));
+    ASSERT_EQUALS_INT(1, fileId, "first registered file");
+
+    // pages of the new file are written through the pool, the file grows as needed
+    for(i = 0; i < 10; i++)
+    {
+        CHECK(pinPage(bm, h, BM_PAGE_KEY(fileId, i)));
+        ASSERT_EQUALS_INT(BM_PAGE_KEY(fileId, i), h->pageNum, "handle holds the page key");
+        sprintf(h->data, "%s-%i", "Other", i);
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+
+    // the same page number in two files is two pages
+    CHECK(pinPage(bm, h, 1));
+    CHECK(pinPage(bm, other, BM_PAGE_KEY(fileId, 1)));
+    ASSERT_EQUALS_STRING("Page-1", h->data, "page 1 of the first file");
+    ASSERT_EQUALS_STRING("Other-1", other->data, "page 1 of the second file");
+    ASSERT_TRUE(h->data != other->data, "separate frames");
+    CHECK(unpinPage(bm, h));
+    CHECK(unpinPage(bm, other));
+
+    // one memory budget: the file in use takes every frame, whichever file it is
+    for(round = 0; round < 3; round++)
+        for(i = 0; i < 6; i++)
+        {
+            CHECK(pinPage(bm, h, BM_PAGE_KEY(fileId, i)));
+            CHECK(unpinPage(bm, h));
+        }
+    ASSERT_EQUALS_INT(6, countFilePages(bm, fileId), "busy second file holds every frame");
+    for(i = 10; i < 16; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(expected, "%s-%i", "Page", i);
+        ASSERT_EQUALS_STRING(expected, h->data, "first file page");
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_INT(6, countFilePages(bm, 0), "busy first file holds every frame");
+    ASSERT_EQUALS_INT(0, countFilePages(bm, fileId), "idle second file holds none");
+
+    // evicted dirty pages went to their own file
+    readPageFromFile("testbuffer2.bin", 3, onDisk);
+    ASSERT_EQUALS_STRING("Other-3", onDisk, "page of the second file written back");
+    readPageFromFile("testbuffer.bin", 3, onDisk);
+    ASSERT_EQUALS_STRING("Page-3", onDisk, "same page number of the first file untouched");
+
+    // batched pins mix both files, runs do not cross from one file into the other
+    keys[0] = BM_PAGE_KEY(fileId, 7);
+    keys[1] = 7;
+    keys[2] = BM_PAGE_KEY(fileId, 8);
+    keys[3] = 8;
+    CHECK(pinPages(bm, pages, keys, 4));
+    ASSERT_EQUALS_STRING("Other-7", pages[0].data, "batched page of the second file");
+    ASSERT_EQUALS_STRING("Page-7", pages[1].data, "batched page of the first file");
+    ASSERT_EQUALS_STRING("Other-8", pages[2].data, "batched page of the second file");
+    ASSERT_EQUALS_STRING("Page-8", pages[3].data, "batched page of the first file");
+
+    // a forced page goes to its own file
+    sprintf(pages[2].data, "%s-%i", "Forced", 8);
+    CHECK(markDirty(bm, &pages[2]));
+    CHECK(forcePage(bm, &pages[2]));
+    readPageFromFile("testbuffer2.bin", 8, onDisk);
+    ASSERT_EQUALS_STRING("Forced-8", onDisk, "forced page of the second file");
+    readPageFromFile("testbuffer.bin", 8, onDisk);
+    ASSERT_EQUALS_STRING("Page-8", onDisk, "same page number of the first file untouched");
+
+    // a pinned page keeps its file registered
+    sprintf(pages[0].data, "%s-%i", "Changed", 7);
+    CHECK(markDirty(bm, &pages[0]));
+    ASSERT_ERROR(unregisterPageFile(bm, fileId), "pinned page of the file");
+    pinned = countFilePages(bm, fileId);
+    ASSERT_EQUALS_INT(2, pinned, "only the pinned pages are left");
+    CHECK(unpinPages(bm, pages, 4));
+
+    CHECK(unregisterPageFile(bm, fileId));
+    ASSERT_EQUALS_INT(0, countFilePages(bm, fileId), "pages of the file evicted");
+    ASSERT_ERROR(pinPage(bm, h, BM_PAGE_KEY(fileId, 0)), "unregistered file");
+    ASSERT_ERROR(unregisterPageFile(bm, fileId), "file already unregistered");
+    ASSERT_ERROR(unregisterPageFile(bm, 0), "the pool's own file stays");
+    readPageFromFile("testbuffer2.bin", 7, onDisk);
+    ASSERT_EQUALS_STRING("Changed-7", onDisk, "dirty page written back when unregistering");
+
+    // ids are reused, and shutdown flushes every file
+    CHECK(registerPageFile(bm, "testbuffer2.bin", &secondId));
+    ASSERT_EQUALS_INT(fileId, secondId, "file id reused");
+    CHECK(pinPage(bm, h, BM_PAGE_KEY(secondId, 3)));
+    ASSERT_EQUALS_STRING("Other-3", h->data, "page read back from the second file");
+    sprintf(h->data, "%s-%i", "Final", 3);
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+    readPageFromFile("testbuffer2.bin", 3, onDisk);
+    ASSERT_EQUALS_STRING("Final-3", onDisk, "second file flushed on shutdown");
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+    CHECK(destroyPageFile("testbuffer2.bin"));
+
+    free(h);
+    free(other);
+    free(bm);
+    TEST_DONE();
+}
+
+// reads the records of a snapshot file, returns their number or -1 if it cannot be read
+static int
+readSnapshot (char *fileName, BM_SnapshotRecord *records, int maxRecords)
+{
+    FILE *file = fopen(fileName, "rb");
+    char magic[8];
+    int count = -1;
+
+    if (file == NULL)
+        return -1;
+    if (fread(magic, 1, 8, file) != 8 || memcmp(magic, BM_SNAPSHOT_MAGIC, 8) != 0 ||
+        fread(&count, sizeof(int), 1, file) != 1 || count > maxRecords ||
+        fread(records, sizeof(BM_SnapshotRecord), count, file) != (size_t) count)
+        count = -1;
+    fclose(file);
+    return count;
+}
+
+// checks whether a page is resident in the pool
+static bool
+containsPage (BM_BufferPool *bm, PageNumber pageNum)
+{
+    PageNumber *contents = getFrameContents(bm);
+    bool found = FALSE;
+    int i;
+
+    for(i = 0; i < bm->numPages; i++)
+        if (contents[i] == pageNum)
+            found = TRUE;
+    free(contents);
+    return found;
+}
+
+// snapshots of the resident pages reload a new pool in the background
+void
+testWarmRestart (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_SnapshotRecord records[16];
+    BM_PoolStats stats;
+    char expected[PAGE_SIZE];
+    int count, loaded, wrong, waited;
+    int i;
+    testName = "Testing warm restarts from buffer pool snapshots";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 100);
+    remove("testbuffer.warm");
+
+    // shutdown writes the snapshot, hottest page first
+    CHECK(initBufferPool(bm, "testbuffer.bin", 10, RS_LRU, NULL));
+    ASSERT_ERROR(startPoolSnapshots(bm, "testbuffer.warm", -1), "negative snapshot interval");
+    CHECK(startPoolSnapshots(bm, "testbuffer.warm", 0));
+    ASSERT_ERROR(startPoolSnapshots(bm, "testbuffer.warm", 0), "one snapshot file per pool");
+    for(i = 50; i < 60; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(pinPage(bm, h, 52));
+    CHECK(shutdownBufferPool(bm));
+
+    count = readSnapshot("testbuffer.warm", records, 16);
+    ASSERT_EQUALS_INT(10, count, "every resident page saved on shutdown");
+    ASSERT_EQUALS_INT(52, records[0].pageNum, "pinned page first");
+    ASSERT_EQUALS_INT(59, records[1].pageNum, "most recently used page next");
+    ASSERT_EQUALS_INT(50, records[9].pageNum, "least recently used page last");
+    ASSERT_EQUALS_INT(9, records[9].rank, "pages ranked hottest first");
+
+    // a pool of the same size gets every page back, consecutive pages with one read
+    CHECK(initBufferPool(bm, "testbuffer.bin", 10, RS_LRU, NULL));
+    ASSERT_ERROR(waitForPoolWarmup(bm, &loaded), "no warmup running");
+    ASSERT_ERROR(startPoolWarmup(bm, "nosuchfile.warm"), "missing snapshot");
+    ASSERT_ERROR(startPoolWarmup(bm, "testbuffer.bin"), "not a snapshot");
+    CHECK(startPoolWarmup(bm, "testbuffer.warm"));
+    ASSERT_ERROR(startPoolWarmup(bm, "testbuffer.warm"), "one warmup at a time");
+    CHECK(waitForPoolWarmup(bm, &loaded));
+    ASSERT_EQUALS_INT(10, loaded, "snapshot pages loaded");
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(10, (int) stats.pagesRead, "snapshot pages read");
+    ASSERT_EQUALS_INT(1, (int) stats.readCalls, "one read for the sorted pages");
+    for(i = 50; i < 60; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(expected, "%s-%i", "Page", i);
+        ASSERT_EQUALS_STRING(expected, h->data, "warm page content");
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(10, (int) stats.hits, "warm pool serves every pin");
+    CHECK(shutdownBufferPool(bm));
+
+    // a smaller pool takes the hottest pages that fit into its free frames, nothing is evicted for them
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+    CHECK(pinPage(bm, h, 0));
+    CHECK(startPoolWarmup(bm, "testbuffer.warm"));
+    CHECK(waitForPoolWarmup(bm, &loaded));
+    ASSERT_EQUALS_INT(3, loaded, "free frames filled");
+    ASSERT_TRUE(containsPage(bm, 0), "page pinned before the warmup stays");
+    ASSERT_TRUE(containsPage(bm, 52) && containsPage(bm, 59) && containsPage(bm, 58), "hottest pages loaded");
+    CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(3, (int) stats.readCalls, "page 0, page 52 and pages 58-59");
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+
+    // LFU pages get their saved frequencies back
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LFU, NULL));
+    for(i = 0; i < 5; i++)
+    {
+        CHECK(pinPage(bm, h, 1));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(pinPage(bm, h, 2));
+    CHECK(unpinPage(bm, h));
+    CHECK(savePoolContents(bm, "testbuffer.warm"));
+    CHECK(shutdownBufferPool(bm));
+    count = readSnapshot("testbuffer.warm", records, 16);
+    ASSERT_EQUALS_INT(2, count, "resident pages saved");
+    ASSERT_EQUALS_INT(1, records[0].pageNum, "most frequently used page first");
+    ASSERT_EQUALS_INT(5, (int) records[0].frequency, "its frequency");
+    ASSERT_EQUALS_INT(1, (int) records[1].frequency, "frequency of the other page");
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LFU, NULL));
+    CHECK(startPoolWarmup(bm, "testbuffer.warm"));
+    CHECK(waitForPoolWarmup(bm, &loaded));
+    ASSERT_EQUALS_INT(2, loaded, "snapshot pages loaded");
+    for(i = 10; i < 20; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_TRUE(containsPage(bm, 1), "restored frequency keeps the hot page");
+    ASSERT_TRUE(!containsPage(bm, 2), "page used once is evicted");
+    CHECK(shutdownBufferPool(bm));
+
+    // periodic snapshots, stopping them keeps the last one
+    remove("testbuffer.warm");
+    CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_FIFO, NULL));
+    CHECK(pinPage(bm, h, 7));
+    CHECK(unpinPage(bm, h));
+    CHECK(startPoolSnapshots(bm, "testbuffer.warm", 5));
+    for(waited = 0; waited < 2000 && access("testbuffer.warm", F_OK) != 0; waited++)
+        usleep(1000);
+    count = readSnapshot("testbuffer.warm", records, 16);
+    ASSERT_EQUALS_INT(1, count, "periodic snapshot written");
+    ASSERT_EQUALS_INT(7, records[0].pageNum, "periodic snapshot content");
+    CHECK(stopPoolSnapshots(bm));
+    ASSERT_ERROR(stopPoolSnapshots(bm), "no snapshots taken");
+    CHECK(pinPage(bm, h, 8));
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+    count = readSnapshot("testbuffer.warm", records, 16);
+    ASSERT_EQUALS_INT(1, count, "no snapshot after stopping");
+
+    // pins are served while the pool warms up, and shutdown cuts a warmup short
+    CHECK(initBufferPool(bm, "testbuffer.bin", 64, RS_CLOCK, NULL));
+    wrong = countWrongPages(bm, 0, 64);
+    ASSERT_EQUALS_INT(0, wrong, "pages before the snapshot");
+    CHECK(savePoolContents(bm, "testbuffer.warm"));
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 64, RS_CLOCK, NULL));
+    CHECK(startPoolWarmup(bm, "testbuffer.warm"));
+    wrong = countWrongPages(bm, 0, 64);
+    ASSERT_EQUALS_INT(0, wrong, "pages pinned during the warmup");
+    CHECK(waitForPoolWarmup(bm, &loaded));
+    wrong = countDuplicatePages(bm);
+    ASSERT_EQUALS_INT(0, wrong, "no page loaded twice");
+    loaded = countResidentPages(bm);
+    ASSERT_EQUALS_INT(64, loaded, "every snapshot page resident");
+    CHECK(shutdownBufferPool(bm));
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 64, RS_CLOCK, NULL));
+    CHECK(startPoolWarmup(bm, "testbuffer.warm"));
+    CHECK(shutdownBufferPool(bm));
+
+    remove("testbuffer.warm");
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+// pins a page on a thread of its own
+typedef struct ThreadPin
+{
+    BM_BufferPool *bm;
+    BM_PageHandle page;
+    PageNumber pageNum;
+    RC rc;
+} ThreadPin;
+
+static void *
+pinOnThread (void *arg)
+{
+    ThreadPin *pin = (ThreadPin *) arg;
+
+    pin->rc = pinPage(pin->bm, &pin->page, pin->pageNum);
+    return NULL;
+}
+
+// writes a page into a named pipe once the test says so, or after two seconds
+typedef struct PipeRelease
+{
+    char *pipeName;
+    atomic_bool release;
+    atomic_bool timedOut; // the page had to be written before the test asked for it
+} PipeRelease;
+
+static void *
+releasePipedPage (void *arg)
+{
+    PipeRelease *pipe = (PipeRelease *) arg;
+    char page[PAGE_SIZE];
+    int waited, fd;
+
+    for(waited = 0; waited < 2000 && !atomic_load(&pipe->release); waited++)
+        usleep(1000);
+    atomic_store(&pipe->timedOut, !atomic_load(&pipe->release));
+
+    memset(page, 0, PAGE_SIZE);
+    sprintf(page, "%s-%i", "Piped", 0);
+    fd = open(pipe->pipeName, O_WRONLY);
+    if (fd >= 0)
+    {
+        if (write(fd, page, PAGE_SIZE) != PAGE_SIZE)
+            printf("[%s] could not write into the pipe\n", testName);
+        close(fd);
+    }
+    return NULL;
+}
+
+// an asynchronous pin of a page that is still being read returns at once and completes with the read.
+// The page file is a named pipe, so the read only finishes once the test writes the page into it
+void
+testAsyncPinJoinsRead (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle asyncPage;
+    BM_PinRequest request;
+    ThreadPin blocked;
+    PipeRelease pipe;
+    pthread_t pinner, releaser;
+    PageNumber pipedPage;
+    int fileId, completed, waited, pipeRc, i;
+    testName = "Testing asynchronous pins joining a read in flight";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+    remove("testbuffer.pipe");
+    pipeRc = mkfifo("testbuffer.pipe", 0600);
+    ASSERT_EQUALS_INT(0, pipeRc, "named pipe created");
+
+    CHECK(initBufferPool(bm, "testbuffer.bin", 2, RS_LRU, NULL));
+    CHECK(registerPageFile(bm, "testbuffer.pipe", &fileId));
+    pipedPage = BM_PAGE_KEY(fileId, 0);
+
+    // the first read writes an empty page into the pipe and reads it back, after that the pipe is empty
+    CHECK(pinPage(bm, h, pipedPage));
+    CHECK(unpinPage(bm, h));
+    for(i = 1; i <= 2; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_TRUE(!containsPage(bm, pipedPage), "piped page evicted");
+
+    // reading the page again blocks until the pipe gets a page
+    blocked.bm = bm;
+    blocked.pageNum = pipedPage;
+    pthread_create(&pinner, NULL, pinOnThread, &blocked);
+    for(waited = 0; waited < 2000 && !containsPage(bm, pipedPage); waited++)
+        usleep(1000);
+    ASSERT_TRUE(containsPage(bm, pipedPage), "read in flight");
+
+    pipe.pipeName = "testbuffer.pipe";
+    atomic_init(&pipe.release, false);
+    atomic_init(&pipe.timedOut, false);
+    pthread_create(&releaser, NULL, releasePipedPage, &pipe);
+
+    request.callback = NULL;
+    CHECK(pinPageAsync(bm, &asyncPage, pipedPage, &request));
+    completed = pollPinCompletions(bm, false);
+    ASSERT_EQUALS_INT(0, completed, "joined pin waits for the read");
+    atomic_store(&pipe.release, true);
+    pthread_join(releaser, NULL);
+    ASSERT_TRUE(!atomic_load(&pipe.timedOut), "asynchronous pin returned before the read completed");
+
+    pthread_join(pinner, NULL);
+    CHECK(blocked.rc);
+    ASSERT_EQUALS_STRING("Piped-0", blocked.page.data, "page read from the pipe");
+    completed = pollPinCompletions(bm, true);
+    ASSERT_EQUALS_INT(1, completed, "joined pin completed with the read");
+    CHECK(request.rc);
+    ASSERT_EQUALS_STRING("Piped-0", asyncPage.data, "joined pin sees the page");
+
+    CHECK(unpinPage(bm, &blocked.page));
+    CHECK(unpinPage(bm, &asyncPage));
+    CHECK(unregisterPageFile(bm, fileId));
+    CHECK(shutdownBufferPool(bm));
+
+    remove("testbuffer.pipe");
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+// pins of a page that cannot be read fail and leave no frame behind. Every write to /dev/full fails,
+// so none of its pages can be allocated before they are read
+void
+testFailedReads (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle batch[2];
+    BM_PinRequest request;
+    PageNumber batchPages[2];
+    int fileId, completed, i;
+    testName = "Testing failed page reads";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+    CHECK(registerPageFile(bm, "/dev/full", &fileId));
+
+    ASSERT_ERROR(pinPage(bm, h, BM_PAGE_KEY(fileId, 0)), "page that cannot be read");
+    ASSERT_TRUE(!containsPage(bm, BM_PAGE_KEY(fileId, 0)), "failed page is not resident");
+    ASSERT_EQUALS_POOL("[-1 0],[-1 0],[-1 0]", bm, "frame of the failed read is free again");
+
+    request.callback = NULL;
+    CHECK(pinPageAsync(bm, h, BM_PAGE_KEY(fileId, 1), &request));
+    completed = pollPinCompletions(bm, true);
+    ASSERT_EQUALS_INT(1, completed, "failed asynchronous pin completed");
+    ASSERT_ERROR(request.rc, "asynchronous pin reports the failed read");
+    ASSERT_EQUALS_POOL("[-1 0],[-1 0],[-1 0]", bm, "frame of the failed asynchronous read is free again");
+
+    // the batch gives back the pin of its resident page
+    CHECK(pinPage(bm, h, 1));
+    CHECK(unpinPage(bm, h));
+    batchPages[0] = 1;
+    batchPages[1] = BM_PAGE_KEY(fileId, 2);
+    ASSERT_ERROR(pinPages(bm, batch, batchPages, 2), "batch with a page that cannot be read");
+    ASSERT_EQUALS_POOL("[-1 0],[-1 0],[1 0]", bm, "failed batch leaves nothing pinned");
+
+    // every frame can still be used
+    for(i = 0; i < 3; i++)
+        CHECK(pinPage(bm, &batch[0], i + 2));
+    ASSERT_EQUALS_POOL("[3 1],[2 1],[4 1]", bm, "pool keeps working");
+    for(i = 0; i < 3; i++)
+    {
+        batch[0].pageNum = i + 2;
+        CHECK(unpinPage(bm, &batch[0]));
+    }
+
+    CHECK(unregisterPageFile(bm, fileId));
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+// pages that cannot be written back stay resident and dirty. The page written lies past a file size
+// limit, which makes its writes fail while the test output still fits below it
+#define WRITE_LIMIT_PAGES 2048
+
+void
+testFailedWrites (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    struct rlimit unlimited, limited;
+    PageNumber farPage = WRITE_LIMIT_PAGES + 5;
+    int i, limitRc;
+    testName = "Testing failed page writes";
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+
+    CHECK(pinPage(bm, h, farPage));
+    sprintf(h->data, "%s-%i", "Changed", h->pageNum);
+    CHECK(markDirty(bm, h));
+
+    signal(SIGXFSZ, SIG_IGN);
+    getrlimit(RLIMIT_FSIZE, &unlimited);
+    limited = unlimited;
+    limited.rlim_cur = (rlim_t) WRITE_LIMIT_PAGES * PAGE_SIZE;
+    limitRc = setrlimit(RLIMIT_FSIZE, &limited);
+    ASSERT_EQUALS_INT(0, limitRc, "file size limited");
+
+    ASSERT_ERROR(forcePage(bm, h), "page past the limit cannot be written");
+    ASSERT_EQUALS_POOL("[2053x1],[-1 0],[-1 0]", bm, "page stays dirty");
+    CHECK(unpinPage(bm, h));
+
+    // the page is the victim for page 3, the pin fails and the page keeps its frame
+    for(i = 1; i <= 2; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_ERROR(pinPage(bm, h, 3), "victim cannot be written back");
+    ASSERT_EQUALS_POOL("[2053x0],[1 0],[2 0]", bm, "victim stays resident and dirty");
+    ASSERT_ERROR(forceFlushPool(bm), "flush of a page past the limit");
+    ASSERT_EQUALS_POOL("[2053x0],[1 0],[2 0]", bm, "page stays dirty after the flush");
+
+    limitRc = setrlimit(RLIMIT_FSIZE, &unlimited);
+    ASSERT_EQUALS_INT(0, limitRc, "file size limit lifted");
+    signal(SIGXFSZ, SIG_DFL);
+    CHECK(pinPage(bm, h, 3));
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+
+    // nothing written while the limit was in place got lost
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+    CHECK(pinPage(bm, h, farPage));
+    ASSERT_EQUALS_STRING("Changed-2053", h->data, "page written once the limit was lifted");
+
+    // shutting down reports the pages it could not write
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+    signal(SIGXFSZ, SIG_IGN);
+    limitRc = setrlimit(RLIMIT_FSIZE, &limited);
+    ASSERT_EQUALS_INT(0, limitRc, "file size limited again");
+    ASSERT_ERROR(shutdownBufferPool(bm), "shutdown with a page past the limit");
+    limitRc = setrlimit(RLIMIT_FSIZE, &unlimited);
+    ASSERT_EQUALS_INT(0, limitRc, "file size limit lifted again");
+    signal(SIGXFSZ, SIG_DFL);
+    CHECK(destroyPageFile("testbuffer.bin"));
+
+    free(h);
+    free(bm);
+    TEST_DONE();
+}
+
+// replayed strategies read only the pages they miss on, so OPT hits at least as often as any of them
+// on a sequential trace, which read-ahead would otherwise turn into hits
+#define REPLAY_PAGES 64
+#define REPLAY_PASSES 3
+#define REPLAY_POOL_SIZE 16
+void
+testTraceReplay (void)
+{
+    BM_TraceRecord records[2 * REPLAY_PAGES * REPLAY_PASSES];
+    ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q };
+    SM_FileHandle fh;
+    int lruK = 2;
+    int numRecords = 0;
+    int distinctPages;
+    long long *nextPin;
+    SimResult opt, result;
+    int pass, i;
+    testName = "Testing trace replays against OPT";
+
+    for(pass = 0; pass < REPLAY_PASSES; pass++)
+    {
+        for(i = 0; i < REPLAY_PAGES; i++)
+        {
+            records[numRecords].timestamp = numRecords;
+            records[numRecords].pageNum = i;
+            records[numRecords++].operation = BM_TRACE_PIN;
+            records[numRecords].timestamp = numRecords;
+            records[numRecords].pageNum = i;
+            records[numRecords++].operation = BM_TRACE_UNPIN;
+        }
+    }
+
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    CHECK(ensureCapacity(REPLAY_PAGES, &fh));
+    CHECK(closePageFile(&fh));
+
+    nextPin = findNextPins(records, numRecords, maxTracePage(records, numRecords), &distinctPages);
+    ASSERT_TRUE(nextPin != NULL, "next pins found");
+    ASSERT_EQUALS_INT(REPLAY_PAGES, distinctPages, "every page pinned");
+    opt = replayOPT(records, numRecords, nextPin, REPLAY_PAGES - 1, REPLAY_POOL_SIZE);
+    ASSERT_TRUE(opt.hits > 0, "OPT keeps pages for the next pass");
+
+    for(i = 0; i < (int) (sizeof(strategies) / sizeof(strategies[0])); i++)
+    {
+        result = replayStrategy(records, numRecords, "testbuffer.bin", strategies[i],
+                (strategies[i] == RS_LRU_K) ? &lruK : NULL, REPLAY_POOL_SIZE);
+        ASSERT_EQUALS_INT(0, (int) result.pinFailures, "every pin of the replay succeeds");
+        ASSERT_TRUE(result.pagesRead == result.misses, "no pages read ahead");
+        ASSERT_TRUE(result.hits <= opt.hits, "OPT hits at least as often as the strategy");
+    }
+
+    CHECK(destroyPageFile("testbuffer.bin"));
+    free(nextPin);
+    TEST_DONE();
+}
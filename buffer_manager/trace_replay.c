@@ -0,0 +1,339 @@
+#include "dberror.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "dt.h"
+#include "buffer_mgr.h"
+#include "trace_replay.h"
+
+// Replays of pin traces. The strategies run in the real buffer manager with read-ahead turned off,
+// so they read exactly the pages they miss on, like OPT. OPT is simulated: it misses exactly when the
+// page is not resident and evicts the unpinned page whose next pin is farthest away. Writes are dirty
+// pages written back during the replay.
+
+// Frame of the OPT simulation
+typedef struct OptFrame {
+    PageNumber pageNum;
+    int fixCount;
+    bool dirty;
+    long long nextPin; // index of the next pin of the page in the trace
+    int heapPos; // position in the heap of unpinned frames, -1 while pinned
+} OptFrame;
+
+BM_TraceRecord *loadTrace(const char *fileName, long *numRecords)
+{
+    FILE *file = fopen(fileName, "rb");
+    char magic[8];
+    if (file == NULL || fread(magic, 1, 8, file) != 8 || memcmp(magic, BM_TRACE_MAGIC, 8) != 0)
+    {
+        if (file != NULL)
+        {
+            fclose(file);
+        }
+        return NULL;
+    }
+
+    long capacity = 4096;
+    long count = 0;
+    BM_TraceRecord *records = (BM_TraceRecord *)malloc(sizeof(BM_TraceRecord) * capacity);
+    while (records != NULL)
+    {
+        if (count == capacity)
+        {
+            capacity *= 2;
+            BM_TraceRecord *grown = (BM_TraceRecord *)realloc(records, sizeof(BM_TraceRecord) * capacity);
+            if (grown == NULL)
+            {
+                free(records);
+                records = NULL;
+                break;
+            }
+            records = grown;
+        }
+        size_t read = fread(&records[count], sizeof(BM_TraceRecord), capacity - count, file);
+        if (read == 0)
+        {
+            break;
+        }
+        count += read;
+    }
+    fclose(file);
+
+    *numRecords = count;
+    return records;
+}
+
+// Pages of a shared pool are recorded as page keys. The scratch file holds the page files one after
+// another, so each file keeps its own sequential runs and the page numbers stay dense.
+void packPageFiles(BM_TraceRecord *records, long numRecords)
+{
+    PageNumber filePages[BM_MAX_PAGE_FILES] = {0};
+    PageNumber fileStart[BM_MAX_PAGE_FILES];
+    PageNumber start = 0;
+
+    for (long i = 0; i < numRecords; i++)
+    {
+        int fileId = BM_PAGE_FILE_ID(records[i].pageNum);
+        if (BM_PAGE_NUMBER(records[i].pageNum) >= filePages[fileId])
+        {
+            filePages[fileId] = BM_PAGE_NUMBER(records[i].pageNum) + 1;
+        }
+    }
+    for (int fileId = 0; fileId < BM_MAX_PAGE_FILES; fileId++)
+    {
+        fileStart[fileId] = start;
+        start += filePages[fileId];
+    }
+    for (long i = 0; i < numRecords; i++)
+    {
+        records[i].pageNum = fileStart[BM_PAGE_FILE_ID(records[i].pageNum)] + BM_PAGE_NUMBER(records[i].pageNum);
+    }
+}
+
+// Largest page number of the trace
+PageNumber maxTracePage(const BM_TraceRecord *records, long numRecords)
+{
+    PageNumber maxPage = 0;
+    for (long i = 0; i < numRecords; i++)
+    {
+        if (records[i].pageNum > maxPage)
+        {
+            maxPage = records[i].pageNum;
+        }
+    }
+    return maxPage;
+}
+
+// Next pin of the same page for every pin, found walking the trace backwards. Returns NULL if
+// there is not enough memory
+long long *findNextPins(const BM_TraceRecord *records, long numRecords, PageNumber maxPage, int *distinctPages)
+{
+    long long *nextPin = (long long *)malloc(sizeof(long long) * (numRecords + 1));
+    long long *lastPin = (long long *)malloc(sizeof(long long) * (maxPage + 1));
+    if (nextPin == NULL || lastPin == NULL)
+    {
+        free(nextPin);
+        free(lastPin);
+        return NULL;
+    }
+
+    *distinctPages = 0;
+    for (PageNumber pageNum = 0; pageNum <= maxPage; pageNum++)
+    {
+        lastPin[pageNum] = NEVER_AGAIN;
+    }
+    for (long i = numRecords - 1; i >= 0; i--)
+    {
+        if (records[i].operation == BM_TRACE_PIN)
+        {
+            if (lastPin[records[i].pageNum] == NEVER_AGAIN)
+            {
+                (*distinctPages)++;
+            }
+            nextPin[i] = lastPin[records[i].pageNum];
+            lastPin[records[i].pageNum] = i;
+        }
+    }
+    free(lastPin);
+    return nextPin;
+}
+
+/// Real Strategies ///
+
+SimResult replayStrategy(const BM_TraceRecord *records, long numRecords, const char *pageFileName,
+                         ReplacementStrategy strategy, void *stratData, int poolSize)
+{
+    SimResult result = {0, 0, 0, 0, 0, 0};
+    BM_BufferPool bm;
+    BM_PageHandle page;
+    BM_PoolStats stats;
+
+    if (initBufferPool(&bm, pageFileName, poolSize, strategy, stratData) != RC_OK)
+    {
+        result.pinFailures = -1;
+        return result;
+    }
+    // OPT only reads the pages it misses on, so read-ahead would let a strategy beat it
+    disableReadAhead(&bm);
+
+    // unpinPage and markDirty only need the page number of the handle. Pins that failed during the
+    // replay make their unpins fail as well, which is ignored
+    for (long i = 0; i < numRecords; i++)
+    {
+        if (records[i].operation == BM_TRACE_PIN)
+        {
+            result.pins++;
+            pinPage(&bm, &page, records[i].pageNum);
+        }
+        else
+        {
+            page.pageNum = records[i].pageNum;
+            if (records[i].operation == BM_TRACE_UNPIN)
+            {
+                unpinPage(&bm, &page);
+            }
+            else if (records[i].operation == BM_TRACE_MARK_DIRTY)
+            {
+                markDirty(&bm, &page);
+            }
+        }
+    }
+
+    getPoolStats(&bm, &stats);
+    result.hits = stats.hits;
+    result.misses = stats.misses;
+    result.pagesRead = stats.pagesRead;
+    result.pagesWritten = stats.pagesWritten;
+    result.pinFailures = stats.pinFailures;
+    shutdownBufferPool(&bm);
+
+    return result;
+}
+
+/// Belady's OPT ///
+
+// Heap of the unpinned frames, the frame whose page is pinned again last on top
+static void swapOptHeap(OptFrame *frames, int *heap, int i, int j)
+{
+    int frame = heap[i];
+    heap[i] = heap[j];
+    heap[j] = frame;
+    frames[heap[i]].heapPos = i;
+    frames[heap[j]].heapPos = j;
+}
+
+static void siftUpOptHeap(OptFrame *frames, int *heap, int pos)
+{
+    while (pos > 0 && frames[heap[(pos - 1) / 2]].nextPin < frames[heap[pos]].nextPin)
+    {
+        swapOptHeap(frames, heap, pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+}
+
+static void siftDownOptHeap(OptFrame *frames, int *heap, int size, int pos)
+{
+    while (true)
+    {
+        int largest = pos;
+        int left = 2 * pos + 1;
+        int right = left + 1;
+        if (left < size && frames[heap[left]].nextPin > frames[heap[largest]].nextPin)
+        {
+            largest = left;
+        }
+        if (right < size && frames[heap[right]].nextPin > frames[heap[largest]].nextPin)
+        {
+            largest = right;
+        }
+        if (largest == pos)
+        {
+            return;
+        }
+        swapOptHeap(frames, heap, pos, largest);
+        pos = largest;
+    }
+}
+
+static void removeOptHeap(OptFrame *frames, int *heap, int *size, int frameNum)
+{
+    int pos = frames[frameNum].heapPos;
+    (*size)--;
+    if (pos != *size)
+    {
+        swapOptHeap(frames, heap, pos, *size);
+        siftUpOptHeap(frames, heap, pos);
+        siftDownOptHeap(frames, heap, *size, frames[heap[pos]].heapPos);
+    }
+    frames[frameNum].heapPos = -1;
+}
+
+SimResult replayOPT(const BM_TraceRecord *records, long numRecords, const long long *nextPin,
+                    PageNumber maxPage, int poolSize)
+{
+    SimResult result = {0, 0, 0, 0, 0, 0};
+    OptFrame *frames = (OptFrame *)malloc(sizeof(OptFrame) * poolSize);
+    int *heap = (int *)malloc(sizeof(int) * poolSize);
+    int *frameOfPage = (int *)malloc(sizeof(int) * (maxPage + 1));
+    int heapSize = 0;
+    int framesUsed = 0;
+
+    if (frames == NULL || heap == NULL || frameOfPage == NULL)
+    {
+        free(frames);
+        free(heap);
+        free(frameOfPage);
+        result.pinFailures = -1;
+        return result;
+    }
+    for (PageNumber pageNum = 0; pageNum <= maxPage; pageNum++)
+    {
+        frameOfPage[pageNum] = -1;
+    }
+
+    for (long i = 0; i < numRecords; i++)
+    {
+        int frameNum = frameOfPage[records[i].pageNum];
+        if (records[i].operation == BM_TRACE_PIN)
+        {
+            result.pins++;
+            if (frameNum != -1)
+            {
+                result.hits++;
+                if (frames[frameNum].heapPos != -1)
+                {
+                    removeOptHeap(frames, heap, &heapSize, frameNum);
+                }
+            }
+            else
+            {
+                if (framesUsed < poolSize)
+                {
+                    frameNum = framesUsed++;
+                }
+                else if (heapSize > 0)
+                {
+                    frameNum = heap[0];
+                    removeOptHeap(frames, heap, &heapSize, frameNum);
+                    if (frames[frameNum].dirty)
+                    {
+                        result.pagesWritten++;
+                    }
+                    frameOfPage[frames[frameNum].pageNum] = -1;
+                }
+                else
+                {
+                    result.pinFailures++;
+                    continue;
+                }
+                result.misses++;
+                result.pagesRead++;
+                frames[frameNum].pageNum = records[i].pageNum;
+                frames[frameNum].fixCount = 0;
+                frames[frameNum].dirty = false;
+                frames[frameNum].heapPos = -1;
+                frameOfPage[records[i].pageNum] = frameNum;
+            }
+            frames[frameNum].fixCount++;
+            frames[frameNum].nextPin = nextPin[i];
+        }
+        else if (frameNum != -1 && frames[frameNum].fixCount > 0)
+        {
+            if (records[i].operation == BM_TRACE_MARK_DIRTY)
+            {
+                frames[frameNum].dirty = true;
+            }
+            else if (records[i].operation == BM_TRACE_UNPIN && --frames[frameNum].fixCount == 0)
+            {
+                frames[frameNum].heapPos = heapSize;
+                heap[heapSize++] = frameNum;
+                siftUpOptHeap(frames, heap, heapSize - 1);
+            }
+        }
+    }
+
+    free(frames);
+    free(heap);
+    free(frameOfPage);
+    return result;
+}
@@ -0,0 +1,34 @@
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+#include "buffer_mgr.h"
+
+// Replays of pin traces recorded with startPinTrace, used by run_trace_sim.exe
+
+// Next pin of a page that is not pinned again
+#define NEVER_AGAIN 0x7fffffffffffffffLL
+
+// Result of one replay, pinFailures is -1 if the replay could not be set up
+typedef struct SimResult {
+    long pins;
+    long hits;
+    long misses;
+    long pagesRead;
+    long pagesWritten;
+    long pinFailures;
+} SimResult;
+
+// Loading a trace
+BM_TraceRecord *loadTrace (const char *fileName, long *numRecords);
+void packPageFiles (BM_TraceRecord *records, long numRecords);
+PageNumber maxTracePage (const BM_TraceRecord *records, long numRecords);
+long long *findNextPins (const BM_TraceRecord *records, long numRecords, PageNumber maxPage,
+		int *distinctPages);
+
+// Replays, the page file of replayStrategy must hold every page of the trace
+SimResult replayStrategy (const BM_TraceRecord *records, long numRecords, const char *pageFileName,
+		ReplacementStrategy strategy, void *stratData, int poolSize);
+SimResult replayOPT (const BM_TraceRecord *records, long numRecords, const long long *nextPin,
+		PageNumber maxPage, int poolSize);
+
+#endif
@@ -0,0 +1,114 @@
+#include "dberror.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "dt.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "trace_replay.h"
+
+// Replays a pin trace recorded with startPinTrace against every replacement strategy at several pool
+// sizes, and against Belady's OPT as the baseline no strategy can beat.
+//
+//   run_trace_sim.exe trace.bin [poolSize ...]
+//
+// Without pool sizes the pool doubles from 4 frames up to the number of distinct pages in the trace.
+// Traces of a pool shared by several page files are replayed on one scratch file holding them all.
+// The strategies run in the real buffer manager on a scratch page file with read-ahead turned off,
+// see trace_replay.c.
+
+#define SCRATCH_FILE "trace_sim.bin"
+
+static void printResult(const char *strategy, int poolSize, SimResult result)
+{
+    if (result.pinFailures < 0)
+    {
+        printf("strategy=%s poolSize=%d error=\"pool could not be set up\"\n", strategy, poolSize);
+        return;
+    }
+    printf("strategy=%s poolSize=%d pins=%ld hits=%ld misses=%ld hitRatio=%.4f pagesRead=%ld pagesWritten=%ld pinFailures=%ld\n",
+           strategy, poolSize, result.pins, result.hits, result.misses,
+           (result.pins > 0) ? (double)result.hits / result.pins : 0.0,
+           result.pagesRead, result.pagesWritten, result.pinFailures);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s trace.bin [poolSize ...]\n", argv[0]);
+        return 1;
+    }
+
+    long numRecords = 0;
+    BM_TraceRecord *records = loadTrace(argv[1], &numRecords);
+    if (records == NULL)
+    {
+        fprintf(stderr, "%s is not a pin trace\n", argv[1]);
+        return 1;
+    }
+    packPageFiles(records, numRecords);
+
+    PageNumber maxPage = maxTracePage(records, numRecords);
+    int distinctPages = 0;
+    long long *nextPin = findNextPins(records, numRecords, maxPage, &distinctPages);
+    if (nextPin == NULL)
+    {
+        fprintf(stderr, "not enough memory for the trace\n");
+        return 1;
+    }
+
+    printf("trace=%s records=%ld distinctPages=%d durationNanos=%lld\n", argv[1], numRecords, distinctPages,
+           (numRecords > 0) ? records[numRecords - 1].timestamp : 0LL);
+
+    int numSizes = 0;
+    int *poolSizes = (int *)malloc(sizeof(int) * (argc + 32));
+    for (int arg = 2; arg < argc; arg++)
+    {
+        if (atoi(argv[arg]) > 0)
+        {
+            poolSizes[numSizes++] = atoi(argv[arg]);
+        }
+    }
+    if (numSizes == 0)
+    {
+        for (int size = 4; numSizes < 32; size *= 2)
+        {
+            poolSizes[numSizes++] = size;
+            if (size >= distinctPages)
+            {
+                break;
+            }
+        }
+    }
+
+    // Every page of the trace exists in the scratch file, so misses read real pages
+    SM_FileHandle fileHandle;
+    if (createPageFile(SCRATCH_FILE) != RC_OK || openPageFile(SCRATCH_FILE, &fileHandle) != RC_OK ||
+        ensureCapacity(maxPage + 1, &fileHandle) != RC_OK)
+    {
+        fprintf(stderr, "unable to create %s\n", SCRATCH_FILE);
+        return 1;
+    }
+    closePageFile(&fileHandle);
+
+    int lruK = 2;
+    for (int s = 0; s < numSizes; s++)
+    {
+        int poolSize = poolSizes[s];
+        printResult("FIFO", poolSize, replayStrategy(records, numRecords, SCRATCH_FILE, RS_FIFO, NULL, poolSize));
+        printResult("LRU", poolSize, replayStrategy(records, numRecords, SCRATCH_FILE, RS_LRU, NULL, poolSize));
+        printResult("CLOCK", poolSize, replayStrategy(records, numRecords, SCRATCH_FILE, RS_CLOCK, NULL, poolSize));
+        printResult("LFU", poolSize, replayStrategy(records, numRecords, SCRATCH_FILE, RS_LFU, NULL, poolSize));
+        printResult("LRU-2", poolSize, replayStrategy(records, numRecords, SCRATCH_FILE, RS_LRU_K, &lruK, poolSize));
+        printResult("ARC", poolSize, replayStrategy(records, numRecords, SCRATCH_FILE, RS_ARC, NULL, poolSize));
+        printResult("2Q", poolSize, replayStrategy(records, numRecords, SCRATCH_FILE, RS_2Q, NULL, poolSize));
+        printResult("OPT", poolSize, replayOPT(records, numRecords, nextPin, maxPage, poolSize));
+    }
+
+    destroyPageFile(SCRATCH_FILE);
+    free(poolSizes);
+    free(nextPin);
+    free(records);
+    return 0;
+}